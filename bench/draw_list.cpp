@@ -0,0 +1,67 @@
+// Builds a draw list of synthetic instances and reports key, sort and batch times.
+//
+// 	geodesy-bench-draw-list [instance count] [mesh count] [material count] [thread count]
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <geodesy/gfx.h>
+
+using namespace geodesy;
+
+int main(int aArgCount, char* aArgs[]) {
+	size_t InstanceCount 	= aArgCount > 1 ? (size_t)std::strtoul(aArgs[1], nullptr, 10) : 100000;
+	size_t MeshCount 		= aArgCount > 2 ? (size_t)std::strtoul(aArgs[2], nullptr, 10) : 256;
+	size_t MaterialCount 	= aArgCount > 3 ? (size_t)std::strtoul(aArgs[3], nullptr, 10) : 64;
+	size_t ThreadCount 		= aArgCount > 4 ? (size_t)std::strtoul(aArgs[4], nullptr, 10) : 0;
+	size_t FrameCount 		= 16;
+
+	// One in eight materials is translucent, so both key layouts are exercised.
+	std::vector<std::shared_ptr<gfx::mesh>> Mesh(MeshCount);
+	std::vector<std::shared_ptr<gfx::material>> Material(MaterialCount);
+	for (auto& M : Mesh) M = std::make_shared<gfx::mesh>();
+	for (size_t i = 0; i < MaterialCount; i++) {
+		Material[i] = std::make_shared<gfx::material>();
+		Material[i]->UniformData.Transparency = (i % 8 == 7) ? gfx::material::transparency::TRANSLUCENT : gfx::material::transparency::OPAQUE;
+	}
+
+	// Instances reuse a few mesh/material pairs heavily, as scattered props do.
+	std::mt19937 Random(1);
+	std::vector<gfx::mesh::instance> Instance(InstanceCount);
+	std::vector<size_t> MeshIndex(InstanceCount), MaterialIndex(InstanceCount), Pipeline(InstanceCount);
+	std::vector<float> Depth(InstanceCount);
+	std::uniform_real_distribution<float> Distance(0.0f, 1000.0f);
+	for (size_t i = 0; i < InstanceCount; i++) {
+		MeshIndex[i] 		= Random() % MeshCount;
+		MaterialIndex[i] 	= (MeshIndex[i] + Random() % 4) % MaterialCount;
+		Pipeline[i] 		= Random() % 4;
+		Depth[i] 			= Distance(Random);
+	}
+
+	gfx::draw_list DrawList;
+	DrawList.ThreadCount = ThreadCount;
+	gfx::draw_list::statistics Total;
+	for (size_t f = 0; f < FrameCount; f++) {
+		DrawList.clear();
+		for (size_t i = 0; i < InstanceCount; i++) {
+			DrawList.add(&Instance[i], Mesh[MeshIndex[i]].get(), Material[MaterialIndex[i]].get(), (uint)Pipeline[i], Depth[i]);
+		}
+		DrawList.build();
+		Total.KeyTime 	+= DrawList.Statistics.KeyTime;
+		Total.SortTime 	+= DrawList.Statistics.SortTime;
+		Total.BatchTime += DrawList.Statistics.BatchTime;
+	}
+
+	const gfx::draw_list::statistics& Last = DrawList.Statistics;
+	std::printf("instances:      %zu (%zu meshes, %zu materials)\n", Last.DrawCount, MeshCount, MaterialCount);
+	std::printf("batches:        %zu\n", Last.BatchCount);
+	std::printf("state changes:  %zu\n", Last.StateChangeCount);
+	std::printf("sort passes:    %zu\n", Last.SortPassCount);
+	std::printf("key:            %.3f ms\n", 1000.0 * Total.KeyTime / (double)FrameCount);
+	std::printf("sort:           %.3f ms\n", 1000.0 * Total.SortTime / (double)FrameCount);
+	std::printf("batch:          %.3f ms\n", 1000.0 * Total.BatchTime / (double)FrameCount);
+	return 0;
+}
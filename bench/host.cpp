@@ -0,0 +1,336 @@
+// Times the host side hot paths of geodesy-graphics on procedurally generated data and
+// writes the results as JSON, for tracking regressions between builds.
+//
+// 	geodesy-bench-host [--vertices N] [--bones N] [--instances N] [--texture N]
+// 	                   [--iterations N] [--threads N] [--font path] [--output path]
+// 	                   [--trace path]
+//
+// With GEODESY_GFX_ENABLE_TRACE, --trace writes the library's trace zones as Chrome
+// trace JSON, with every benchmark iteration recorded as one frame.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <assimp/scene.h>
+
+#include <geodesy/gfx.h>
+
+using namespace geodesy;
+
+struct parameters {
+	size_t 			VertexCount 	= 4096;
+	size_t 			BoneCount 		= 32;
+	size_t 			InstanceCount 	= 256;
+	size_t 			TextureSize 	= 1024;
+	size_t 			Iterations 		= 10;
+	size_t 			ThreadCount 	= 0;
+	std::string 	Font;
+	std::string 	Output;
+	std::string 	Trace;
+};
+
+struct result {
+	std::string 	Name;
+	size_t 			Iterations;
+	size_t 			Items; 			// Work items per iteration.
+	double 			Mean; 			// Seconds.
+	double 			Min;
+	double 			Max;
+};
+
+// Runs aFunction aIterations times after one warm up run.
+static result measure(const std::string& aName, size_t aIterations, size_t aItems, const std::function<void()>& aFunction) {
+	result Result;
+	Result.Name 		= aName;
+	Result.Iterations 	= aIterations;
+	Result.Items 		= aItems;
+	Result.Mean 		= 0.0;
+	Result.Min 			= 1e30;
+	Result.Max 			= 0.0;
+	aFunction();
+	for (size_t i = 0; i < aIterations; i++) {
+		auto Start = std::chrono::steady_clock::now();
+		aFunction();
+		double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+		GEODESY_GFX_TRACE_FRAME();
+		Result.Mean += Seconds;
+		Result.Min = std::min(Result.Min, Seconds);
+		Result.Max = std::max(Result.Max, Seconds);
+	}
+	Result.Mean /= (double)std::max((size_t)1, aIterations);
+	std::fprintf(stderr, "%-32s %10.3f ms\n", aName.c_str(), 1000.0 * Result.Mean);
+	return Result;
+}
+
+// Square grid in the xz plane with every vertex attribute the converter reads.
+static aiMesh* make_grid(size_t aVertexCount) {
+	uint Side = std::max(2u, (uint)std::sqrt((double)aVertexCount));
+	aiMesh* Mesh = new aiMesh();
+	Mesh->mPrimitiveTypes 		= aiPrimitiveType_TRIANGLE;
+	Mesh->mNumVertices 			= Side * Side;
+	Mesh->mVertices 			= new aiVector3D[Mesh->mNumVertices];
+	Mesh->mNormals 				= new aiVector3D[Mesh->mNumVertices];
+	Mesh->mTangents 			= new aiVector3D[Mesh->mNumVertices];
+	Mesh->mBitangents 			= new aiVector3D[Mesh->mNumVertices];
+	Mesh->mTextureCoords[0] 	= new aiVector3D[Mesh->mNumVertices];
+	Mesh->mNumUVComponents[0] 	= 2;
+	Mesh->mColors[0] 			= new aiColor4D[Mesh->mNumVertices];
+	for (uint j = 0; j < Side; j++) {
+		for (uint i = 0; i < Side; i++) {
+			uint v = i + j * Side;
+			float U = (float)i / (float)(Side - 1), V = (float)j / (float)(Side - 1);
+			Mesh->mVertices[v] 			= aiVector3D(U, 0.1f * std::sin(8.0f * U), V);
+			Mesh->mNormals[v] 			= aiVector3D(0.0f, 1.0f, 0.0f);
+			Mesh->mTangents[v] 			= aiVector3D(1.0f, 0.0f, 0.0f);
+			Mesh->mBitangents[v] 		= aiVector3D(0.0f, 0.0f, 1.0f);
+			Mesh->mTextureCoords[0][v] 	= aiVector3D(U, V, 0.0f);
+			Mesh->mColors[0][v] 		= aiColor4D(U, V, 1.0f, 1.0f);
+		}
+	}
+	Mesh->mNumFaces = 2 * (Side - 1) * (Side - 1);
+	Mesh->mFaces = new aiFace[Mesh->mNumFaces];
+	uint f = 0;
+	for (uint j = 0; j + 1 < Side; j++) {
+		for (uint i = 0; i + 1 < Side; i++) {
+			uint v = i + j * Side;
+			uint Quad[2][3] = { { v, v + Side, v + 1 }, { v + 1, v + Side, v + Side + 1 } };
+			for (auto& Triangle : Quad) {
+				aiFace& Face = Mesh->mFaces[f++];
+				Face.mNumIndices = 3;
+				Face.mIndices = new unsigned int[3];
+				std::memcpy(Face.mIndices, Triangle, sizeof(Triangle));
+			}
+		}
+	}
+	return Mesh;
+}
+
+// The conversion as it was before attribute checks were hoisted out of the vertex loop,
+// kept as the baseline mesh_convert is compared against.
+static void reference_convert(const aiMesh* aMesh, gfx::mesh& aResult) {
+	aResult.Vertex = std::vector<gfx::mesh::vertex>(aMesh->mNumVertices);
+	for (size_t i = 0; i < aResult.Vertex.size(); i++) {
+		gfx::mesh::vertex& Vertex = aResult.Vertex[i];
+		if (aMesh->HasPositions()) {
+			Vertex.Position = { aMesh->mVertices[i].x, aMesh->mVertices[i].y, aMesh->mVertices[i].z };
+		}
+		if (aMesh->HasNormals()) {
+			Vertex.Normal = { aMesh->mNormals[i].x, aMesh->mNormals[i].y, aMesh->mNormals[i].z };
+		}
+		if (aMesh->HasTangentsAndBitangents()) {
+			Vertex.Tangent = { aMesh->mTangents[i].x, aMesh->mTangents[i].y, aMesh->mTangents[i].z };
+			Vertex.Bitangent = { aMesh->mBitangents[i].x, aMesh->mBitangents[i].y, aMesh->mBitangents[i].z };
+		}
+		if (aMesh->HasTextureCoords(0)) {
+			Vertex.TextureCoordinate = { aMesh->mTextureCoords[0][i].x, aMesh->mTextureCoords[0][i].y, aMesh->mTextureCoords[0][i].z };
+		}
+		if (aMesh->HasVertexColors(0)) {
+			Vertex.Color += { aMesh->mColors[0][i].r, aMesh->mColors[0][i].g, aMesh->mColors[0][i].b, aMesh->mColors[0][i].a };
+		}
+	}
+	std::vector<uint> Index(aMesh->mNumFaces * 3);
+	for (size_t i = 0; i < aMesh->mNumFaces; i++) {
+		if (aMesh->mFaces[i].mNumIndices != 3) continue;
+		Index[3 * i + 0] = aMesh->mFaces[i].mIndices[0];
+		Index[3 * i + 1] = aMesh->mFaces[i].mIndices[1];
+		Index[3 * i + 2] = aMesh->mFaces[i].mIndices[2];
+	}
+	if (aMesh->mNumVertices <= (1 << 16)) {
+		aResult.Topology.Data16 = std::vector<ushort>(Index.begin(), Index.end());
+	}
+	else {
+		aResult.Topology.Data32 = std::move(Index);
+	}
+}
+
+// Bones spaced along x, each vertex weighted by the (up to four) bones within reach.
+static std::vector<gfx::mesh::bone> make_skeleton(const gfx::mesh& aMesh, size_t aBoneCount) {
+	std::vector<gfx::mesh::bone> Bone(aBoneCount);
+	for (size_t b = 0; b < aBoneCount; b++) {
+		Bone[b].Name = "Bone" + std::to_string(b);
+		Bone[b].Offset = {
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f
+		};
+	}
+	for (size_t v = 0; v < aMesh.Vertex.size(); v++) {
+		float T = aMesh.Vertex[v].Position[0] * (float)(aBoneCount - 1);
+		for (size_t b = 0; b < aBoneCount; b++) {
+			float Weight = 1.0f - std::abs(T - (float)b) / 2.0f;
+			if (Weight > 0.0f) {
+				Bone[b].Vertex.push_back({ (uint)v, Weight });
+			}
+		}
+	}
+	return Bone;
+}
+
+// A chain of bone nodes and a flat set of nodes each holding one skinned instance.
+static gfx::node* make_hierarchy(const gfx::mesh::instance& aInstance, size_t aBoneCount, size_t aInstanceCount) {
+	gfx::node* Root = new gfx::node();
+	Root->Identifier = "Root";
+	Root->Root = Root;
+	gfx::node* Parent = Root;
+	for (size_t b = 0; b < aBoneCount; b++) {
+		gfx::node* Bone = new gfx::node();
+		Bone->Identifier = "Bone" + std::to_string(b);
+		Bone->Root = Root;
+		Bone->Parent = Parent;
+		Bone->TransformToParentDefault(0, 3) = 1.0f / (float)aBoneCount;
+		Bone->TransformToParentCurrent = Bone->TransformToParentDefault;
+		Parent->Child.push_back(Bone);
+		Parent = Bone;
+	}
+	for (size_t i = 0; i < aInstanceCount; i++) {
+		gfx::node* Node = new gfx::node();
+		Node->Identifier = "Instance" + std::to_string(i);
+		Node->Root = Root;
+		Node->Parent = Root;
+		Node->TransformToParentDefault(0, 3) = (float)i;
+		Node->TransformToParentCurrent = Node->TransformToParentDefault;
+		Node->GraphicalMeshInstances.push_back(aInstance);
+		Node->GraphicalMeshInstances.back().Root 	= Root;
+		Node->GraphicalMeshInstances.back().Parent 	= Node;
+		Root->Child.push_back(Node);
+	}
+	return Root;
+}
+
+// Moves the root every frame, so every node and instance is dirty.
+static void animate(gfx::node* aRoot, size_t aFrame) {
+	aRoot->TransformToParentDefault(1, 3) = 0.01f * (float)aFrame;
+	aRoot->TransformToParentCurrent = aRoot->TransformToParentDefault;
+}
+
+static void write_json(FILE* aFile, const parameters& aParameters, const std::vector<result>& aResult) {
+	std::fprintf(aFile, "{\n");
+	std::fprintf(aFile, "\t\"suite\": \"geodesy-gfx-host\",\n");
+	std::fprintf(aFile, "\t\"parameters\": { \"vertices\": %zu, \"bones\": %zu, \"instances\": %zu, \"texture\": %zu, \"iterations\": %zu, \"threads\": %zu },\n",
+		aParameters.VertexCount, aParameters.BoneCount, aParameters.InstanceCount, aParameters.TextureSize, aParameters.Iterations, aParameters.ThreadCount
+	);
+	std::fprintf(aFile, "\t\"results\": [\n");
+	for (size_t i = 0; i < aResult.size(); i++) {
+		const result& R = aResult[i];
+		std::fprintf(aFile, "\t\t{ \"name\": \"%s\", \"iterations\": %zu, \"items\": %zu, \"mean_ms\": %.6f, \"min_ms\": %.6f, \"max_ms\": %.6f, \"items_per_second\": %.1f }%s\n",
+			R.Name.c_str(), R.Iterations, R.Items, 1000.0 * R.Mean, 1000.0 * R.Min, 1000.0 * R.Max,
+			R.Mean > 0.0 ? (double)R.Items / R.Mean : 0.0,
+			i + 1 < aResult.size() ? "," : ""
+		);
+	}
+	std::fprintf(aFile, "\t]\n}\n");
+}
+
+int main(int aArgCount, char* aArgs[]) {
+	parameters Parameters;
+	for (int i = 1; i + 1 < aArgCount; i += 2) {
+		std::string Key = aArgs[i], Value = aArgs[i + 1];
+		size_t Number = (size_t)std::strtoull(Value.c_str(), nullptr, 10);
+		if (Key == "--vertices") 			Parameters.VertexCount = std::max((size_t)4, Number);
+		else if (Key == "--bones") 			Parameters.BoneCount = std::clamp(Number, (size_t)1, (size_t)MAX_BONE_COUNT);
+		else if (Key == "--instances") 		Parameters.InstanceCount = Number;
+		else if (Key == "--texture") 		Parameters.TextureSize = std::max((size_t)1, Number);
+		else if (Key == "--iterations") 	Parameters.Iterations = std::max((size_t)1, Number);
+		else if (Key == "--threads") 		Parameters.ThreadCount = Number;
+		else if (Key == "--font") 			Parameters.Font = Value;
+		else if (Key == "--output") 		Parameters.Output = Value;
+		else if (Key == "--trace") 			Parameters.Trace = Value;
+		else {
+			std::fprintf(stderr, "unknown option %s\n", Key.c_str());
+			return 1;
+		}
+	}
+	std::vector<result> Result;
+
+	// Assimp mesh conversion.
+	aiMesh* SourceMesh = make_grid(Parameters.VertexCount);
+	std::shared_ptr<gfx::mesh> Mesh;
+	Result.push_back(measure("mesh_convert_reference", Parameters.Iterations, SourceMesh->mNumVertices, [&]() {
+		gfx::mesh Reference;
+		reference_convert(SourceMesh, Reference);
+	}));
+	Result.push_back(measure("mesh_convert_single_thread", Parameters.Iterations, SourceMesh->mNumVertices, [&]() {
+		Mesh = std::make_shared<gfx::mesh>(SourceMesh, 1);
+	}));
+	Result.push_back(measure("mesh_convert", Parameters.Iterations, SourceMesh->mNumVertices, [&]() {
+		Mesh = std::make_shared<gfx::mesh>(SourceMesh, Parameters.ThreadCount);
+	}));
+	delete SourceMesh;
+
+	// Per vertex bone weights of a skinned instance.
+	std::vector<gfx::mesh::bone> Skeleton = make_skeleton(*Mesh, Parameters.BoneCount);
+	gfx::mesh::instance Instance;
+	Result.push_back(measure("instance_bone_weights", Parameters.Iterations, Mesh->Vertex.size(), [&]() {
+		Instance = gfx::mesh::instance((uint)Mesh->Vertex.size(), Skeleton, 0, 0);
+	}));
+
+	// Per frame updates of a hierarchy, device writes go to a host backed ring.
+	gfx::node* Root = make_hierarchy(Instance, Parameters.BoneCount, Parameters.InstanceCount);
+	size_t NodeCount = Root->linearize().size();
+	gfx::uniform_ring Ring(nullptr, 2, (Parameters.InstanceCount + 1) * (sizeof(gfx::mesh::instance::uniform_data) + 256));
+	size_t Frame = 0;
+	Result.push_back(measure("node_host_update", Parameters.Iterations, NodeCount, [&]() {
+		animate(Root, Frame++);
+		Root->host_update(1.0 / 60.0, (double)Frame / 60.0);
+	}));
+	// Ring backed device updates write every instance once per frame.
+	animate(Root, Frame++);
+	Root->host_update(1.0 / 60.0, (double)Frame / 60.0);
+	Result.push_back(measure("node_device_update", Parameters.Iterations, Parameters.InstanceCount, [&]() {
+		Ring.begin_frame();
+		for (phys::node* Node : Root->linearize()) {
+			static_cast<gfx::node*>(Node)->device_update(Ring, 1.0 / 60.0, (double)Frame / 60.0);
+		}
+	}));
+	Result.push_back(measure("node_parallel_device_update", Parameters.Iterations, Parameters.InstanceCount, [&]() {
+		Ring.begin_frame();
+		Root->parallel_device_update(1.0 / 60.0, (double)Frame / 60.0, Parameters.ThreadCount, &Ring);
+	}));
+	Result.push_back(measure("gather_instances", Parameters.Iterations, Parameters.InstanceCount, [&]() {
+		std::vector<gfx::mesh::instance*> Gathered = Root->gather_instances();
+		if (Gathered.size() != Parameters.InstanceCount) std::fprintf(stderr, "gather_instances: unexpected count\n");
+	}));
+	delete Root;
+
+	// Unpacking an occlusion/roughness/metallic map into three images.
+	std::shared_ptr<gpu::image> Packed = geodesy::make<gpu::image>(gpu::image::format::R8G8B8A8_UNORM, (uint)Parameters.TextureSize, (uint)Parameters.TextureSize);
+	uchar* Pixel = (uchar*)Packed->HostData;
+	for (size_t i = 0; i < 4 * Parameters.TextureSize * Parameters.TextureSize; i++) {
+		Pixel[i] = (uchar)(i * 2654435761u >> 24);
+	}
+	Result.push_back(measure("material_unpack", Parameters.Iterations, Parameters.TextureSize * Parameters.TextureSize, [&]() {
+		for (int Channel = 0; Channel < 3; Channel++) {
+			gfx::material::extract_channel(Packed, Channel);
+		}
+	}));
+
+	// Glyph rasterization, only with a font to rasterize.
+	if (!Parameters.Font.empty() && gfx::font::initialize()) {
+		Result.push_back(measure("font_rasterize", Parameters.Iterations, 128, [&]() {
+			gfx::font Font(Parameters.Font);
+		}));
+		gfx::font::terminate();
+	}
+
+	if (!Parameters.Trace.empty() && !gfx::trace::write_chrome_json(Parameters.Trace)) {
+		std::fprintf(stderr, "cannot write %s\n", Parameters.Trace.c_str());
+	}
+
+	FILE* File = Parameters.Output.empty() ? stdout : std::fopen(Parameters.Output.c_str(), "w");
+	if (File == nullptr) {
+		std::fprintf(stderr, "cannot write %s\n", Parameters.Output.c_str());
+		return 1;
+	}
+	write_json(File, Parameters, Result);
+	if (File != stdout) std::fclose(File);
+	return 0;
+}
@@ -0,0 +1,56 @@
+// Bins random point and spot lights into clusters, and compares against testing every light per cluster.
+//
+// 	geodesy-bench-light-clusters [light count] [thread count]
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <geodesy/gfx.h>
+
+using namespace geodesy;
+
+int main(int aArgCount, char* aArgs[]) {
+	size_t LightCount 	= aArgCount > 1 ? (size_t)std::strtoul(aArgs[1], nullptr, 10) : 500;
+	size_t ThreadCount 	= aArgCount > 2 ? (size_t)std::strtoul(aArgs[2], nullptr, 10) : 0;
+	size_t FrameCount 	= 16;
+
+	// Lights scattered over a wide, flat level in front of the camera.
+	std::mt19937 Random(1);
+	std::uniform_real_distribution<float> Spread(-200.0f, 200.0f);
+	std::uniform_real_distribution<float> Height(0.0f, 20.0f);
+	std::uniform_real_distribution<float> Intensity(1.0f, 50.0f);
+	std::vector<gfx::model::light> Light(LightCount);
+	for (size_t i = 0; i < LightCount; i++) {
+		Light[i].Type 		= (i % 4 == 3) ? gfx::model::light::SPOT : gfx::model::light::POINT;
+		Light[i].Position 	= { Spread(Random), Height(Random), Spread(Random) + 200.0f };
+		Light[i].Intensity 	= Intensity(Random);
+	}
+
+	gfx::light_clusters::settings Settings;
+	Settings.ThreadCount = ThreadCount;
+	gfx::light_clusters Clustered(Settings), BruteForce(Settings);
+	gfx::light_clusters::camera Camera;
+	double ClusteredTime = 0.0, BruteForceTime = 0.0;
+	for (size_t f = 0; f < FrameCount; f++) {
+		Camera.Position[0] = (float)f;
+		Clustered.build(Light, Camera);
+		BruteForce.build_brute_force(Light, Camera);
+		ClusteredTime 	+= Clustered.Statistics.BuildTime;
+		BruteForceTime 	+= BruteForce.Statistics.BuildTime;
+	}
+
+	bool Match = (Clustered.Index == BruteForce.Index) && (Clustered.Cluster.size() == BruteForce.Cluster.size());
+	for (size_t i = 0; Match && (i < Clustered.Cluster.size()); i++) {
+		Match = (Clustered.Cluster[i].Offset == BruteForce.Cluster[i].Offset) && (Clustered.Cluster[i].Count == BruteForce.Cluster[i].Count);
+	}
+
+	std::printf("lights:         %zu (%zu in view)\n", LightCount, Clustered.Statistics.LightCount);
+	std::printf("clusters:       %u x %u x %u\n", Settings.X, Settings.Y, Settings.Z);
+	std::printf("indices:        %zu, at most %zu per cluster\n", Clustered.Statistics.IndexCount, Clustered.Statistics.MaxClusterCount);
+	std::printf("clustered:      %.3f ms\n", 1000.0 * ClusteredTime / (double)FrameCount);
+	std::printf("brute force:    %.3f ms\n", 1000.0 * BruteForceTime / (double)FrameCount);
+	std::printf("match:          %s\n", Match ? "yes" : "no");
+	return Match ? 0 : 1;
+}
@@ -2,10 +2,26 @@
 #ifndef GEODESY_GFX_H
 #define GEODESY_GFX_H
 
+#include "gfx/animation.h"
+#include "gfx/arena.h"
+#include "gfx/backend.h"
+#include "gfx/compressed_texture.h"
+#include "gfx/crowd.h"
+#include "gfx/draw_list.h"
 #include "gfx/font.h"
+#include "gfx/light_clusters.h"
 #include "gfx/mesh.h"
 #include "gfx/material.h"
+#include "gfx/material_permutations.h"
+#include "gfx/material_table.h"
+#include "gfx/memory_ledger.h"
+#include "gfx/mipmap.h"
 #include "gfx/node.h"
+#include "gfx/texture_streamer.h"
+#include "gfx/trace.h"
+#include "gfx/transparency_sorter.h"
+#include "gfx/uniform_ring.h"
 #include "gfx/model.h"
+#include "gfx/model_loader.h"
 
 #endif // !GEODESY_GFX_H
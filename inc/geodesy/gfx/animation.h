@@ -0,0 +1,113 @@
+#pragma once
+#ifndef GEODESY_GFX_ANIMATION_H
+#define GEODESY_GFX_ANIMATION_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+#include <geodesy/phys.h>
+
+namespace geodesy::gfx {
+
+	// Compressed, immutable form of a phys::animation clip. Keyframes which can
+	// be reconstructed from their neighbours within a tolerance are dropped, and
+	// the remaining keys are quantized. Translation and scale keys are stored as
+	// 16 bit offsets into the range of their track, or as floats when the track is
+	// too wide for 16 bits to hold the tolerance. Rotations use the smallest three
+	// encoding (3 x 15 bits + 2 bit index). Key times are stored as 16 bit fractions
+	// of the clip duration, or as floats for tracks too fast for them. Reduction is checked against the quantized
+	// keys, so the tolerances hold at every source key of the stored clip. Since a clip is never modified once
+	// built, model copies share it by pointer instead of copying the tracks.
+	class animation {
+	public:
+
+		struct settings {
+			float 									PositionTolerance; 		// Max translation error per key (parent space units).
+			float 									RotationTolerance; 		// Max rotation error per key (radians), no tighter than about 1e-4.
+			float 									ScaleTolerance; 		// Max scale error per key.
+			settings();
+		};
+
+		// Key times are fractions of the clip duration, values are fractions of [Minimum, Minimum + Extent].
+		// The Wide arrays replace their 16 bit counterparts in tracks 16 bits cannot hold within tolerance.
+		struct vector_track {
+			math::vec<float, 3> 					Minimum;
+			math::vec<float, 3> 					Extent;
+			std::vector<ushort> 					Time;
+			std::vector<float> 						WideTime; 				// Same scale as Time.
+			std::vector<ushort> 					Value; 					// Three components per key.
+			std::vector<float> 						WideValue; 				// Three components per key, unquantized.
+			// aPhase is the sample time as a fraction of the clip duration.
+			math::vec<float, 3> operator[](double aPhase) const;
+			size_t size() const;
+			size_t key_count() const;
+			double key_phase(size_t aIndex) const;
+		};
+
+		// Smallest three quaternion encoding, the bit 15 of the first two components hold the index of the dropped component.
+		struct rotation_track {
+			std::vector<ushort> 					Time;
+			std::vector<float> 						WideTime; 				// Replaces Time when 16 bit times cannot hold the tolerance.
+			std::vector<ushort> 					Value; 					// Three components per key.
+			math::quaternion<float> operator[](double aPhase) const;
+			size_t size() const;
+			size_t key_count() const;
+			double key_phase(size_t aIndex) const;
+		};
+
+		struct channel {
+			double 									Duration; 				// Copy of the clip duration, used to decode key times.
+			vector_track 							Position;
+			rotation_track 							Rotation;
+			vector_track 							Scaling;
+			channel();
+			// Local transform of the node at a given tick.
+			math::mat<float, 4, 4> operator[](double aTick) const;
+			size_t size() const;
+		};
+
+		// Report comparing a compressed clip against its source.
+		struct statistics {
+			size_t 									SourceKeyCount;
+			size_t 									KeyCount;
+			size_t 									SourceSize; 			// Bytes held by the uncompressed keyframes.
+			size_t 									CompressedSize; 		// Bytes held by the compressed keyframes.
+			float 									MaxPositionError;
+			float 									MaxRotationError; 		// Radians
+			float 									MaxScaleError;
+			statistics();
+			float compression_ratio() const;
+		};
+
+		std::string 								Name;
+		double 										Duration; 				// Duration in ticks.
+		double 										TicksPerSecond;
+		std::map<std::string, channel> 				Channel; 				// Indexed by node identifier.
+
+		animation();
+		animation(const phys::animation& aAnimation, settings aSettings = settings());
+
+		// Returns the local transform of a node at time aTime (seconds), looping over the clip.
+		// Returns false if the clip does not animate the node.
+		bool pose(const std::string& aNodeIdentifier, double aTime, math::mat<float, 4, 4>& aTransform) const;
+		// Tick of the clip at time aTime (seconds), looping over the clip, to index a channel with.
+		double tick(double aTime) const;
+
+		// Rebuilds an uncompressed phys::animation from the remaining keys.
+		phys::animation decompress() const;
+
+		// Total amount of bytes held by the compressed keyframes.
+		size_t size() const;
+
+		// Measures size reduction and maximum track error of a compressed clip against its source. Errors
+		// are per channel, in the local space of each node, not on the posed hierarchy. They are evaluated
+		// at every source key time and at aSampleCount evenly spaced times over the clip.
+		static statistics compare(const phys::animation& aSource, const animation& aCompressed, size_t aSampleCount = 256);
+
+	};
+
+}
+
+#endif // !GEODESY_GFX_ANIMATION_H
@@ -0,0 +1,115 @@
+#pragma once
+#ifndef GEODESY_GFX_ARENA_H
+#define GEODESY_GFX_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include <geodesy/math.h>
+
+namespace geodesy::gfx {
+
+	// Bump allocator for the nodes of a hierarchy and their mesh instance arrays, so
+	// a whole model hierarchy lives in a few contiguous blocks. Frees are only
+	// counted, the memory goes back all at once when the arena is destroyed. An
+	// arena is not thread safe: it is only filled while a scope makes it current,
+	// and only from the thread that opened the scope.
+	class arena {
+	public:
+
+		// Makes aArena the current arena of this thread while alive, scopes nest.
+		class scope {
+		public:
+			scope(arena* aArena);
+			~scope();
+			scope(const scope&) = delete;
+			scope& operator=(const scope&) = delete;
+		private:
+			arena* Previous;
+		};
+
+		// Allocates from the arena that was current when the allocator was created, but
+		// only while that arena is still current on the calling thread. Growth after the
+		// scope has closed goes to the heap, where it is thread safe and freed normally.
+		template <typename T>
+		class allocator {
+		public:
+
+			typedef T value_type;
+			// Copies of a container allocate from the heap, so they may outlive the arena.
+			typedef std::false_type propagate_on_container_copy_assignment;
+
+			arena* Arena;
+
+			allocator() : Arena(arena::current()) {}
+			template <typename U> allocator(const allocator<U>& aOther) : Arena(aOther.Arena) {}
+
+			allocator select_on_container_copy_construction() const {
+				allocator Heap(*this);
+				Heap.Arena = nullptr;
+				return Heap;
+			}
+
+			T* allocate(std::size_t aCount) {
+				if ((this->Arena != nullptr) && (arena::current() == this->Arena)) {
+					return (T*)this->Arena->allocate(aCount * sizeof(T), alignof(T));
+				}
+				return (T*)::operator new(aCount * sizeof(T));
+			}
+
+			void deallocate(T* aPointer, std::size_t aCount) {
+				if ((this->Arena != nullptr) && this->Arena->owns(aPointer)) {
+					this->Arena->release();
+				}
+				else {
+					::operator delete(aPointer);
+				}
+			}
+
+			template <typename U> bool operator==(const allocator<U>& aOther) const { return this->Arena == aOther.Arena; }
+			template <typename U> bool operator!=(const allocator<U>& aOther) const { return this->Arena != aOther.Arena; }
+
+		};
+
+		arena(std::size_t aBlockSize = 64 * 1024);
+		~arena();
+		arena(const arena&) = delete;
+		arena& operator=(const arena&) = delete;
+
+		void* allocate(std::size_t aSize, std::size_t aAlignment = alignof(std::max_align_t));
+		// Counts a free, the memory is reclaimed when the arena is destroyed.
+		void release();
+		// True if aPointer lies in one of the arena's blocks.
+		bool owns(const void* aPointer) const;
+
+		std::size_t size() const; 			// Bytes handed out.
+		std::size_t capacity() const; 		// Bytes reserved in blocks.
+		std::size_t block_count() const;
+		std::size_t live_count() const; 	// Allocations not yet released.
+
+		// Arena of the innermost scope on this thread, or null.
+		static arena* current();
+
+	private:
+
+		struct block {
+			std::unique_ptr<uchar[]> 	Data;
+			std::size_t 				Size;
+		};
+
+		std::size_t 				BlockSize;
+		std::vector<block> 			Block;
+		std::size_t 				Offset; 		// Into the last block.
+		std::size_t 				Used;
+		std::size_t 				Capacity;
+		std::atomic<std::size_t> 	LiveCount;
+
+	};
+
+}
+
+#endif // !GEODESY_GFX_ARENA_H
@@ -0,0 +1,79 @@
+#pragma once
+#ifndef GEODESY_GFX_BACKEND_H
+#define GEODESY_GFX_BACKEND_H
+
+#include <atomic>
+#include <memory>
+
+#include <geodesy/gpu/context.h>
+#include <geodesy/gpu/buffer.h>
+#include <geodesy/gpu/image.h>
+
+#include "memory_ledger.h"
+
+namespace geodesy::gfx {
+
+	// Creates the device resources of gfx objects. Device constructors go through the
+	// backend returned by get() instead of the context, so a null backend can be
+	// installed to run the whole load, upload and update path on host memory, with
+	// every call and byte counted, on machines without a GPU.
+	class backend {
+	public:
+
+		struct statistics {
+			std::atomic<size_t> 		BufferCount;
+			std::atomic<size_t> 		BufferBytes;
+			std::atomic<size_t> 		ImageCount;
+			std::atomic<size_t> 		ImageBytes; 	// Every layer and mip level, in the image's format.
+			std::atomic<size_t> 		MapCount;
+			std::atomic<size_t> 		MapBytes;
+			statistics();
+			void reset();
+		};
+
+		statistics 						Statistics;
+		// Optional, attributes every buffer and image to its owner until the resource is destroyed.
+		std::shared_ptr<memory_ledger> 	Ledger;
+
+		virtual ~backend();
+
+		std::shared_ptr<gpu::buffer> create_buffer(const std::shared_ptr<gpu::context>& aContext, gpu::buffer::create_info aCreateInfo, size_t aSize, const void* aData, memory_ledger::category aCategory = memory_ledger::OTHER);
+		std::shared_ptr<gpu::image> create_image(const std::shared_ptr<gpu::context>& aContext, gpu::image::create_info aCreateInfo, const std::shared_ptr<gpu::image>& aHostImage, memory_ledger::category aCategory = memory_ledger::TEXTURE);
+		// Maps aBuffer for host access and returns the address of aOffset. Mapped from offset
+		// zero, aBuffer.Ptr holds the same address.
+		void* map(gpu::buffer& aBuffer, size_t aOffset, size_t aSize);
+
+		// Replaces the device backend for every context, null restores it. Install before
+		// creating device objects, objects keep the resources they were created with.
+		static void install(std::shared_ptr<backend> aBackend);
+		// The installed backend, else the device backend when aContext is set, else null for host only objects.
+		static backend* get(const std::shared_ptr<gpu::context>& aContext);
+
+	protected:
+
+		virtual std::shared_ptr<gpu::buffer> make_buffer(const std::shared_ptr<gpu::context>& aContext, gpu::buffer::create_info aCreateInfo, size_t aSize, const void* aData) = 0;
+		virtual std::shared_ptr<gpu::image> make_image(const std::shared_ptr<gpu::context>& aContext, gpu::image::create_info aCreateInfo, const std::shared_ptr<gpu::image>& aHostImage) = 0;
+		virtual void* map_buffer(gpu::buffer& aBuffer, size_t aOffset, size_t aSize) = 0;
+
+	};
+
+	// Forwards to the context.
+	class device_backend : public backend {
+	protected:
+		std::shared_ptr<gpu::buffer> make_buffer(const std::shared_ptr<gpu::context>& aContext, gpu::buffer::create_info aCreateInfo, size_t aSize, const void* aData) override;
+		std::shared_ptr<gpu::image> make_image(const std::shared_ptr<gpu::context>& aContext, gpu::image::create_info aCreateInfo, const std::shared_ptr<gpu::image>& aHostImage) override;
+		void* map_buffer(gpu::buffer& aBuffer, size_t aOffset, size_t aSize) override;
+	};
+
+	// Buffers are host allocations that are always mapped, images stay the host image.
+	// The context may be null.
+	class null_backend : public backend {
+	protected:
+		std::shared_ptr<gpu::buffer> make_buffer(const std::shared_ptr<gpu::context>& aContext, gpu::buffer::create_info aCreateInfo, size_t aSize, const void* aData) override;
+		std::shared_ptr<gpu::image> make_image(const std::shared_ptr<gpu::context>& aContext, gpu::image::create_info aCreateInfo, const std::shared_ptr<gpu::image>& aHostImage) override;
+		void* map_buffer(gpu::buffer& aBuffer, size_t aOffset, size_t aSize) override;
+	};
+
+}
+
+#endif // !GEODESY_GFX_BACKEND_H
@@ -0,0 +1,93 @@
+#pragma once
+#ifndef GEODESY_GFX_COMPRESSED_TEXTURE_H
+#define GEODESY_GFX_COMPRESSED_TEXTURE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <geodesy/math.h>
+#include <geodesy/gpu/image.h>
+
+#include "material.h"
+
+namespace geodesy::gfx {
+
+	// CPU block compression of RGBA8 texture data into BC1, BC4, BC5 or BC7. The
+	// format is picked per material texture slot: BC5 for normal maps (the third
+	// component is reconstructed in the shader), BC4 for scalar maps, and BC7 or
+	// BC1 for color depending on whether it carries alpha. The BC7 encoder only
+	// emits mode 6 (single subset RGBA with 4 bit indices). Block rows are encoded
+	// in parallel, and encoded results can be shared through a cache keyed by a
+	// hash of the source pixels. compress() runs the whole pipeline for one
+	// material texture slot, and returns a block compressed gpu::image holding
+	// every mip level.
+	class compressed_texture {
+	public:
+
+		enum format : int {
+			BC1, 			// RGB, 4 bpp
+			BC4, 			// R, 4 bpp
+			BC5, 			// RG, 8 bpp
+			BC7 			// RGBA, 8 bpp
+		};
+
+		// Shares encoded textures between materials using identical source pixels.
+		class cache {
+		public:
+
+			size_t 												HitCount;
+			size_t 												MissCount;
+
+			cache();
+
+			std::shared_ptr<const compressed_texture> get(const uchar* aData, uint aWidth, uint aHeight, int aFormat, size_t aThreadCount = 0);
+			size_t size();
+			void clear();
+
+		private:
+
+			std::mutex 											Mutex;
+			std::unordered_map<uint64_t, std::shared_ptr<const compressed_texture>> Entry;
+
+		};
+
+		int 													Format;
+		uint 													Width;
+		uint 													Height;
+		uint64_t 												SourceHash;
+		std::vector<uchar> 										Data; 		// Blocks in row major order.
+		float 													PSNR; 		// dB over the channels the format stores.
+
+		compressed_texture();
+		// Encodes RGBA8 pixels.
+		compressed_texture(const uchar* aData, uint aWidth, uint aHeight, int aFormat, size_t aThreadCount = 0);
+
+		// Decodes back to RGBA8.
+		std::vector<uchar> decode() const;
+
+		// Size of one 4x4 block in bytes.
+		static size_t block_size(int aFormat);
+		// Block format stored by a gpu::image::format, or -1 if it is not block compressed.
+		static int from_image_format(int aImageFormat);
+		// gpu::image::format storing aFormat blocks, sRGB where the format has an sRGB variant.
+		static int image_format(int aFormat, bool aSRGB);
+		// Builds the mip chain of an RGBA8 image used in aSlot, picks the slot's format and encodes
+		// every level through aCache when given. Returns null for images without host data, or
+		// that are not single layer 2D RGBA8.
+		static std::shared_ptr<gpu::image> compress(const gpu::image& aImage, material::texture_slot aSlot, cache* aCache = nullptr, size_t aThreadCount = 0);
+		// Picks the format for a material texture slot.
+		static int select_format(material::texture_slot aSlot, bool aHasAlpha);
+		static bool has_alpha(const uchar* aData, uint aWidth, uint aHeight);
+		// Peak signal to noise ratio between two RGBA8 images over the channels of aFormat.
+		static float psnr(const uchar* aReference, const uchar* aTest, uint aWidth, uint aHeight, int aFormat);
+		static uint64_t hash(const uchar* aData, uint aWidth, uint aHeight, int aFormat);
+
+	};
+
+}
+
+#endif // !GEODESY_GFX_COMPRESSED_TEXTURE_H
@@ -0,0 +1,90 @@
+#pragma once
+#ifndef GEODESY_GFX_CROWD_H
+#define GEODESY_GFX_CROWD_H
+
+#include <memory>
+#include <vector>
+
+#include "animation.h"
+#include "model.h"
+
+namespace geodesy::gfx {
+
+	// A crowd is a large number of copies of a single prototype model. Members
+	// share every mesh, material, texture and vertex weight buffer of the
+	// prototype, and only own their transform and animation state. The pose of
+	// every member is packed into one instance buffer, so each mesh instance of
+	// the prototype can be drawn for the whole crowd with a single instanced draw.
+	class crowd {
+	public:
+
+		// The only per copy state of a crowd member.
+		struct member {
+			math::mat<float, 4, 4> 						Transform; 			// Member space to world space.
+			int 										Animation; 			// Index into Clip, -1 for bind pose.
+			double 										Time; 				// Playback time in seconds.
+			member();
+		};
+
+		// One instanced draw per mesh instance of the prototype whose node is in its hierarchy.
+		// For member m, the element at Offset + m * Stride holds: the member transform, the mesh
+		// instance node transform (model space), followed by BoneCount skinning matrices (model
+		// space bone transform times the bone offset), so the shader needs no BoneOffset data.
+		struct batch {
+			const mesh::instance* 						Instance; 			// Prototype mesh instance, owns the vertex weight buffer.
+			int 										MeshIndex;
+			uint 										MaterialIndex;
+			size_t 										BoneCount;
+			size_t 										Offset; 			// Byte offset of member 0 in the instance buffer.
+			size_t 										Stride; 			// Bytes per member.
+			batch();
+		};
+
+		std::shared_ptr<gpu::context> 					Context;
+		std::shared_ptr<model> 							Prototype;
+		std::vector<std::shared_ptr<const animation>> 	Clip; 				// Shared with the prototype when compressed clips exist.
+		std::vector<member> 							Member;
+		std::vector<batch> 								Batch;
+		std::shared_ptr<gpu::buffer> 					InstanceBuffer; 	// Persistently mapped, null without a context.
+		std::vector<uchar> 								HostInstanceData; 	// Used instead of InstanceBuffer without a context.
+		size_t 											ThreadCount; 		// Members posed in parallel, zero uses one thread per hardware thread.
+
+		crowd();
+		crowd(std::shared_ptr<gpu::context> aContext, std::shared_ptr<model> aPrototype, size_t aCapacity = 0);
+
+		// Adds a member and returns its index.
+		size_t add(math::mat<float, 4, 4> aTransform, int aAnimation = -1, double aTime = 0.0);
+		// Removes a member by moving the last member into its slot.
+		void remove(size_t aIndex);
+		// Grows the instance buffer to hold at least aCapacity members.
+		void reserve(size_t aCapacity);
+		size_t capacity() const;
+		size_t size() const;
+
+		// Advances playback, poses every member and writes the instance data.
+		void update(double aDeltaTime);
+
+		// Pointer to the packed per instance data.
+		void* data();
+
+	private:
+
+		// Prototype hierarchy flattened in pre-order, so parents are always posed first.
+		std::vector<const phys::node*> 					Node;
+		std::vector<int> 								ParentIndex;
+		std::vector<int> 								InstanceNodeIndex; 	// Per batch
+		std::vector<std::vector<int>> 					BoneNodeIndex; 		// Per batch
+		std::vector<std::vector<math::mat<float, 4, 4>>> BoneOffset; 		// Per batch
+		std::vector<std::vector<const animation::channel*>> ClipChannel; 	// Per clip, per node, null if the clip does not animate it.
+		std::vector<std::vector<math::mat<float, 4, 4>>> NodeTransform; 	// Per thread scratch space for one member pose.
+		size_t 											Capacity;
+
+		void flatten(const phys::node* aNode, int aParentIndex);
+		int index_of(const phys::node* aNode) const;
+		void layout();
+
+	};
+
+}
+
+#endif // !GEODESY_GFX_CROWD_H
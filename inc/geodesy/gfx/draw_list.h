@@ -0,0 +1,104 @@
+#pragma once
+#ifndef GEODESY_GFX_DRAW_LIST_H
+#define GEODESY_GFX_DRAW_LIST_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <geodesy/math.h>
+
+#include "mesh.h"
+#include "material.h"
+
+namespace geodesy::gfx {
+
+	class model;
+
+	// Orders mesh instances for submission. Every draw gets a 64 bit key, and the
+	// keys are radix sorted in parallel. Consecutive draws of the same pipeline,
+	// material and mesh are then merged into instanced batches.
+	//
+	// Opaque and alpha tested key, most significant first:
+	// 	transparency (2) | pipeline (10) | material (16) | mesh (16) | depth (20, front to back)
+	// Translucent key:
+	// 	transparency (2) | depth (24, back to front) | pipeline (10) | material (14) | mesh (14)
+	// so state changes are minimized for opaque draws, and blended draws stay in depth order.
+	// Material and mesh ids are assigned per build(), ids past a field's range share its
+	// largest value and are counted in SaturatedKeyCount.
+	class draw_list {
+	public:
+
+		struct draw {
+			const mesh::instance* 		Instance;
+			const mesh* 				Mesh;
+			const material* 			Material;
+			uint 						Pipeline;
+			float 						Depth; 			// View space distance along the camera forward axis.
+			uint 						MaterialKey; 	// Dense ids assigned by build().
+			uint 						MeshKey;
+		};
+
+		// A run of draws sharing pipeline, material and mesh, issued as one instanced draw.
+		struct batch {
+			int 						Transparency;
+			uint 						Pipeline;
+			const mesh* 				Mesh;
+			const material* 			Material;
+			uint 						First; 			// Into Order.
+			uint 						Count;
+		};
+
+		struct statistics {
+			size_t 						DrawCount;
+			size_t 						BatchCount;
+			size_t 						StateChangeCount; 	// Pipeline or material changes between batches.
+			size_t 						SortPassCount; 		// Radix passes not skipped.
+			size_t 						SaturatedKeyCount; 	// Draws whose material or mesh id did not fit its key field.
+			double 						KeyTime; 			// Seconds.
+			double 						SortTime;
+			double 						BatchTime;
+			statistics();
+		};
+
+		float 							FarDistance; 	// Depths are quantized over [0, FarDistance].
+		size_t 							ThreadCount; 	// Zero uses one thread per hardware thread.
+
+		std::vector<draw> 				Draw; 			// In submission order.
+		std::vector<uint64_t> 			Key; 			// Sorted keys.
+		std::vector<uint> 				Order; 			// Indices into Draw, sorted by key.
+		std::vector<batch> 				Batch;
+		statistics 						Statistics;
+
+		draw_list();
+
+		// Drops the draws of the previous frame.
+		void clear();
+		void add(const mesh::instance* aInstance, const mesh* aMesh, const material* aMaterial, uint aPipeline, float aDepth);
+		// Adds every mesh instance of aModel, depth is the distance of the mesh's world space center
+		// of mass from aCameraPosition along aCameraForward.
+		void add(model& aModel, uint aPipeline, math::vec<float, 3> aCameraPosition, math::vec<float, 3> aCameraForward);
+
+		// Builds the keys, sorts them and merges batches.
+		void build();
+
+		// Key of a single draw.
+		uint64_t key(const draw& aDraw) const;
+
+		// Sorts aKey in place with a parallel LSD radix sort, carrying aValue along. Byte
+		// positions where every key agrees are skipped. Returns the number of passes done.
+		static size_t radix_sort(std::vector<uint64_t>& aKey, std::vector<uint>& aValue, size_t aThreadCount = 0);
+
+	private:
+
+		std::unordered_map<const material*, uint> 		MaterialID;
+		std::unordered_map<const mesh*, uint> 			MeshID;
+
+		uint material_id(const material* aMaterial);
+		uint mesh_id(const mesh* aMesh);
+
+	};
+
+}
+
+#endif // !GEODESY_GFX_DRAW_LIST_H
@@ -42,11 +42,12 @@ namespace geodesy::gfx {
 
 		~font();
 
-	private:
-
+		// Loads and releases the FreeType library, fonts can only be created in between.
 		static bool initialize();
 		static bool terminate();
 
+	private:
+
 		int m, n, l;
 		void* hptr;
 		float* sx;
@@ -0,0 +1,117 @@
+#pragma once
+#ifndef GEODESY_GFX_LIGHT_CLUSTERS_H
+#define GEODESY_GFX_LIGHT_CLUSTERS_H
+
+#include <vector>
+
+#include <geodesy/math.h>
+
+#include "model.h"
+
+namespace geodesy::gfx {
+
+	// Bins local lights into view space clusters (froxels) so a shader only walks the
+	// lights that can reach its cluster. The view frustum is split into X by Y tiles
+	// in screen space and Z slices spaced exponentially in depth. Point, spot and area
+	// lights are bound by a sphere whose radius is where their intensity falls below
+	// Threshold, ambient and directional lights apply everywhere and are listed apart.
+	//
+	// A shader finds its cluster with
+	// 	x = floor(ScreenUV.x * X), y = floor(ScreenUV.y * Y), z = floor(log(ViewDepth) * ScaleZ + BiasZ)
+	// and reads Cluster[x + X * (y + Y * z)], whose lights are Index[Offset, Offset + Count).
+	class light_clusters {
+	public:
+
+		struct camera {
+			math::vec<float, 3> 		Position;
+			math::vec<float, 3> 		Right; 			// Orthonormal view basis.
+			math::vec<float, 3> 		Up;
+			math::vec<float, 3> 		Forward;
+			float 						FieldOfView; 	// Vertical, radians.
+			float 						AspectRatio; 	// Width over height.
+			float 						Near;
+			float 						Far;
+			camera();
+		};
+
+		struct settings {
+			uint 						X;
+			uint 						Y;
+			uint 						Z;
+			float 						Threshold; 		// Intensity at which a light's reach ends.
+			float 						MaxRange; 		// Upper bound on a light's reach.
+			size_t 						ThreadCount; 	// Zero uses one thread per hardware thread.
+			settings();
+		};
+
+		// Laid out for a storage buffer.
+		struct cluster {
+			alignas(4) uint 			Offset; 		// Into Index.
+			alignas(4) uint 			Count;
+		};
+
+		// Grid parameters for the shader, laid out for a uniform buffer.
+		struct uniform_data {
+			alignas(4) uint 			X;
+			alignas(4) uint 			Y;
+			alignas(4) uint 			Z;
+			alignas(4) uint 			GlobalCount;
+			alignas(4) float 			ScaleZ;
+			alignas(4) float 			BiasZ;
+			alignas(4) float 			Near;
+			alignas(4) float 			Far;
+		};
+
+		struct statistics {
+			size_t 						LightCount; 		// Clustered lights in front of the camera.
+			size_t 						IndexCount;
+			size_t 						MaxClusterCount; 	// Most lights in a single cluster.
+			double 						BuildTime; 			// Seconds.
+			statistics();
+		};
+
+		settings 						Settings;
+		uniform_data 					UniformData;
+		std::vector<cluster> 			Cluster;
+		std::vector<uint> 				Index; 		// Light indices, ascending within a cluster.
+		std::vector<uint> 				Global; 	// Ambient and directional lights.
+		statistics 						Statistics;
+
+		light_clusters(settings aSettings = settings());
+
+		// Bins aLight, given in world space, for the view of aCamera. Slices are binned in parallel.
+		void build(const std::vector<model::light>& aLight, const camera& aCamera);
+		// Same result as build(), testing every light against every cluster. For reference and benchmarks.
+		void build_brute_force(const std::vector<model::light>& aLight, const camera& aCamera);
+
+		// Reach of a light, the distance at which Intensity * max(Color) / d^2 drops to Threshold.
+		float range(const model::light& aLight) const;
+
+	private:
+
+		struct bounds {
+			math::vec<float, 3> 		Min;
+			math::vec<float, 3> 		Max;
+		};
+
+		// A clustered light in view space, with the clusters its bounds can touch.
+		struct view_light {
+			uint 						Light;
+			math::vec<float, 3> 		Center;
+			float 						Radius;
+			uint 						Begin[3];
+			uint 						End[3]; 	// Inclusive.
+		};
+
+		std::vector<bounds> 			Bounds; 	// Per cluster, view space.
+		std::vector<view_light> 		ViewLight;
+
+		void prepare(const std::vector<model::light>& aLight, const camera& aCamera);
+		bool overlaps(const view_light& aLight, uint aX, uint aY, uint aZ) const;
+		void finish(const std::vector<uint>& aCount);
+
+	};
+
+}
+
+#endif // !GEODESY_GFX_LIGHT_CLUSTERS_H
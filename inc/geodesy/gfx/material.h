@@ -2,6 +2,7 @@
 #ifndef GEODESY_GFX_MATERIAL_H
 #define GEODESY_GFX_MATERIAL_H
 
+#include <array>
 #include <string>
 #include <vector>
 
@@ -15,6 +16,9 @@ struct aiMaterial;
 
 namespace geodesy::gfx {
 
+	class uniform_ring;
+	class material_table;
+
 
 	// A material describes the qualities of a surface, such as 
 	// its roughness, its 
@@ -33,6 +37,49 @@ namespace geodesy::gfx {
 			TRANSLUCENT
 		};
 
+		// Shading features a material actually uses, derived from its uniform data. Materials
+		// with equal masks can share one pipeline specialized on them. Bits 10 and 11 hold
+		// the transparency class.
+		enum feature : uint {
+			ALBEDO_TEXTURE 					= 1u << 0,
+			OPACITY_TEXTURE 				= 1u << 1,
+			NORMAL_TEXTURE 					= 1u << 2,
+			HEIGHT_MAPPING 					= 1u << 3,
+			EMISSIVE_TEXTURE 				= 1u << 4,
+			AMBIENT_OCCLUSION_TEXTURE 		= 1u << 5,
+			ROUGHNESS_TEXTURE 				= 1u << 6,
+			METALLIC_TEXTURE 				= 1u << 7,
+			VERTEX_COLOR 					= 1u << 8,
+			EMISSION 						= 1u << 9,
+			TRANSPARENCY_SHIFT 				= 10,
+			TRANSPARENCY_MASK 				= 3u << TRANSPARENCY_SHIFT
+		};
+
+		// Texture slots, in the order of TextureTypeDatabase.
+		enum texture_slot : int {
+			ALBEDO,
+			OPACITY,
+			NORMAL,
+			HEIGHT,
+			AMBIENT_LIGHTING,
+			EMISSIVE,
+			SPECULAR,
+			SHININESS,
+			AMBIENT_OCCLUSION,
+			ROUGHNESS,
+			METALLIC,
+			SHEEN,
+			CLEAR_COAT,
+			TEXTURE_SLOT_COUNT
+		};
+
+		// One entry per slot holding an image, Binding is the first texture binding plus the slot.
+		struct texture_binding {
+			uint 								Binding;
+			texture_slot 						Slot;
+			gpu::image* 						Image;
+		};
+
 		// enum orm_packing : int {};
 
 		struct uniform_data {
@@ -80,20 +127,53 @@ namespace geodesy::gfx {
 			alignas(4) float 							MetallicConstantWeight;
 			alignas(4) float 							Metallic;
 
+			// Every field as a 32 bit word, struct padding is left out so equal data compares equal.
+			static constexpr size_t WordCount = 38;
+
 			uniform_data();
+			std::array<uint32_t, WordCount> words() const;
+			bool operator==(const uniform_data& aData) const;
+			bool operator!=(const uniform_data& aData) const;
 		};
 
 		std::string 											Name;					// Name of the material
 		uniform_data 											UniformData;
 		std::shared_ptr<gpu::buffer> 							UniformBuffer;			// Uniform Buffer for the Material
-		std::map<std::string, std::shared_ptr<gpu::image>> 		Texture;				// Texture Maps of the Material
+		std::array<std::shared_ptr<gpu::image>, TEXTURE_SLOT_COUNT> 	Texture;		// Texture Maps of the Material, by texture_slot
+		std::vector<texture_binding> 							TextureBinding;			// Occupied slots in binding order, rebuilt by update_texture_bindings.
+		size_t 													DynamicOffset;			// Offset of UniformData in a uniform_ring, when updated through one.
+		std::shared_ptr<material_table> 						Table;					// Replaces UniformBuffer when set.
+		uint 													TableIndex;				// Entry of UniformData in Table.
 
 		material();
 		// material(const aiMaterial* aMaterial, std::string aDirectory, io::file::manager* aFileManager);
+		// Host material, textures are loaded relative to aDirectory.
+		material(const aiMaterial* aMaterial, std::string aDirectory);
 		material(std::shared_ptr<gpu::context> aContext, gpu::image::create_info aCreateInfo, std::shared_ptr<material> aMaterial);
+		// Stores the uniform data in entry aTableIndex of aTable instead of creating a uniform buffer.
+		material(std::shared_ptr<gpu::context> aContext, gpu::image::create_info aCreateInfo, std::shared_ptr<material> aMaterial, std::shared_ptr<material_table> aTable, uint aTableIndex);
 		~material();
 
+		// Rebuilds TextureBinding, call after replacing textures.
+		void update_texture_bindings(uint aFirstBinding = 0);
+
+		// Feature mask of the current uniform data, recomputed on every call.
+		uint features() const;
+		static uint features(const uniform_data& aUniformData);
+
 		void update(double aDeltaTime);
+		// Writes the uniform data into the current frame of aRing and records its dynamic offset.
+		// Returns false if the ring was full, DynamicOffset is then SIZE_MAX and the material
+		// must not be drawn from the ring this frame.
+		bool update(double aDeltaTime, uniform_ring& aRing);
+
+		// Copies one channel of an RGBA8 image into the color channels of a new image, used to unpack packed PBR maps.
+		static std::shared_ptr<gpu::image> extract_channel(const std::shared_ptr<gpu::image>& aImage, int aChannel);
+
+		// "Albedo", "Normal", ... as named by the importer.
+		static const char* texture_slot_name(texture_slot aSlot);
+		// The slot named aName, TEXTURE_SLOT_COUNT if there is none.
+		static texture_slot find_texture_slot(const std::string& aName);
 
 	};
 
@@ -0,0 +1,72 @@
+#pragma once
+#ifndef GEODESY_GFX_MATERIAL_PERMUTATIONS_H
+#define GEODESY_GFX_MATERIAL_PERMUTATIONS_H
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "material.h"
+
+namespace geodesy::gfx {
+
+	class model;
+
+	// Assigns every distinct material feature mask a dense permutation index, so a
+	// renderer can keep one pipeline per index, specialized with the permutation's
+	// constants, instead of one uber shader that branches on every uniform flag.
+	class material_permutations {
+	public:
+
+		// Specialization constants, constant_id i is Constant[i]. Ids 0 to 9 are the feature
+		// bits as booleans, id 10 is the transparency class.
+		static constexpr size_t ConstantCount = 11;
+
+		struct permutation {
+			uint 								Features;
+			uint 								Index;
+			size_t 								MaterialCount; 		// Materials added with this mask.
+			std::array<uint32_t, ConstantCount> Constant;
+		};
+
+		struct statistics {
+			size_t 			MaterialCount;
+			size_t 			PermutationCount;
+			size_t 			LookupCount;
+			size_t 			HitCount; 			// Lookups that found an existing permutation.
+			statistics();
+		};
+
+		material_permutations();
+
+		// Index of the permutation for aFeatures, created on first use. Thread safe.
+		uint get(uint aFeatures);
+		// Looks up the mask of aMaterial and counts it as a user of the permutation.
+		uint add(const material& aMaterial);
+		// Permutation index of every material of aModel, by material index.
+		std::vector<uint> add(const model& aModel);
+
+		// The permutation with index aIndex, stable once created.
+		permutation operator[](uint aIndex) const;
+		size_t size() const;
+		statistics get_statistics() const;
+		void clear();
+
+		static std::array<uint32_t, ConstantCount> constants(uint aFeatures);
+
+	private:
+
+		mutable std::mutex 						Mutex;
+		std::unordered_map<uint, uint> 			Index;
+		std::vector<permutation> 				Permutation;
+		statistics 								Statistics;
+
+		uint find(uint aFeatures);
+
+	};
+
+}
+
+#endif // !GEODESY_GFX_MATERIAL_PERMUTATIONS_H
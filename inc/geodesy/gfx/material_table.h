@@ -0,0 +1,85 @@
+#pragma once
+#ifndef GEODESY_GFX_MATERIAL_TABLE_H
+#define GEODESY_GFX_MATERIAL_TABLE_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <geodesy/gpu/context.h>
+#include <geodesy/gpu/buffer.h>
+
+#include "material.h"
+
+namespace geodesy::gfx {
+
+	// Holds the uniform data of many materials in one storage buffer, indexed by
+	// material. Shaders look materials up by index instead of binding a uniform
+	// buffer per material, so draws with different materials can share one
+	// descriptor set. Only entries that changed are copied on update. A model
+	// reserves a contiguous range of entries, so the table index of a mesh
+	// instance is model::MaterialTableOffset + mesh::instance::MaterialIndex, and
+	// returns it when destroyed. Released ranges are reused by later allocations.
+	//
+	// Like uniform_ring, the buffer holds one copy of the table per frame in flight
+	// and every update brings the next copy up to date, so the CPU never writes a
+	// copy the GPU may still read. Bind the buffer at Offset after each update. The
+	// caller must wait on the fence of the frame that last read a copy before the
+	// update that reuses it.
+	class material_table {
+	public:
+
+		std::shared_ptr<gpu::context> 				Context;
+		std::shared_ptr<gpu::buffer> 				Buffer; 		// Null without a context.
+		std::vector<material::uniform_data> 		Data; 			// Host copy of every entry.
+		size_t 										FrameCount; 	// Copies of the table in Buffer.
+		size_t 										Offset; 		// Byte offset of the copy written by the last update.
+		size_t 										Generation; 	// Incremented whenever Buffer is recreated, descriptors must be rewritten.
+
+		material_table();
+		material_table(std::shared_ptr<gpu::context> aContext, size_t aCapacity = 256, size_t aFrameCount = 2);
+
+		// Reserves aCount contiguous entries and returns the index of the first one, the first
+		// released range large enough is reused before the table grows.
+		uint allocate(size_t aCount);
+		// Returns aCount entries starting at aFirst, they must not be written afterwards.
+		void release(uint aFirst, size_t aCount);
+		// Copies aData into an entry, only marks it for upload if it changed.
+		void write(uint aIndex, const material::uniform_data& aData);
+		// Starts the next frame and copies the entries changed since its copy was last written,
+		// returns how many were written.
+		size_t update();
+
+		// Entries up to the last one in use, including released ranges below it.
+		size_t size() const;
+		size_t capacity() const;
+
+	private:
+
+		struct range {
+			uint 									First;
+			size_t 									Count;
+		};
+
+		struct retired {
+			size_t 									Serial; 		// Update that replaced the buffer.
+			std::shared_ptr<gpu::buffer> 			Buffer;
+		};
+
+		std::mutex 									Mutex;
+		std::vector<std::vector<uint>> 				DirtyIndex; 	// Per copy, entries changed since it was last written.
+		std::vector<std::vector<bool>> 				Dirty;
+		std::vector<retired> 						Retired; 		// Replaced buffers frames in flight may still read.
+		std::vector<range> 							Free; 			// Released ranges below Data.size(), sorted and coalesced.
+		size_t 										Capacity;
+		size_t 										CopySize; 		// Bytes per copy, aligned for storage buffer offsets.
+		size_t 										Serial;
+		bool 										Reallocate;
+
+		void mark(uint aIndex);
+
+	};
+
+}
+
+#endif // !GEODESY_GFX_MATERIAL_TABLE_H
@@ -0,0 +1,110 @@
+#pragma once
+#ifndef GEODESY_GFX_MEMORY_LEDGER_H
+#define GEODESY_GFX_MEMORY_LEDGER_H
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace geodesy::gfx {
+
+	// Attributes the device memory created through a backend to its owner. Constructors
+	// open an owner scope on the creating thread (model, then mesh or material), nested
+	// scopes form a path like "sponza.gltf/mesh:floor", and every buffer and image made
+	// inside is recorded under that path with a category, until the resource is destroyed.
+	// Each scope is one path component, '/' and '%' in its name are escaped as %2F and %25.
+	class memory_ledger {
+	public:
+
+		enum category : int {
+			VERTEX_BUFFER,
+			INDEX_BUFFER,
+			VERTEX_WEIGHT,
+			INSTANCE_UNIFORM,
+			MATERIAL_UNIFORM,
+			MATERIAL_TABLE,
+			TEXTURE,
+			UNIFORM_RING,
+			CROWD_INSTANCE,
+			OTHER,
+			CATEGORY_COUNT
+		};
+
+		struct usage {
+			std::string 			Owner; 			// Owner path, "" for allocations made outside any scope.
+			size_t 					Bytes;
+			size_t 					Count;
+			size_t 					Category[CATEGORY_COUNT];
+			usage();
+		};
+
+		// Reported to OnBudgetExceeded by the allocation that crossed a budget.
+		struct violation {
+			std::string 			Owner; 			// Top level owner for owner budgets, else the allocating owner.
+			category 				Category; 		// CATEGORY_COUNT for the total and owner budgets.
+			size_t 					Bytes; 			// Usage after the allocation.
+			size_t 					Budget;
+		};
+
+		// Names the owner of allocations made by this thread while the scope lives. aOwner is
+		// escaped, an empty name is recorded as "(unnamed)".
+		class scope {
+		public:
+			scope(const std::string& aOwner);
+			~scope();
+			scope(const scope&) = delete;
+			scope& operator=(const scope&) = delete;
+		};
+
+		// Budgets in bytes, zero means unlimited. Allocations are never refused, the handler
+		// decides whether a violation is logged, unloads something or aborts.
+		size_t 										TotalBudget;
+		size_t 										CategoryBudget[CATEGORY_COUNT];
+		std::map<std::string, size_t> 				OwnerBudget; 		// By escaped top level owner, e.g. model::LedgerOwner.
+		std::function<void(const violation&)> 		OnBudgetExceeded;
+
+		memory_ledger();
+
+		// Records aBytes for the current owner path, the returned path is passed back to release.
+		std::string allocate(category aCategory, size_t aBytes);
+		void release(const std::string& aOwner, category aCategory, size_t aBytes);
+
+		size_t total() const;
+		size_t total(category aCategory) const;
+		size_t peak() const;
+		size_t violation_count() const;
+		// Usage of aOwner and every owner nested in it.
+		usage owner(const std::string& aOwner) const;
+
+		// The aCount largest owners, grouped by the first aDepth path components (0 keeps full paths).
+		std::vector<usage> top(size_t aCount, size_t aDepth = 0) const;
+		// Totals per category followed by the top owners, as text.
+		std::string report(size_t aCount = 10, size_t aDepth = 0) const;
+
+		static const char* category_name(category aCategory);
+		// Owner path of the calling thread.
+		static std::string current_owner();
+		// aName as a single path component.
+		static std::string escape(const std::string& aName);
+
+	private:
+
+		mutable std::mutex 							Mutex;
+		std::map<std::string, usage> 				Owner;
+		size_t 										Total;
+		size_t 										Category[CATEGORY_COUNT];
+		size_t 										Peak;
+		size_t 										Violations;
+
+		// Usage of aOwner and its nested owners, Mutex must be held.
+		usage subtree(const std::string& aOwner) const;
+		static std::string top_owner(const std::string& aOwner, size_t aDepth);
+
+	};
+
+}
+
+#endif // !GEODESY_GFX_MEMORY_LEDGER_H
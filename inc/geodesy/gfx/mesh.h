@@ -39,25 +39,50 @@ namespace geodesy::gfx {
 			phys::node* 					Parent; // The node the mesh instance exists in.
 			// Has no children, so this is always empty.
 
-			// Host Memory Reference
-			std::vector<vertex::weight> 	Vertex; // Contains Per Vertex BoneIDs & BoneWeights. (Goes to the vertex buffer)
-			std::vector<bone>				Bone; // Contains Per Bone/Node data specifying which vertices it influences. (Goes to bone uniform buffer)
+			// Host Memory Reference, immutable once created and shared by every copy of the instance.
+			std::shared_ptr<const std::vector<vertex::weight>> 	Vertex; // Contains Per Vertex BoneIDs & BoneWeights. (Goes to the vertex buffer)
+			std::shared_ptr<const std::vector<bone>> 			Bone; // Contains Per Bone/Node data specifying which vertices it influences. (Goes to bone uniform buffer)
 			
 			// Device Memory Objects
 			std::shared_ptr<gpu::context> 	Context;
 			std::shared_ptr<gpu::buffer> 	VertexWeightBuffer;
 			std::shared_ptr<gpu::buffer> 	UniformBuffer;
 
+			// Nodes driving each bone, resolved on first device update.
+			std::vector<phys::node*> 		BoneNode;
+
+			// Location of the uniform data in a uniform_ring, when updated through one.
+			size_t 							DynamicOffset;
+			size_t 							DynamicSerial; 	// Ring frame the data was written in, SIZE_MAX if it has no data in the ring.
+			uint64_t 						Revision; 		// Node revision the uniform data was last written at, zero if never.
+
 			// Add reference to parent node in hierarchy.
 			int 							MeshIndex;
 			uint 							MaterialIndex;
 			
 			instance();
-			instance(uint aVertexCount, const std::vector<bone>& aBoneData, int aMeshIndex, uint aMaterialIndex, phys::node* aRoot = nullptr, phys::node* aParent = nullptr);
+			instance(uint aVertexCount, std::vector<bone> aBoneData, int aMeshIndex, uint aMaterialIndex, phys::node* aRoot = nullptr, phys::node* aParent = nullptr);
 			instance(std::shared_ptr<gpu::context> aContext, const instance& aInstance, phys::node* aRoot = nullptr, phys::node* aParent = nullptr);
 			
 		};
 
+		struct cleanup_settings {
+			float 							PositionTolerance; 		// Per component, zero welds bitwise equal positions only.
+			float 							AttributeTolerance; 	// Per component, for normals, tangents, texture coordinates and colors.
+			float 							AreaTolerance; 			// Triangles with this area or less are dropped.
+			cleanup_settings();
+		};
+
+		struct cleanup_statistics {
+			size_t 							SourceVertexCount;
+			size_t 							VertexCount;
+			size_t 							SourceIndexCount;
+			size_t 							IndexCount;
+			size_t 							DegenerateCount; 		// Triangles dropped.
+			bool 							Narrowed; 				// Indices went from 32 to 16 bit.
+			cleanup_statistics();
+		};
+
 		// Host Memory Reference
 		std::weak_ptr<mesh> 							HostMesh;
 
@@ -68,9 +93,21 @@ namespace geodesy::gfx {
 		std::shared_ptr<gpu::acceleration_structure> 	AccelerationStructure;
 
 		mesh();
-		mesh(const aiMesh* aMesh);
+		// Converts aMesh, splitting large meshes across aThreadCount threads (zero uses one per hardware thread).
+		mesh(const aiMesh* aMesh, size_t aThreadCount = 0);
 		mesh(std::shared_ptr<gpu::context> aContext, std::shared_ptr<mesh> aMesh);
 
+		// Host mesh cleanup: welds vertices within tolerance, drops degenerate triangles and
+		// unused vertices, orders vertices by first use and narrows indices to 16 bit when
+		// they fit. Vertices only weld if they are equal in every array of aWeight, the bone
+		// weights of the instances drawing this mesh. aRemap receives the new index of every
+		// old vertex, UINT32_MAX for dropped ones.
+		cleanup_statistics cleanup(
+			cleanup_settings 										aSettings 	= cleanup_settings(),
+			const std::vector<const std::vector<vertex::weight>*>& 	aWeight 	= {},
+			std::vector<uint>* 										aRemap 		= nullptr
+		);
+
 	};
 
 }
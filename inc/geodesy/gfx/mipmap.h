@@ -0,0 +1,65 @@
+#pragma once
+#ifndef GEODESY_GFX_MIPMAP_H
+#define GEODESY_GFX_MIPMAP_H
+
+#include <vector>
+
+#include <geodesy/math.h>
+#include <geodesy/gpu/image.h>
+
+namespace geodesy::gfx {
+
+	// Host side mip chain generator for 8 bit textures (RGBA8 and R8). Filtering is
+	// done in linear space, so sRGB color is decoded before averaging and encoded
+	// again afterwards. Normal maps are renormalized per level, and cutout textures
+	// can keep the alpha test coverage of the base level across the whole chain.
+	// Rows of each level are filtered in parallel, so chains can be baked offline
+	// or on loader threads instead of at upload time.
+	class mipmap {
+	public:
+
+		enum filter : int {
+			BOX, 				// 2x2 average.
+			KAISER 				// Kaiser windowed sinc, sharper and less aliasing.
+		};
+
+		struct settings {
+			int 				Filter;
+			bool 				SRGB; 				// Color channels are sRGB encoded, alpha is always linear.
+			bool 				NormalMap; 			// RGB holds a unit vector packed to [0, 1], renormalized per level.
+			float 				AlphaCutoff; 		// Alpha test reference, coverage is preserved when above zero.
+			float 				KaiserAlpha;
+			float 				KaiserWidth; 		// Filter radius in destination texels.
+			size_t 				ThreadCount; 		// Zero uses one thread per hardware thread.
+			settings();
+		};
+
+		struct level {
+			uint 				Width;
+			uint 				Height;
+			std::vector<uchar> 	Data;
+		};
+
+		uint 					ChannelCount;
+		std::vector<level> 		Level; 				// Level[0] is a copy of the source.
+
+		mipmap();
+		mipmap(const uchar* aData, uint aWidth, uint aHeight, uint aChannelCount, settings aSettings = settings());
+		// Uses the host data of an 8 bit image, the chain is left empty for any other format.
+		mipmap(const gpu::image& aImage, settings aSettings = settings());
+
+		// Total bytes of the chain.
+		size_t size() const;
+		// Every level packed back to back, largest first, as expected by a buffer to image copy.
+		std::vector<uchar> pack() const;
+
+		// Number of levels of a full chain down to 1x1.
+		static uint level_count(uint aWidth, uint aHeight);
+		// Channels of a gpu::image::format the generator can filter, zero if unsupported.
+		static uint channel_count(int aImageFormat);
+
+	};
+
+}
+
+#endif // !GEODESY_GFX_MIPMAP_H
@@ -2,6 +2,7 @@
 #ifndef GEODESY_GFX_MODEL_H
 #define GEODESY_GFX_MODEL_H
 
+#include <functional>
 #include <memory>
 
 // #include "../../config.h"
@@ -10,8 +11,11 @@
 
 #include <geodesy/phys.h>
 
+#include "animation.h"
+#include "compressed_texture.h"
 #include "mesh.h"
 #include "material.h"
+#include "material_table.h"
 #include "node.h"
 
 namespace geodesy::gfx {
@@ -19,6 +23,14 @@ namespace geodesy::gfx {
 	class model /* : public io::file */ {
 	public:
 
+		// Result of merge_static_geometry.
+		struct merge_statistics {
+			size_t 								InstanceCount; 		// Instances merged into batches.
+			size_t 								BatchCount; 		// Instances and meshes that replaced them.
+			size_t 								VertexCount; 		// Vertices in the batches.
+			merge_statistics();
+		};
+
 		struct light {
 
 			enum type : int {
@@ -40,31 +52,89 @@ namespace geodesy::gfx {
 			light();
 		};
 
+		// Assimp post process steps applied by file imports.
+		static const uint DefaultPostProcess;
+
 		static bool initialize();
 		static void terminate();
 
 		// --------------- Aggregate Model Resources --------------- //
 
 		// Model Metadata
-		std::string										Name;
+		std::string										Name; 				// Scene name, often empty.
+		std::string 									Path; 				// File the model was imported from, empty if built from a scene.
+		std::string 									LedgerOwner; 		// Top level memory_ledger owner of the device resources, set by create.
 		double 											Time;
 
 		// Resources
 		std::shared_ptr<gpu::context> 					Context;
+		std::shared_ptr<arena> 							NodeArena; 			// Holds the nodes and mesh instance arrays of Hierarchy.
 		std::shared_ptr<gfx::node>						Hierarchy;			// Root Node Hierarchy 
 		std::vector<phys::animation> 					Animation; 			// Overrides Bind Pose Transform
+		std::vector<std::shared_ptr<const animation>> 	CompressedAnimation;	// Immutable, shared between model copies.
 		std::vector<std::shared_ptr<mesh>> 				Mesh;
 		std::vector<std::shared_ptr<material>> 			Material;
 		std::vector<std::shared_ptr<gpu::image>> 		Texture;
 		std::vector<light> 								Light;				// Not Relevant To Model, open as stage.
+		std::shared_ptr<material_table> 				MaterialTable;		// Shared material storage, if the model was created with one.
+		uint 											MaterialTableOffset;	// Table index of Material[0].
+		size_t 											MaterialTableCount; 	// Entries reserved in MaterialTable, released by the destructor.
 		// std::vector<std::shared_ptr<camera>> 		Camera;			// Not Relevant To Model, open as stage.
 		// std::shared_ptr<gpu::buffer> 					UniformBuffer;
 
 		model();
 		// model(std::string aFilePath, file::manager* aFileManager = nullptr);
-		model(std::shared_ptr<gpu::context> aContext, std::shared_ptr<model> aModel, gpu::image::create_info aCreateInfo = {});
+		// Imports aFilePath into a host model. Imports may run concurrently, each leases its own
+		// importer. The hierarchy is left null if the file could not be read. Large meshes are
+		// converted on aThreadCount threads, zero uses one per hardware thread; pass 1 when
+		// several imports already run side by side.
+		model(std::string aFilePath, uint aPostProcess = DefaultPostProcess, size_t aThreadCount = 0);
+		// Converts an imported scene to a host model, textures are loaded relative to aDirectory.
+		// aProgress is called with the fraction converted so far, returning false stops the
+		// conversion and leaves the model incomplete. aThreadCount is as for file imports.
+		model(const aiScene* aScene, std::string aDirectory, std::function<bool(float)> aProgress = nullptr, size_t aThreadCount = 0);
+		model(std::shared_ptr<gpu::context> aContext, std::shared_ptr<model> aModel, gpu::image::create_info aCreateInfo = {}, std::shared_ptr<material_table> aMaterialTable = nullptr);
+		// Creates the device model and releases the host data of aModel. Bone and weight data
+		// is handed over instead of copied, and HostMesh of the device meshes expires.
+		model(std::shared_ptr<gpu::context> aContext, model&& aModel, gpu::image::create_info aCreateInfo = {}, std::shared_ptr<material_table> aMaterialTable = nullptr);
 		~model();
 
+		// Builds compressed clips from Animation. If aReleaseSource is set, the uncompressed
+		// tracks are dropped and the hierarchy must be posed with node::playback.
+		std::vector<animation::statistics> compress_animation(animation::settings aSettings = animation::settings(), bool aReleaseSource = false);
+
+		// Merges host materials with equal uniform data and equal textures, whatever their names,
+		// and remaps the material index of every mesh instance. Textures are equal if they are the
+		// same image, or images of the same path, format and size with equal texels. Call before
+		// creating the device model. Returns how many materials were merged away.
+		size_t deduplicate_materials();
+
+		// Merges every unskinned instance on a node no clip animates into pre-transformed batch
+		// meshes, one set per material, drawn by one instance each on the root. Only opaque
+		// materials are merged, instances of any other transparency keep their own node so the
+		// transparency sorter still orders them. Batches are split at 2^16 vertices to keep 16
+		// bit indices. Meshes left without instances are dropped. Call on the host model before
+		// creating the device model.
+		merge_statistics merge_static_geometry();
+
+		// Runs mesh::cleanup on every host mesh and remaps the bone weights and bone vertex
+		// ids of the instances drawing it. Vertices of skinned meshes only weld when every
+		// instance weights them the same. Returns the statistics by mesh index.
+		std::vector<mesh::cleanup_statistics> cleanup_meshes(mesh::cleanup_settings aSettings = mesh::cleanup_settings());
+
+		// Replaces every RGBA8 host texture with a block compressed image holding its whole mip
+		// chain, the format is picked per material slot (see compressed_texture::compress). Images
+		// shared between materials are compressed once. Call before creating the device model.
+		// Returns how many images were compressed.
+		size_t compress_textures(compressed_texture::cache* aCache = nullptr, size_t aThreadCount = 0);
+
+	private:
+
+		// Fills the host model from aScene, returns false if aProgress stopped it.
+		bool convert(const aiScene* aScene, std::string aDirectory, std::function<bool(float)> aProgress, size_t aThreadCount);
+		// Creates the device resources from aModel, releasing its host data if aMove is set.
+		void create(std::shared_ptr<gpu::context> aContext, model& aModel, gpu::image::create_info aCreateInfo, std::shared_ptr<material_table> aMaterialTable, bool aMove);
+
 	};
 
 }
@@ -0,0 +1,126 @@
+#pragma once
+#ifndef GEODESY_GFX_MODEL_LOADER_H
+#define GEODESY_GFX_MODEL_LOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "model.h"
+
+namespace Assimp {
+	class Importer;
+}
+
+namespace geodesy::gfx {
+
+	// Loads models on a pool of worker threads. Every load goes through three stages,
+	// each queued as its own job so different loads overlap: PARSE reads the file
+	// with a private Assimp importer, CONVERT builds the host model, and UPLOAD
+	// creates the device model. Uploads are serialized against each other, so the
+	// context is only used by one worker at a time. The render thread picks up
+	// finished loads with poll(), which never blocks.
+	class model_loader {
+	public:
+
+		enum stage : int {
+			QUEUED,
+			PARSE,
+			CONVERT,
+			UPLOAD,
+			COMPLETE,
+			CANCELLED,
+			FAILED
+		};
+
+		struct settings {
+			size_t 									ThreadCount; 		// Zero uses one thread per hardware thread, minus one.
+			size_t 									ConvertThreadCount; 	// Threads per mesh conversion, zero uses one unless the loader has a single worker.
+			uint 									PostProcess; 		// Assimp post process flags.
+			bool 									CompressAnimation; 	// Compress clips during conversion.
+			bool 									DeduplicateMaterials; 	// Merge identical materials during conversion.
+			bool 									CleanupMeshes; 			// Weld vertices and compact index buffers during conversion.
+			bool 									MergeStaticGeometry; 	// Batch static unskinned instances during conversion.
+			bool 									CompressTextures; 		// Block compress material textures and their mip chains during conversion.
+			gpu::image::create_info 				ImageCreateInfo;
+			std::shared_ptr<material_table> 		MaterialTable;
+			settings();
+		};
+
+		class request {
+		public:
+
+			std::string 							Path;
+			std::atomic<int> 						Stage;
+			std::atomic<float> 						Progress; 			// Zero to one over all stages.
+			double 									StageTime[3]; 		// Seconds spent in PARSE, CONVERT and UPLOAD.
+			std::string 							Error;
+			std::shared_future<std::shared_ptr<model>> 	Future; 		// Null model when cancelled or failed.
+
+			request(std::string aPath);
+
+			// In flight loads stop at their next check, the result is a null model.
+			void cancel();
+			bool cancelled() const;
+			// True once the load completed, failed or was cancelled.
+			bool done() const;
+
+		private:
+
+			friend class model_loader;
+
+			std::atomic<bool> 						Cancel;
+			std::promise<std::shared_ptr<model>> 	Promise;
+			std::shared_ptr<Assimp::Importer> 		Importer;
+			std::shared_ptr<model> 					HostModel;
+
+		};
+
+		model_loader();
+		model_loader(std::shared_ptr<gpu::context> aContext, settings aSettings = settings());
+		// Cancels everything still queued and joins the workers.
+		~model_loader();
+
+		// Queues a load of aPath and returns its handle.
+		std::shared_ptr<request> load(std::string aPath);
+		// Loads that finished since the last call, in completion order.
+		std::vector<std::shared_ptr<request>> poll();
+		// Loads queued or in flight.
+		size_t pending() const;
+		// Cancels every load not yet finished.
+		void cancel();
+
+	private:
+
+		std::shared_ptr<gpu::context> 				Context;
+		settings 									Settings;
+
+		mutable std::mutex 							Mutex;
+		std::condition_variable 					Condition;
+		std::deque<std::function<void()>> 			Job;
+		std::vector<std::shared_ptr<request>> 		Active;
+		std::vector<std::shared_ptr<request>> 		Finished;
+		std::vector<std::thread> 					Worker;
+		bool 										Stop;
+		std::mutex 									UploadMutex;
+		compressed_texture::cache 					TextureCache; 		// Shared by every load, so equal textures are encoded once.
+
+		void work();
+		void submit(std::function<void()> aJob);
+		void parse(std::shared_ptr<request> aRequest);
+		void convert(std::shared_ptr<request> aRequest);
+		void upload(std::shared_ptr<request> aRequest);
+		void finish(std::shared_ptr<request> aRequest, int aStage, std::shared_ptr<model> aModel);
+
+	};
+
+}
+
+#endif // !GEODESY_GFX_MODEL_LOADER_H
@@ -8,16 +8,44 @@
 // Physics Base
 #include <geodesy/phys.h>
 
+#include "animation.h"
+#include "arena.h"
 #include "mesh.h"
 #include "material.h"
+#include "uniform_ring.h"
 
 namespace geodesy::gfx {
 
 	class node : public phys::node {
 	public:
 
+		// Per frame counters of the device update.
+		struct update_statistics {
+			size_t InstanceCount; 		// Mesh instances visited.
+			size_t InstanceUpdated; 	// Mesh instances written to device memory.
+			size_t ByteCount; 			// Bytes written to device memory.
+			size_t InstanceDropped; 	// Mesh instances not written because the ring was full, not drawable this frame.
+			update_statistics();
+		};
+
+		// Instance arrays built while the node's arena is current are placed in the arena,
+		// see arena::allocator. Not a std::vector<mesh::instance>, name it through this type.
+		typedef std::vector<mesh::instance, arena::allocator<mesh::instance>> instance_list;
+
 		std::shared_ptr<gpu::context> Context;
-		std::vector<mesh::instance> GraphicalMeshInstances; // Mesh Instance located in node hierarchy.
+		instance_list GraphicalMeshInstances; // Mesh Instance located in node hierarchy.
+
+		// Set by host_update when TransformToWorld changed, cleared once a device update has
+		// written the mesh instances of the node. Revision is the update that last moved it.
+		bool Dirty;
+		uint64_t Revision;
+		math::mat<float, 4, 4> PreviousTransformToWorld;
+		update_statistics LastUpdate; // Counters of the last device update started from this node.
+
+		// Nodes created while an arena scope is active on the thread are placed in that arena,
+		// deleting them only runs the destructor.
+		static void* operator new(std::size_t aSize);
+		static void operator delete(void* aPointer);
 
 		node();
 		node(const aiScene* aScene, const aiNode* aNode, phys::node* aRoot = nullptr, phys::node* aParent = nullptr);
@@ -35,6 +63,30 @@ namespace geodesy::gfx {
 			double 									aDeltaTime = 0.0f, 
 			double 									aTime = 0.0f
 		) override;
+		// Writes the mesh instance uniform data into the current frame of aRing instead of the
+		// per instance uniform buffers, recording the dynamic offset on each instance.
+		void device_update(
+			uniform_ring& 							aRing,
+			double 									aDeltaTime = 0.0f,
+			double 									aTime = 0.0f
+		);
+
+		// Writes every mesh instance in the hierarchy whose node or bones moved, splitting the
+		// instance list across aThreadCount threads (zero uses one per hardware thread).
+		update_statistics parallel_device_update(
+			double 									aDeltaTime = 0.0f,
+			double 									aTime = 0.0f,
+			size_t 									aThreadCount = 0,
+			uniform_ring* 							aRing = nullptr
+		);
+
+		// Poses the hierarchy from compressed clips at time aTime (seconds) and updates the world transforms.
+		// Clips are blended by aAnimationWeight, whatever weight remains goes to the bind pose.
+		void playback(
+			double 												aTime,
+			const std::vector<std::shared_ptr<const animation>>& 	aPlaybackAnimation,
+			const std::vector<float>& 							aAnimationWeight
+		);
 
 		// Counts the total number of mesh references in the tree.
 		size_t instance_count();
@@ -0,0 +1,117 @@
+#pragma once
+#ifndef GEODESY_GFX_TEXTURE_STREAMER_H
+#define GEODESY_GFX_TEXTURE_STREAMER_H
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <geodesy/math.h>
+
+#include "mipmap.h"
+#include "material.h"
+
+namespace geodesy::gfx {
+
+	class model;
+
+	// Keeps the mip levels of streamed textures inside a memory budget. Textures
+	// start with only their small tail levels resident. Each frame the renderer
+	// reports how large the textures appear on screen, and the streamer requests
+	// the finer levels that are needed. Requests complete after a latency, on the
+	// streamer's own clock. When the budget is exceeded, the finest levels of the
+	// textures that were needed least recently are evicted first. Residency
+	// changes are reported through the Upload and Evict callbacks, so the streamer
+	// runs the same with or without a device behind it.
+	class texture_streamer {
+	public:
+
+		struct settings {
+			size_t 						Budget; 			// Bytes of mip data allowed to be resident.
+			uint 						TailSize; 			// Levels no larger than this are always resident.
+			double 						Latency; 			// Seconds between a request and its upload.
+			size_t 						MaxInFlight; 		// Requests pending at once.
+			float 						Bias; 				// Added to the selected level, positive favors coarser levels.
+			settings();
+		};
+
+		struct texture {
+			std::shared_ptr<const mipmap> 	Chain;
+			uint 						TailLevel; 			// First level of the permanently resident tail.
+			uint 						ResidentLevel; 		// Finest resident level, every coarser level is resident.
+			uint 						DesiredLevel; 		// Finest level requested during the current frame.
+			uint 						PendingLevel; 		// Level in flight, or UINT32_MAX.
+			double 						LastNeeded; 		// Streamer time the texture was last requested.
+			size_t resident_size() const;
+		};
+
+		struct statistics {
+			size_t 						ResidentBytes;
+			size_t 						PeakResidentBytes;
+			size_t 						RequestCount;
+			size_t 						UploadCount;
+			size_t 						UploadBytes;
+			size_t 						EvictionCount;
+			size_t 						EvictionBytes;
+			size_t 						InFlight;
+			statistics();
+		};
+
+		// Called when a level becomes resident or is dropped.
+		std::function<void(uint aTexture, uint aLevel, const mipmap::level& aData)> 	Upload;
+		std::function<void(uint aTexture, uint aLevel)> 								Evict;
+
+		settings 						Settings;
+		std::vector<texture> 			Texture;
+		statistics 						Statistics;
+		double 							Time;
+
+		texture_streamer();
+		texture_streamer(settings aSettings);
+
+		// Registers a mip chain and uploads its tail, returns the texture index.
+		uint add(std::shared_ptr<const mipmap> aChain);
+		// Registers every texture of aMaterial that has 8 bit host data, see mipmap::channel_count.
+		void add(const material* aMaterial, mipmap::settings aSettings = mipmap::settings());
+		// Registers the materials of aModel.
+		void add(const model& aModel, mipmap::settings aSettings = mipmap::settings());
+
+		// Reports that aTexture covers aScreenSize pixels along its larger axis this frame.
+		void request(uint aTexture, float aScreenSize);
+		void request(const material* aMaterial, float aScreenSize);
+		// Requests the textures of every mesh instance in aModel, sized by the projected
+		// bounding sphere of its mesh as seen from aCameraPosition.
+		void request(const model& aModel, math::vec<float, 3> aCameraPosition, float aFieldOfView, float aViewportHeight);
+
+		// Advances the clock, completes requests whose latency has passed, issues new
+		// requests and evicts down to the budget. Returns the number of levels uploaded.
+		size_t update(double aDeltaTime);
+
+		// Texture indices registered for aMaterial.
+		const std::vector<uint>& textures(const material* aMaterial) const;
+
+		// Pixel height of a sphere of radius aRadius at distance aDistance.
+		static float projected_size(float aRadius, float aDistance, float aFieldOfView, float aViewportHeight);
+
+	private:
+
+		struct load {
+			uint 						Texture;
+			uint 						Level;
+			double 						CompletionTime;
+		};
+
+		std::deque<load> 										Pending;
+		size_t 													PendingBytes;
+		std::unordered_map<const material*, std::vector<uint>> 	MaterialTexture;
+		std::unordered_map<const gpu::image*, uint> 			ImageTexture;
+
+		void evict(size_t aBudget, double aNeededAfter);
+
+	};
+
+}
+
+#endif // !GEODESY_GFX_TEXTURE_STREAMER_H
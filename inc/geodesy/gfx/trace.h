@@ -0,0 +1,71 @@
+#pragma once
+#ifndef GEODESY_GFX_TRACE_H
+#define GEODESY_GFX_TRACE_H
+
+#include <cstdint>
+#include <string>
+
+// Scoped timing zones and counters for profiling the gfx host paths. Every thread
+// records into its own ring buffer, so recording never takes a lock, and the rings
+// are exported as Chrome trace JSON (chrome://tracing, ui.perfetto.dev). The macros
+// compile to nothing unless GEODESY_GFX_TRACE is defined (CMake option
+// GEODESY_GFX_ENABLE_TRACE). Zone and counter names must be string literals.
+
+namespace geodesy::gfx::trace {
+
+	// Counters summed over a frame, emitted and reset by frame().
+	enum frame_counter : int {
+		BUFFERS_CREATED,
+		IMAGES_CREATED,
+		BYTES_UPLOADED,
+		COUNTER_COUNT
+	};
+
+	// Times the scope it lives in.
+	class zone {
+	public:
+		zone(const char* aName);
+		~zone();
+		zone(const zone&) = delete;
+		zone& operator=(const zone&) = delete;
+	private:
+		const char* 	Name;
+		uint64_t 		Begin;
+	};
+
+	// Nanoseconds since the trace started.
+	uint64_t now();
+
+	// Records the value of a named counter at this instant.
+	void counter(const char* aName, int64_t aValue);
+	// Adds to a per frame counter, lock free.
+	void add(frame_counter aCounter, int64_t aValue);
+	// Marks the end of a frame and records the per frame counters.
+	void frame();
+
+	// Events each thread keeps before the oldest are overwritten, applies to threads that have not recorded yet.
+	void set_capacity(size_t aEventCount);
+	// Drops every recorded event.
+	void clear();
+
+	// Chrome trace event JSON of everything recorded. Export while no thread is recording.
+	std::string chrome_json();
+	bool write_chrome_json(const std::string& aPath);
+
+}
+
+#ifdef GEODESY_GFX_TRACE
+#define GEODESY_GFX_TRACE_CONCAT_(aA, aB) aA##aB
+#define GEODESY_GFX_TRACE_CONCAT(aA, aB) GEODESY_GFX_TRACE_CONCAT_(aA, aB)
+#define GEODESY_GFX_TRACE_ZONE(aName) ::geodesy::gfx::trace::zone GEODESY_GFX_TRACE_CONCAT(TraceZone, __LINE__)(aName)
+#define GEODESY_GFX_TRACE_COUNTER(aName, aValue) ::geodesy::gfx::trace::counter(aName, aValue)
+#define GEODESY_GFX_TRACE_ADD(aCounter, aValue) ::geodesy::gfx::trace::add(::geodesy::gfx::trace::aCounter, aValue)
+#define GEODESY_GFX_TRACE_FRAME() ::geodesy::gfx::trace::frame()
+#else
+#define GEODESY_GFX_TRACE_ZONE(aName) ((void)0)
+#define GEODESY_GFX_TRACE_COUNTER(aName, aValue) ((void)0)
+#define GEODESY_GFX_TRACE_ADD(aCounter, aValue) ((void)0)
+#define GEODESY_GFX_TRACE_FRAME() ((void)0)
+#endif
+
+#endif // !GEODESY_GFX_TRACE_H
@@ -0,0 +1,86 @@
+#pragma once
+#ifndef GEODESY_GFX_TRANSPARENCY_SORTER_H
+#define GEODESY_GFX_TRANSPARENCY_SORTER_H
+
+#include <unordered_map>
+#include <vector>
+
+#include <geodesy/math.h>
+
+#include "mesh.h"
+#include "material.h"
+
+namespace geodesy::gfx {
+
+	class model;
+
+	// Sorts translucent mesh instances back to front by the view depth of their
+	// world space center of mass. Draw order barely changes between frames, so
+	// each frame starts from the previous frame's order and is fixed up with an
+	// insertion sort, which is close to linear when the camera moves smoothly.
+	// Large translucent meshes can also have their triangles sorted, giving an
+	// index list to upload in place of the static one.
+	class transparency_sorter {
+	public:
+
+		struct entry {
+			const mesh::instance* 		Instance;
+			const mesh* 				Mesh;
+			const material* 			Material;
+			float 						Depth; 		// Along the camera forward axis.
+			const std::vector<uint>* 	Index; 		// Back to front triangle list, null if not triangle sorted.
+		};
+
+		struct statistics {
+			size_t 						EntryCount;
+			size_t 						CoherentCount; 		// Entries also drawn last frame.
+			size_t 						ShiftCount; 		// Insertion sort moves.
+			size_t 						TriangleMeshCount;
+			size_t 						TriangleCount;
+			size_t 						TriangleShiftCount;
+			double 						SortTime; 			// Seconds.
+			double 						TriangleTime;
+			statistics();
+		};
+
+		// Meshes with at least this many triangles are sorted per triangle, zero disables it.
+		size_t 							TriangleThreshold;
+		size_t 							ThreadCount; 	// For triangle sorting, zero uses one thread per hardware thread.
+
+		std::vector<entry> 				Entry; 			// Back to front after sort().
+		statistics 						Statistics;
+
+		transparency_sorter();
+
+		// Starts a new frame seen from aCameraPosition looking along aCameraForward.
+		void begin(math::vec<float, 3> aCameraPosition, math::vec<float, 3> aCameraForward);
+		void add(const mesh::instance* aInstance, const mesh* aMesh, const material* aMaterial);
+		// Adds every instance of aModel with a TRANSLUCENT material.
+		void add(model& aModel);
+		void sort();
+
+		// Forgets the order of previous frames.
+		void reset();
+
+	private:
+
+		struct triangle_order {
+			std::vector<uint> 			Triangle; 		// Back to front.
+			std::vector<float> 			Depth; 			// Per triangle, indexed by triangle.
+			std::vector<uint> 			Index;
+			bool 						Seen;
+		};
+
+		math::vec<float, 3> 			CameraPosition;
+		math::vec<float, 3> 			CameraForward;
+		std::vector<const mesh::instance*> 								Previous;
+		std::unordered_map<const mesh::instance*, triangle_order> 		Triangle;
+
+		float depth(const mesh::instance* aInstance, const mesh* aMesh) const;
+		size_t sort_triangles(const entry& aEntry, triangle_order& aOrder) const;
+
+	};
+
+}
+
+#endif // !GEODESY_GFX_TRANSPARENCY_SORTER_H
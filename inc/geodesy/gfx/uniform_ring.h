@@ -0,0 +1,67 @@
+#pragma once
+#ifndef GEODESY_GFX_UNIFORM_RING_H
+#define GEODESY_GFX_UNIFORM_RING_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <geodesy/gpu/context.h>
+#include <geodesy/gpu/buffer.h>
+
+namespace geodesy::gfx {
+
+	// Per frame uniform allocator for frames in flight. One persistently mapped
+	// buffer is split into FrameCount regions, and every frame allocates linearly
+	// from its own region. Allocations are bound with dynamic offsets, so the CPU
+	// can record frame N + 1 while the GPU still reads the data of frame N. Data
+	// is only valid for draws recorded in the frame it was allocated in, anything
+	// drawn again in a later frame must be written again. The caller must wait on
+	// the fence of frame N before begin_frame starts frame N + FrameCount, which
+	// reuses its region.
+	class uniform_ring {
+	public:
+
+		struct allocation {
+			size_t 							Offset; 		// Dynamic offset into Buffer.
+			void* 							Ptr; 			// Host address, nullptr if the frame region is full.
+			size_t 							Size;
+			allocation();
+		};
+
+		std::shared_ptr<gpu::context> 		Context;
+		std::shared_ptr<gpu::buffer> 		Buffer; 		// Null without a backend, HostData is used instead.
+		std::vector<uchar> 					HostData;
+		size_t 								FrameCount;
+		size_t 								FrameSize; 		// Bytes per frame region.
+		size_t 								Alignment; 		// minUniformBufferOffsetAlignment of the device.
+
+		uniform_ring();
+		uniform_ring(std::shared_ptr<gpu::context> aContext, size_t aFrameCount, size_t aFrameSize, size_t aAlignment = 256);
+
+		// Starts recording the next frame and returns its serial number.
+		size_t begin_frame();
+
+		// Thread safe bump allocation in the current frame region.
+		allocation allocate(size_t aSize);
+		allocation write(const void* aData, size_t aSize);
+
+		// Serial number of the frame being recorded.
+		size_t serial() const;
+		// Bytes allocated in the current frame.
+		size_t used() const;
+		// Allocations refused because the frame region was full, since the last begin_frame.
+		size_t overflow_count() const;
+
+	private:
+
+		std::atomic<size_t> 				Head;
+		std::atomic<size_t> 				Overflow;
+		size_t 								Serial;
+		uchar* 								Base;
+
+	};
+
+}
+
+#endif // !GEODESY_GFX_UNIFORM_RING_H
@@ -0,0 +1,576 @@
+#include <geodesy/gfx/animation.h>
+
+#include <cmath>
+#include <algorithm>
+
+namespace geodesy::gfx {
+
+	namespace {
+
+		// Raw keyframe pulled out of a phys::animation track, quaternions are (w, x, y, z).
+		template <size_t N>
+		struct raw_key {
+			double Time;
+			float Value[N];
+		};
+
+		static const float QuantizationScale = 65535.0f;
+		static const float RotationRange = 0.70710678f; // Components other than the largest are bound by 1/sqrt(2).
+
+		ushort quantize(double aValue, double aMinimum, double aExtent) {
+			if (aExtent <= 0.0) return 0;
+			double Fraction = std::clamp((aValue - aMinimum) / aExtent, 0.0, 1.0);
+			return (ushort)std::lround(Fraction * QuantizationScale);
+		}
+
+		float dequantize(ushort aValue, float aMinimum, float aExtent) {
+			return aMinimum + aExtent * ((float)aValue / QuantizationScale);
+		}
+
+		void normalize(float* aQuaternion) {
+			float Length = std::sqrt(aQuaternion[0]*aQuaternion[0] + aQuaternion[1]*aQuaternion[1] + aQuaternion[2]*aQuaternion[2] + aQuaternion[3]*aQuaternion[3]);
+			if (Length == 0.0f) {
+				aQuaternion[0] = 1.0f; aQuaternion[1] = 0.0f; aQuaternion[2] = 0.0f; aQuaternion[3] = 0.0f;
+				return;
+			}
+			for (int i = 0; i < 4; i++) aQuaternion[i] /= Length;
+		}
+
+		// Linear interpolation of N component values. Quaternions (N = 4) take the shortest
+		// path and are renormalized afterwards.
+		template <size_t N>
+		void interpolate(const float* aA, const float* aB, float aT, float* aResult) {
+			float Sign = 1.0f;
+			if constexpr (N == 4) {
+				float Dot = aA[0]*aB[0] + aA[1]*aB[1] + aA[2]*aB[2] + aA[3]*aB[3];
+				Sign = Dot < 0.0f ? -1.0f : 1.0f;
+			}
+			for (size_t i = 0; i < N; i++) {
+				aResult[i] = aA[i] + aT * (Sign * aB[i] - aA[i]);
+			}
+			if constexpr (N == 4) {
+				normalize(aResult);
+			}
+		}
+
+		// Error between two values, euclidean distance for vectors and angle for quaternions.
+		template <size_t N>
+		float distance(const float* aA, const float* aB) {
+			if constexpr (N == 4) {
+				// From the chord between the two unit quaternions, acos of their dot product loses
+				// everything below about 1e-3 radians in float.
+				float Sign = (aA[0]*aB[0] + aA[1]*aB[1] + aA[2]*aB[2] + aA[3]*aB[3]) < 0.0f ? -1.0f : 1.0f;
+				float Chord = 0.0f;
+				for (size_t i = 0; i < 4; i++) {
+					Chord += (aA[i] - Sign * aB[i]) * (aA[i] - Sign * aB[i]);
+				}
+				return 4.0f * std::asin(std::min(0.5f * std::sqrt(Chord), 1.0f));
+			}
+			float Sum = 0.0f;
+			for (size_t i = 0; i < N; i++) {
+				Sum += (aA[i] - aB[i]) * (aA[i] - aB[i]);
+			}
+			return std::sqrt(Sum);
+		}
+
+		template <size_t N>
+		void sample(const std::vector<raw_key<N>>& aKey, double aTick, float* aResult) {
+			if (aKey.size() == 0) return;
+			if ((aKey.size() == 1) || (aTick <= aKey.front().Time)) {
+				std::copy(aKey.front().Value, aKey.front().Value + N, aResult);
+				return;
+			}
+			if (aTick >= aKey.back().Time) {
+				std::copy(aKey.back().Value, aKey.back().Value + N, aResult);
+				return;
+			}
+			auto Next = std::upper_bound(aKey.begin(), aKey.end(), aTick, [](double aT, const raw_key<N>& aK) { return aT < aK.Time; });
+			auto Previous = Next - 1;
+			float T = (float)((aTick - Previous->Time) / (Next->Time - Previous->Time));
+			interpolate<N>(Previous->Value, Next->Value, T, aResult);
+		}
+
+		// Greedy keyframe reduction. A key is dropped if interpolating between the last kept key
+		// and the next candidate reproduces every skipped key within tolerance. Candidates are
+		// interpolated as aSnap says they will decode, so the tolerance holds for the stored track.
+		template <size_t N, typename snap>
+		std::vector<raw_key<N>> reduce(const std::vector<raw_key<N>>& aKey, float aTolerance, const snap& aSnap) {
+			if (aKey.size() <= 1) return aKey;
+			std::vector<raw_key<N>> Stored(aKey.size());
+			for (size_t i = 0; i < aKey.size(); i++) {
+				Stored[i].Time = aSnap.time(aKey[i].Time);
+				aSnap.value(aKey[i].Value, Stored[i].Value);
+			}
+
+			// Constant tracks collapse to a single key.
+			bool Constant = true;
+			for (size_t i = 0; (i < aKey.size()) && Constant; i++) {
+				Constant = distance<N>(Stored[0].Value, aKey[i].Value) <= aTolerance;
+			}
+			if (Constant) return { aKey.front() };
+
+			// Every source key is checked on the segment the decoder will sample it from, which
+			// can be a neighbour of its own when its time was rounded.
+			std::vector<raw_key<N>> Kept = { aKey.front() };
+			size_t Anchor = 0;
+			for (size_t i = 2; i < aKey.size(); i++) {
+				bool Fits = true;
+				double Span = Stored[i].Time - Stored[Anchor].Time;
+				for (size_t j = Anchor; (j <= i) && Fits; j++) {
+					if ((aKey[j].Time < Stored[Anchor].Time) || (aKey[j].Time > Stored[i].Time)) continue;
+					float Value[N];
+					float T = Span > 0.0 ? (float)((aKey[j].Time - Stored[Anchor].Time) / Span) : 0.0f;
+					interpolate<N>(Stored[Anchor].Value, Stored[i].Value, T, Value);
+					Fits = distance<N>(Value, aKey[j].Value) <= aTolerance;
+				}
+				if (!Fits) {
+					Anchor = i - 1;
+					Kept.push_back(aKey[Anchor]);
+				}
+			}
+			Kept.push_back(aKey.back());
+			return Kept;
+		}
+
+		std::vector<raw_key<3>> extract(const std::vector<phys::animation::key<math::vec<float, 3>>>& aKey) {
+			std::vector<raw_key<3>> Key(aKey.size());
+			for (size_t i = 0; i < aKey.size(); i++) {
+				Key[i].Time = aKey[i].Time;
+				for (size_t j = 0; j < 3; j++) {
+					Key[i].Value[j] = aKey[i].Value[j];
+				}
+			}
+			return Key;
+		}
+
+		std::vector<raw_key<4>> extract(const std::vector<phys::animation::key<math::quaternion<float>>>& aKey) {
+			std::vector<raw_key<4>> Key(aKey.size());
+			for (size_t i = 0; i < aKey.size(); i++) {
+				Key[i].Time = aKey[i].Time;
+				for (size_t j = 0; j < 4; j++) {
+					Key[i].Value[j] = aKey[i].Value[j];
+				}
+				normalize(Key[i].Value);
+			}
+			return Key;
+		}
+
+		// Finds the pair of keys surrounding a quantized phase, returns the interpolation factor.
+		template <typename time>
+		float locate(const std::vector<time>& aTime, double aPhase, size_t& aPrevious, size_t& aNext) {
+			double Q = std::clamp(aPhase, 0.0, 1.0) * QuantizationScale;
+			if ((aTime.size() == 1) || (Q <= aTime.front())) {
+				aPrevious = 0; aNext = 0;
+				return 0.0f;
+			}
+			if (Q >= aTime.back()) {
+				aPrevious = aTime.size() - 1; aNext = aPrevious;
+				return 0.0f;
+			}
+			aNext = std::upper_bound(aTime.begin(), aTime.end(), Q, [](double aT, time aK) { return aT < (double)aK; }) - aTime.begin();
+			aPrevious = aNext - 1;
+			return (float)((Q - aTime[aPrevious]) / (double)(aTime[aNext] - aTime[aPrevious]));
+		}
+
+		// Key times are stored as 16 bit fractions of the clip duration, unless rounding them could
+		// move the track by more than half the tolerance at its fastest. Such tracks keep float times.
+		struct time_snap {
+			double 									Duration;
+			bool 									Wide;
+			template <size_t N>
+			time_snap(const std::vector<raw_key<N>>& aKey, double aDuration, float aTolerance) {
+				this->Duration = aDuration;
+				float Speed = 0.0f;
+				for (size_t i = 1; i < aKey.size(); i++) {
+					double Step = aKey[i].Time - aKey[i - 1].Time;
+					if (Step > 0.0) Speed = std::max(Speed, (float)(distance<N>(aKey[i].Value, aKey[i - 1].Value) / Step));
+				}
+				this->Wide = Speed * 0.5 * aDuration / QuantizationScale > 0.5 * aTolerance;
+			}
+			// Time in the units of the stored track, QuantizationScale is the end of the clip.
+			double stored(double aTime) const {
+				if (this->Duration <= 0.0) return 0.0;
+				return this->Wide ? std::clamp(aTime / this->Duration, 0.0, 1.0) * QuantizationScale : (double)quantize(aTime, 0.0, this->Duration);
+			}
+			double time(double aTime) const {
+				return this->Duration * (this->stored(aTime) / QuantizationScale);
+			}
+		};
+
+		// Range of a vector track over its source keys, and whether 16 bit offsets into it stay
+		// within half the tolerance. Wider tracks are stored as floats.
+		struct vector_snap : time_snap {
+			float 									Minimum[3];
+			float 									Extent[3];
+			bool 									WideValue;
+			vector_snap(const std::vector<raw_key<3>>& aKey, double aDuration, float aTolerance) : time_snap(aKey, aDuration, aTolerance) {
+				float Step = 0.0f;
+				for (size_t j = 0; j < 3; j++) {
+					float Lowest = aKey.size() > 0 ? aKey[0].Value[j] : 0.0f, Highest = Lowest;
+					for (const raw_key<3>& K : aKey) {
+						Lowest = std::min(Lowest, K.Value[j]);
+						Highest = std::max(Highest, K.Value[j]);
+					}
+					this->Minimum[j] 	= Lowest;
+					this->Extent[j] 	= Highest - Lowest;
+					Step += this->Extent[j] * this->Extent[j];
+				}
+				// Rounding moves each component by up to half a step.
+				this->WideValue = 0.5f * std::sqrt(Step) / QuantizationScale > 0.5f * aTolerance;
+			}
+			void value(const float* aValue, float* aStored) const {
+				for (size_t j = 0; j < 3; j++) {
+					aStored[j] = this->WideValue ? aValue[j] : dequantize(quantize(aValue[j], this->Minimum[j], this->Extent[j]), this->Minimum[j], this->Extent[j]);
+				}
+			}
+		};
+
+		// Stores the key times of a track in the width aSnap picked.
+		template <typename track, size_t N>
+		void encode_time(const std::vector<raw_key<N>>& aKey, const time_snap& aSnap, track& aTrack) {
+			aTrack.Time.clear();
+			aTrack.WideTime.clear();
+			for (const raw_key<N>& K : aKey) {
+				if (aSnap.Wide) {
+					aTrack.WideTime.push_back((float)aSnap.stored(K.Time));
+				}
+				else {
+					aTrack.Time.push_back((ushort)aSnap.stored(K.Time));
+				}
+			}
+		}
+
+		void encode(const std::vector<raw_key<3>>& aKey, const vector_snap& aSnap, animation::vector_track& aTrack) {
+			encode_time(aKey, aSnap, aTrack);
+			aTrack.Value.clear();
+			aTrack.WideValue.clear();
+			if (aKey.size() == 0) return;
+			for (size_t j = 0; j < 3; j++) {
+				aTrack.Minimum[j] 	= aSnap.Minimum[j];
+				aTrack.Extent[j] 	= aSnap.Extent[j];
+			}
+			for (size_t i = 0; i < aKey.size(); i++) {
+				for (size_t j = 0; j < 3; j++) {
+					if (aSnap.WideValue) {
+						aTrack.WideValue.push_back(aKey[i].Value[j]);
+					}
+					else {
+						aTrack.Value.push_back(quantize(aKey[i].Value[j], aTrack.Minimum[j], aTrack.Extent[j]));
+					}
+				}
+			}
+		}
+
+		// Smallest three encoding of one unit quaternion into three words.
+		void encode_rotation(const float* aQuaternion, ushort* aValue) {
+			// Drop the largest component, q and -q are the same rotation so force it positive.
+			const float* Q = aQuaternion;
+			int Largest = 0;
+			for (int j = 1; j < 4; j++) {
+				if (std::fabs(Q[j]) > std::fabs(Q[Largest])) Largest = j;
+			}
+			float Sign = Q[Largest] < 0.0f ? -1.0f : 1.0f;
+			int k = 0;
+			for (int j = 0; j < 4; j++) {
+				if (j == Largest) continue;
+				double Fraction = std::clamp((Sign * Q[j] + RotationRange) / (2.0 * RotationRange), 0.0, 1.0);
+				aValue[k] = (ushort)std::lround(Fraction * 32767.0);
+				k++;
+			}
+			aValue[0] |= (ushort)((Largest & 1) << 15);
+			aValue[1] |= (ushort)((Largest >> 1) << 15);
+		}
+
+		void decode_rotation(const ushort* aValue, float* aQuaternion) {
+			const ushort* V = aValue;
+			int Largest = ((V[0] >> 15) & 1) | (((V[1] >> 15) & 1) << 1);
+			float Sum = 0.0f;
+			int k = 0;
+			for (int j = 0; j < 4; j++) {
+				if (j == Largest) continue;
+				aQuaternion[j] = ((float)(V[k] & 0x7FFF) / 32767.0f) * (2.0f * RotationRange) - RotationRange;
+				Sum += aQuaternion[j] * aQuaternion[j];
+				k++;
+			}
+			aQuaternion[Largest] = std::sqrt(std::max(0.0f, 1.0f - Sum));
+		}
+
+		// Rotations always use the 15 bit encoding, its error (about 1e-4 radians) bounds the tolerance.
+		struct rotation_snap : time_snap {
+			rotation_snap(const std::vector<raw_key<4>>& aKey, double aDuration, float aTolerance) : time_snap(aKey, aDuration, aTolerance) {}
+			void value(const float* aValue, float* aStored) const {
+				ushort Value[3];
+				encode_rotation(aValue, Value);
+				decode_rotation(Value, aStored);
+			}
+		};
+
+		void encode(const std::vector<raw_key<4>>& aKey, const rotation_snap& aSnap, animation::rotation_track& aTrack) {
+			encode_time(aKey, aSnap, aTrack);
+			aTrack.Value.resize(3 * aKey.size());
+			for (size_t i = 0; i < aKey.size(); i++) {
+				encode_rotation(aKey[i].Value, &aTrack.Value[3*i]);
+			}
+		}
+
+		void decode(const animation::rotation_track& aTrack, size_t aIndex, float* aQuaternion) {
+			decode_rotation(&aTrack.Value[3*aIndex], aQuaternion);
+		}
+
+		void decode(const animation::vector_track& aTrack, size_t aIndex, float* aVector) {
+			for (size_t j = 0; j < 3; j++) {
+				aVector[j] = aTrack.WideValue.size() > 0 ? aTrack.WideValue[3*aIndex + j] : dequantize(aTrack.Value[3*aIndex + j], aTrack.Minimum[j], aTrack.Extent[j]);
+			}
+		}
+
+		// Composes Translation * Rotation * Scale, quaternion is (w, x, y, z).
+		math::mat<float, 4, 4> compose(const float* aT, const float* aQ, const float* aS) {
+			float w = aQ[0], x = aQ[1], y = aQ[2], z = aQ[3];
+			return math::mat<float, 4, 4>(
+				(1.0f - 2.0f*(y*y + z*z)) * aS[0], 	(2.0f*(x*y - w*z)) * aS[1], 		(2.0f*(x*z + w*y)) * aS[2], 		aT[0],
+				(2.0f*(x*y + w*z)) * aS[0], 		(1.0f - 2.0f*(x*x + z*z)) * aS[1], 	(2.0f*(y*z - w*x)) * aS[2], 		aT[1],
+				(2.0f*(x*z - w*y)) * aS[0], 		(2.0f*(y*z + w*x)) * aS[1], 		(1.0f - 2.0f*(x*x + y*y)) * aS[2], 	aT[2],
+				0.0f, 								0.0f, 								0.0f, 								1.0f
+			);
+		}
+
+		template <size_t N>
+		size_t source_size(const std::vector<phys::animation::key<math::vec<float, N>>>& aKey) {
+			return aKey.size() * sizeof(phys::animation::key<math::vec<float, N>>);
+		}
+
+		size_t source_size(const std::vector<phys::animation::key<math::quaternion<float>>>& aKey) {
+			return aKey.size() * sizeof(phys::animation::key<math::quaternion<float>>);
+		}
+
+	}
+
+	animation::settings::settings() {
+		this->PositionTolerance 	= 1.0e-4f;
+		this->RotationTolerance 	= 1.0e-3f;
+		this->ScaleTolerance 		= 1.0e-4f;
+	}
+
+	math::vec<float, 3> animation::vector_track::operator[](double aPhase) const {
+		math::vec<float, 3> Result = { 0.0f, 0.0f, 0.0f };
+		if (this->key_count() == 0) return Result;
+		size_t Previous, Next;
+		float T = this->WideTime.size() > 0 ? locate(this->WideTime, aPhase, Previous, Next) : locate(this->Time, aPhase, Previous, Next);
+		float A[3], B[3], V[3];
+		decode(*this, Previous, A);
+		decode(*this, Next, B);
+		interpolate<3>(A, B, T, V);
+		return { V[0], V[1], V[2] };
+	}
+
+	size_t animation::vector_track::size() const {
+		return sizeof(Minimum) + sizeof(Extent) + (Time.size() + Value.size()) * sizeof(ushort) + (WideTime.size() + WideValue.size()) * sizeof(float);
+	}
+
+	size_t animation::vector_track::key_count() const {
+		return std::max(this->Time.size(), this->WideTime.size());
+	}
+
+	double animation::vector_track::key_phase(size_t aIndex) const {
+		return (this->WideTime.size() > 0 ? (double)this->WideTime[aIndex] : (double)this->Time[aIndex]) / QuantizationScale;
+	}
+
+	math::quaternion<float> animation::rotation_track::operator[](double aPhase) const {
+		if (this->key_count() == 0) return math::quaternion<float>(1.0f, 0.0f, 0.0f, 0.0f);
+		size_t Previous, Next;
+		float T = this->WideTime.size() > 0 ? locate(this->WideTime, aPhase, Previous, Next) : locate(this->Time, aPhase, Previous, Next);
+		float A[4], B[4], Q[4];
+		decode(*this, Previous, A);
+		decode(*this, Next, B);
+		interpolate<4>(A, B, T, Q);
+		return math::quaternion<float>(Q[0], Q[1], Q[2], Q[3]);
+	}
+
+	size_t animation::rotation_track::size() const {
+		return (Time.size() + Value.size()) * sizeof(ushort) + WideTime.size() * sizeof(float);
+	}
+
+	size_t animation::rotation_track::key_count() const {
+		return std::max(this->Time.size(), this->WideTime.size());
+	}
+
+	double animation::rotation_track::key_phase(size_t aIndex) const {
+		return (this->WideTime.size() > 0 ? (double)this->WideTime[aIndex] : (double)this->Time[aIndex]) / QuantizationScale;
+	}
+
+	animation::channel::channel() {
+		this->Duration = 0.0;
+	}
+
+	math::mat<float, 4, 4> animation::channel::operator[](double aTick) const {
+		double Phase = this->Duration > 0.0 ? aTick / this->Duration : 0.0;
+		float T[3] = { 0.0f, 0.0f, 0.0f }, Q[4] = { 1.0f, 0.0f, 0.0f, 0.0f }, S[3] = { 1.0f, 1.0f, 1.0f };
+		if (this->Position.key_count() > 0) {
+			math::vec<float, 3> P = this->Position[Phase];
+			T[0] = P[0]; T[1] = P[1]; T[2] = P[2];
+		}
+		if (this->Rotation.key_count() > 0) {
+			math::quaternion<float> R = this->Rotation[Phase];
+			Q[0] = R[0]; Q[1] = R[1]; Q[2] = R[2]; Q[3] = R[3];
+		}
+		if (this->Scaling.key_count() > 0) {
+			math::vec<float, 3> V = this->Scaling[Phase];
+			S[0] = V[0]; S[1] = V[1]; S[2] = V[2];
+		}
+		return compose(T, Q, S);
+	}
+
+	size_t animation::channel::size() const {
+		return Position.size() + Rotation.size() + Scaling.size();
+	}
+
+	animation::statistics::statistics() {
+		this->SourceKeyCount 	= 0;
+		this->KeyCount 			= 0;
+		this->SourceSize 		= 0;
+		this->CompressedSize 	= 0;
+		this->MaxPositionError 	= 0.0f;
+		this->MaxRotationError 	= 0.0f;
+		this->MaxScaleError 	= 0.0f;
+	}
+
+	float animation::statistics::compression_ratio() const {
+		return this->CompressedSize > 0 ? (float)this->SourceSize / (float)this->CompressedSize : 0.0f;
+	}
+
+	animation::animation() {
+		this->Duration = 0.0;
+		this->TicksPerSecond = 0.0;
+	}
+
+	animation::animation(const phys::animation& aAnimation, settings aSettings) : animation() {
+		this->Name 				= aAnimation.Name;
+		this->Duration 			= aAnimation.Duration;
+		this->TicksPerSecond 	= aAnimation.TicksPerSecond;
+		for (const auto& [Identifier, NodeAnim] : aAnimation.NodeAnimMap) {
+			channel& Channel = this->Channel[Identifier];
+			Channel.Duration = this->Duration;
+			std::vector<raw_key<3>> Position = extract(NodeAnim.PositionKey);
+			std::vector<raw_key<3>> Scaling = extract(NodeAnim.ScalingKey);
+			vector_snap PositionSnap(Position, this->Duration, aSettings.PositionTolerance);
+			vector_snap ScalingSnap(Scaling, this->Duration, aSettings.ScaleTolerance);
+			std::vector<raw_key<4>> Rotation = extract(NodeAnim.RotationKey);
+			rotation_snap RotationSnap(Rotation, this->Duration, aSettings.RotationTolerance);
+			encode(reduce<3>(Position, aSettings.PositionTolerance, PositionSnap), PositionSnap, Channel.Position);
+			encode(reduce<4>(Rotation, aSettings.RotationTolerance, RotationSnap), RotationSnap, Channel.Rotation);
+			encode(reduce<3>(Scaling, aSettings.ScaleTolerance, ScalingSnap), ScalingSnap, Channel.Scaling);
+		}
+	}
+
+	bool animation::pose(const std::string& aNodeIdentifier, double aTime, math::mat<float, 4, 4>& aTransform) const {
+		auto It = this->Channel.find(aNodeIdentifier);
+		if (It == this->Channel.end()) return false;
+		aTransform = It->second[this->tick(aTime)];
+		return true;
+	}
+
+	double animation::tick(double aTime) const {
+		double Tick = aTime * (this->TicksPerSecond > 0.0 ? this->TicksPerSecond : 1.0);
+		if (this->Duration > 0.0) {
+			Tick = std::fmod(Tick, this->Duration);
+			if (Tick < 0.0) Tick += this->Duration;
+		}
+		return Tick;
+	}
+
+	phys::animation animation::decompress() const {
+		phys::animation Animation;
+		Animation.Name 				= this->Name;
+		Animation.Duration 			= this->Duration;
+		Animation.TicksPerSecond 	= this->TicksPerSecond;
+		for (const auto& [Identifier, Channel] : this->Channel) {
+			phys::animation::node_anim& NodeAnim = Animation.NodeAnimMap[Identifier];
+			NodeAnim.PositionKey.resize(Channel.Position.key_count());
+			for (size_t i = 0; i < NodeAnim.PositionKey.size(); i++) {
+				float V[3];
+				decode(Channel.Position, i, V);
+				NodeAnim.PositionKey[i].Time 	= Channel.Position.key_phase(i) * this->Duration;
+				NodeAnim.PositionKey[i].Value 	= math::vec<float, 3>(V[0], V[1], V[2]);
+			}
+			NodeAnim.RotationKey.resize(Channel.Rotation.key_count());
+			for (size_t i = 0; i < NodeAnim.RotationKey.size(); i++) {
+				float Q[4];
+				decode(Channel.Rotation, i, Q);
+				NodeAnim.RotationKey[i].Time 	= Channel.Rotation.key_phase(i) * this->Duration;
+				NodeAnim.RotationKey[i].Value 	= math::quaternion<float>(Q[0], Q[1], Q[2], Q[3]);
+			}
+			NodeAnim.ScalingKey.resize(Channel.Scaling.key_count());
+			for (size_t i = 0; i < NodeAnim.ScalingKey.size(); i++) {
+				float V[3];
+				decode(Channel.Scaling, i, V);
+				NodeAnim.ScalingKey[i].Time 	= Channel.Scaling.key_phase(i) * this->Duration;
+				NodeAnim.ScalingKey[i].Value 	= math::vec<float, 3>(V[0], V[1], V[2]);
+			}
+		}
+		return Animation;
+	}
+
+	size_t animation::size() const {
+		size_t Size = 0;
+		for (const auto& [Identifier, Channel] : this->Channel) {
+			Size += Channel.size();
+		}
+		return Size;
+	}
+
+	animation::statistics animation::compare(const phys::animation& aSource, const animation& aCompressed, size_t aSampleCount) {
+		statistics Statistics;
+		Statistics.CompressedSize = aCompressed.size();
+		for (const auto& [Identifier, Channel] : aCompressed.Channel) {
+			Statistics.KeyCount += Channel.Position.key_count() + Channel.Rotation.key_count() + Channel.Scaling.key_count();
+		}
+		for (const auto& [Identifier, NodeAnim] : aSource.NodeAnimMap) {
+			Statistics.SourceKeyCount += NodeAnim.PositionKey.size() + NodeAnim.RotationKey.size() + NodeAnim.ScalingKey.size();
+			Statistics.SourceSize += source_size(NodeAnim.PositionKey) + source_size(NodeAnim.RotationKey) + source_size(NodeAnim.ScalingKey);
+
+			auto It = aCompressed.Channel.find(Identifier);
+			if (It == aCompressed.Channel.end()) continue;
+			const channel& Channel = It->second;
+
+			std::vector<raw_key<3>> Position = extract(NodeAnim.PositionKey);
+			std::vector<raw_key<4>> Rotation = extract(NodeAnim.RotationKey);
+			std::vector<raw_key<3>> Scaling = extract(NodeAnim.ScalingKey);
+
+			// Evaluate at every source key, and at evenly spaced samples in between.
+			std::vector<double> Tick;
+			for (const raw_key<3>& K : Position) Tick.push_back(K.Time);
+			for (const raw_key<4>& K : Rotation) Tick.push_back(K.Time);
+			for (const raw_key<3>& K : Scaling) Tick.push_back(K.Time);
+			for (size_t i = 0; i < aSampleCount; i++) {
+				Tick.push_back(aSource.Duration * ((double)i / (double)std::max((size_t)1, aSampleCount - 1)));
+			}
+
+			for (double T : Tick) {
+				double Phase = aCompressed.Duration > 0.0 ? T / aCompressed.Duration : 0.0;
+				if (Position.size() > 0) {
+					float A[3], B[3];
+					sample<3>(Position, T, A);
+					math::vec<float, 3> V = Channel.Position[Phase];
+					B[0] = V[0]; B[1] = V[1]; B[2] = V[2];
+					Statistics.MaxPositionError = std::max(Statistics.MaxPositionError, distance<3>(A, B));
+				}
+				if (Rotation.size() > 0) {
+					float A[4], B[4];
+					sample<4>(Rotation, T, A);
+					math::quaternion<float> Q = Channel.Rotation[Phase];
+					B[0] = Q[0]; B[1] = Q[1]; B[2] = Q[2]; B[3] = Q[3];
+					Statistics.MaxRotationError = std::max(Statistics.MaxRotationError, distance<4>(A, B));
+				}
+				if (Scaling.size() > 0) {
+					float A[3], B[3];
+					sample<3>(Scaling, T, A);
+					math::vec<float, 3> V = Channel.Scaling[Phase];
+					B[0] = V[0]; B[1] = V[1]; B[2] = V[2];
+					Statistics.MaxScaleError = std::max(Statistics.MaxScaleError, distance<3>(A, B));
+				}
+			}
+		}
+		return Statistics;
+	}
+
+}
@@ -0,0 +1,86 @@
+#include <geodesy/gfx/arena.h>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace geodesy::gfx {
+
+	static thread_local arena* CurrentArena = nullptr;
+
+	arena::scope::scope(arena* aArena) {
+		this->Previous = CurrentArena;
+		CurrentArena = aArena;
+	}
+
+	arena::scope::~scope() {
+		CurrentArena = this->Previous;
+	}
+
+	arena::arena(std::size_t aBlockSize) {
+		this->BlockSize 	= std::max(aBlockSize, (std::size_t)256);
+		this->Offset 		= 0;
+		this->Used 			= 0;
+		this->Capacity 		= 0;
+		this->LiveCount 	= 0;
+	}
+
+	arena::~arena() {}
+
+	void* arena::allocate(std::size_t aSize, std::size_t aAlignment) {
+		// Align the address, not the offset, blocks are only aligned to the default new alignment.
+		if (!this->Block.empty()) {
+			block& Last = this->Block.back();
+			std::uintptr_t Base = (std::uintptr_t)Last.Data.get();
+			std::uintptr_t Address = (Base + this->Offset + aAlignment - 1) & ~(std::uintptr_t)(aAlignment - 1);
+			if (Address + aSize <= Base + Last.Size) {
+				this->Offset = (std::size_t)(Address + aSize - Base);
+				this->Used += aSize;
+				this->LiveCount += 1;
+				return (void*)Address;
+			}
+		}
+
+		// Oversized requests get a block of their own size.
+		block NewBlock;
+		NewBlock.Size = std::max(this->BlockSize, aSize + aAlignment);
+		NewBlock.Data = std::unique_ptr<uchar[]>(new uchar[NewBlock.Size]);
+		this->Capacity += NewBlock.Size;
+		this->Block.push_back(std::move(NewBlock));
+		this->Offset = 0;
+		return this->allocate(aSize, aAlignment);
+	}
+
+	void arena::release() {
+		this->LiveCount -= 1;
+	}
+
+	bool arena::owns(const void* aPointer) const {
+		std::uintptr_t Address = (std::uintptr_t)aPointer;
+		for (const block& Block : this->Block) {
+			std::uintptr_t Base = (std::uintptr_t)Block.Data.get();
+			if ((Address >= Base) && (Address < Base + Block.Size)) return true;
+		}
+		return false;
+	}
+
+	std::size_t arena::size() const {
+		return this->Used;
+	}
+
+	std::size_t arena::capacity() const {
+		return this->Capacity;
+	}
+
+	std::size_t arena::block_count() const {
+		return this->Block.size();
+	}
+
+	std::size_t arena::live_count() const {
+		return this->LiveCount;
+	}
+
+	arena* arena::current() {
+		return CurrentArena;
+	}
+
+}
@@ -0,0 +1,133 @@
+#include <geodesy/gfx/backend.h>
+#include <geodesy/gfx/trace.h>
+#include <geodesy/gfx/compressed_texture.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+namespace geodesy::gfx {
+
+	static std::mutex InstalledMutex;
+	static std::shared_ptr<backend> Installed;
+	static std::atomic<backend*> InstalledBackend(nullptr);
+
+	// Bytes of every layer and mip level in the image's own format, block compressed formats
+	// are counted per 4x4 block.
+	static size_t image_bytes(const std::shared_ptr<gpu::image>& aImage) {
+		if (aImage == nullptr) return 0;
+		const gpu::image::extent3d& Extent = aImage->CreateInfo.extent;
+		int Block = compressed_texture::from_image_format(aImage->CreateInfo.format);
+		size_t Bytes = 0;
+		for (uint Level = 0; Level < std::max(1u, aImage->CreateInfo.mipLevels); Level++) {
+			size_t Width 	= std::max(1u, Extent.width >> Level);
+			size_t Height 	= std::max(1u, Extent.height >> Level);
+			size_t Depth 	= std::max(1u, std::max(1u, Extent.depth) >> Level);
+			if (Block >= 0) {
+				Bytes += ((Width + 3) / 4) * ((Height + 3) / 4) * Depth * compressed_texture::block_size(Block);
+			}
+			else {
+				Bytes += Width * Height * Depth * gpu::image::bytes_per_pixel(aImage->CreateInfo.format);
+			}
+		}
+		return Bytes * std::max(1u, aImage->CreateInfo.arrayLayers);
+	}
+
+	backend::statistics::statistics() {
+		this->reset();
+	}
+
+	void backend::statistics::reset() {
+		this->BufferCount 	= 0;
+		this->BufferBytes 	= 0;
+		this->ImageCount 	= 0;
+		this->ImageBytes 	= 0;
+		this->MapCount 		= 0;
+		this->MapBytes 		= 0;
+	}
+
+	backend::~backend() {}
+
+	// Holds the original resource, and releases its ledger entry when the last user lets go.
+	template <typename T>
+	static std::shared_ptr<T> account(const std::shared_ptr<memory_ledger>& aLedger, std::shared_ptr<T> aResource, memory_ledger::category aCategory, size_t aBytes) {
+		if ((aLedger == nullptr) || (aResource == nullptr)) return aResource;
+		std::string Owner = aLedger->allocate(aCategory, aBytes);
+		T* Resource = aResource.get();
+		return std::shared_ptr<T>(Resource, [aLedger, aResource, Owner, aCategory, aBytes](T*) mutable {
+			aResource = nullptr;
+			aLedger->release(Owner, aCategory, aBytes);
+		});
+	}
+
+	std::shared_ptr<gpu::buffer> backend::create_buffer(const std::shared_ptr<gpu::context>& aContext, gpu::buffer::create_info aCreateInfo, size_t aSize, const void* aData, memory_ledger::category aCategory) {
+		this->Statistics.BufferCount += 1;
+		this->Statistics.BufferBytes += aSize;
+		GEODESY_GFX_TRACE_ADD(BUFFERS_CREATED, 1);
+		GEODESY_GFX_TRACE_ADD(BYTES_UPLOADED, aData != nullptr ? (int64_t)aSize : 0);
+		return account(this->Ledger, this->make_buffer(aContext, aCreateInfo, aSize, aData), aCategory, aSize);
+	}
+
+	std::shared_ptr<gpu::image> backend::create_image(const std::shared_ptr<gpu::context>& aContext, gpu::image::create_info aCreateInfo, const std::shared_ptr<gpu::image>& aHostImage, memory_ledger::category aCategory) {
+		this->Statistics.ImageCount += 1;
+		this->Statistics.ImageBytes += image_bytes(aHostImage);
+		GEODESY_GFX_TRACE_ADD(IMAGES_CREATED, 1);
+		GEODESY_GFX_TRACE_ADD(BYTES_UPLOADED, (int64_t)image_bytes(aHostImage));
+		return account(this->Ledger, this->make_image(aContext, aCreateInfo, aHostImage), aCategory, image_bytes(aHostImage));
+	}
+
+	void* backend::map(gpu::buffer& aBuffer, size_t aOffset, size_t aSize) {
+		this->Statistics.MapCount += 1;
+		this->Statistics.MapBytes += aSize;
+		return this->map_buffer(aBuffer, aOffset, aSize);
+	}
+
+	void backend::install(std::shared_ptr<backend> aBackend) {
+		std::lock_guard<std::mutex> Lock(InstalledMutex);
+		Installed = aBackend;
+		InstalledBackend = aBackend.get();
+	}
+
+	backend* backend::get(const std::shared_ptr<gpu::context>& aContext) {
+		static device_backend Device;
+		backend* Backend = InstalledBackend;
+		if (Backend != nullptr) return Backend;
+		return aContext != nullptr ? &Device : nullptr;
+	}
+
+	std::shared_ptr<gpu::buffer> device_backend::make_buffer(const std::shared_ptr<gpu::context>& aContext, gpu::buffer::create_info aCreateInfo, size_t aSize, const void* aData) {
+		return aContext->create<gpu::buffer>(aCreateInfo, aSize, const_cast<void*>(aData));
+	}
+
+	std::shared_ptr<gpu::image> device_backend::make_image(const std::shared_ptr<gpu::context>& aContext, gpu::image::create_info aCreateInfo, const std::shared_ptr<gpu::image>& aHostImage) {
+		return std::make_shared<gpu::image>(aContext, aCreateInfo, aHostImage);
+	}
+
+	void* device_backend::map_buffer(gpu::buffer& aBuffer, size_t aOffset, size_t aSize) {
+		aBuffer.map_memory(aOffset, aSize);
+		return aBuffer.Ptr;
+	}
+
+	std::shared_ptr<gpu::buffer> null_backend::make_buffer(const std::shared_ptr<gpu::context>& aContext, gpu::buffer::create_info aCreateInfo, size_t aSize, const void* aData) {
+		// The buffer only borrows the host memory, it is detached again before the buffer is destroyed.
+		std::shared_ptr<uchar[]> Memory(new uchar[std::max(aSize, (size_t)1)]());
+		if (aData != nullptr) {
+			std::memcpy(Memory.get(), aData, aSize);
+		}
+		gpu::buffer* Buffer = new gpu::buffer();
+		Buffer->Ptr = Memory.get();
+		return std::shared_ptr<gpu::buffer>(Buffer, [Memory](gpu::buffer* aBuffer) {
+			aBuffer->Ptr = nullptr;
+			delete aBuffer;
+		});
+	}
+
+	std::shared_ptr<gpu::image> null_backend::make_image(const std::shared_ptr<gpu::context>& aContext, gpu::image::create_info aCreateInfo, const std::shared_ptr<gpu::image>& aHostImage) {
+		return aHostImage;
+	}
+
+	void* null_backend::map_buffer(gpu::buffer& aBuffer, size_t aOffset, size_t aSize) {
+		return (uchar*)aBuffer.Ptr + aOffset;
+	}
+
+}
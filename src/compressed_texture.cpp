@@ -0,0 +1,571 @@
+#include <geodesy/gfx/compressed_texture.h>
+#include <geodesy/gfx/mipmap.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+#include "parallel.h"
+
+namespace geodesy::gfx {
+
+	namespace {
+
+		// Block rows are only split across threads in chunks of this size.
+		static const size_t BlockRowGrain = 4;
+
+		// BC7 interpolation weights for 4 bit indices.
+		static const int Weight4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		// Gathers a 4x4 block of RGBA8 pixels, clamping at the image border.
+		void load_block(const uchar* aData, uint aWidth, uint aHeight, uint aBlockX, uint aBlockY, uchar aBlock[16][4]) {
+			for (uint y = 0; y < 4; y++) {
+				for (uint x = 0; x < 4; x++) {
+					uint px = std::min(aBlockX * 4 + x, aWidth - 1);
+					uint py = std::min(aBlockY * 4 + y, aHeight - 1);
+					std::memcpy(aBlock[4*y + x], &aData[((size_t)py * aWidth + px) * 4], 4);
+				}
+			}
+		}
+
+		void store_block(uchar* aData, uint aWidth, uint aHeight, uint aBlockX, uint aBlockY, const uchar aBlock[16][4]) {
+			for (uint y = 0; y < 4; y++) {
+				for (uint x = 0; x < 4; x++) {
+					uint px = aBlockX * 4 + x;
+					uint py = aBlockY * 4 + y;
+					if ((px >= aWidth) || (py >= aHeight)) continue;
+					std::memcpy(&aData[((size_t)py * aWidth + px) * 4], aBlock[4*y + x], 4);
+				}
+			}
+		}
+
+		// Principal axis of the block colors over aChannelCount channels, by power iteration.
+		void principal_axis(const uchar aBlock[16][4], int aChannelCount, float* aMean, float* aAxis) {
+			for (int c = 0; c < aChannelCount; c++) {
+				aMean[c] = 0.0f;
+				for (int i = 0; i < 16; i++) aMean[c] += aBlock[i][c];
+				aMean[c] /= 16.0f;
+			}
+			float Covariance[4][4] = {};
+			for (int i = 0; i < 16; i++) {
+				for (int a = 0; a < aChannelCount; a++) {
+					for (int b = 0; b < aChannelCount; b++) {
+						Covariance[a][b] += (aBlock[i][a] - aMean[a]) * (aBlock[i][b] - aMean[b]);
+					}
+				}
+			}
+			for (int c = 0; c < aChannelCount; c++) aAxis[c] = 1.0f;
+			for (int Iteration = 0; Iteration < 8; Iteration++) {
+				float Next[4] = {}, Length = 0.0f;
+				for (int a = 0; a < aChannelCount; a++) {
+					for (int b = 0; b < aChannelCount; b++) Next[a] += Covariance[a][b] * aAxis[b];
+					Length += Next[a] * Next[a];
+				}
+				Length = std::sqrt(Length);
+				if (Length < 1.0e-6f) break;
+				for (int c = 0; c < aChannelCount; c++) aAxis[c] = Next[c] / Length;
+			}
+		}
+
+		// Endpoints at the extremes of the block projected on its principal axis.
+		void fit_endpoints(const uchar aBlock[16][4], int aChannelCount, float* aLow, float* aHigh) {
+			float Mean[4], Axis[4];
+			principal_axis(aBlock, aChannelCount, Mean, Axis);
+			float Minimum = std::numeric_limits<float>::max(), Maximum = -std::numeric_limits<float>::max();
+			for (int i = 0; i < 16; i++) {
+				float t = 0.0f;
+				for (int c = 0; c < aChannelCount; c++) t += (aBlock[i][c] - Mean[c]) * Axis[c];
+				Minimum = std::min(Minimum, t);
+				Maximum = std::max(Maximum, t);
+			}
+			for (int c = 0; c < aChannelCount; c++) {
+				aLow[c] = std::clamp(Mean[c] + Axis[c] * Minimum, 0.0f, 255.0f);
+				aHigh[c] = std::clamp(Mean[c] + Axis[c] * Maximum, 0.0f, 255.0f);
+			}
+		}
+
+		// -------------------- BC1 -------------------- //
+
+		ushort pack565(const float* aColor) {
+			uint r = (uint)std::lround(aColor[0] * 31.0f / 255.0f);
+			uint g = (uint)std::lround(aColor[1] * 63.0f / 255.0f);
+			uint b = (uint)std::lround(aColor[2] * 31.0f / 255.0f);
+			return (ushort)((r << 11) | (g << 5) | b);
+		}
+
+		void unpack565(ushort aColor, int* aResult) {
+			int r = (aColor >> 11) & 31, g = (aColor >> 5) & 63, b = aColor & 31;
+			aResult[0] = (r << 3) | (r >> 2);
+			aResult[1] = (g << 2) | (g >> 4);
+			aResult[2] = (b << 3) | (b >> 2);
+		}
+
+		void bc1_palette(ushort aC0, ushort aC1, int aPalette[4][4]) {
+			unpack565(aC0, aPalette[0]);
+			unpack565(aC1, aPalette[1]);
+			aPalette[0][3] = 255; aPalette[1][3] = 255;
+			for (int c = 0; c < 3; c++) {
+				if (aC0 > aC1) {
+					aPalette[2][c] = (2 * aPalette[0][c] + aPalette[1][c]) / 3;
+					aPalette[3][c] = (aPalette[0][c] + 2 * aPalette[1][c]) / 3;
+				}
+				else {
+					aPalette[2][c] = (aPalette[0][c] + aPalette[1][c]) / 2;
+					aPalette[3][c] = 0;
+				}
+			}
+			aPalette[2][3] = 255;
+			aPalette[3][3] = aC0 > aC1 ? 255 : 0;
+		}
+
+		void encode_bc1(const uchar aBlock[16][4], uchar* aOutput) {
+			float Low[4], High[4];
+			fit_endpoints(aBlock, 3, Low, High);
+			ushort C0 = pack565(High), C1 = pack565(Low);
+			if (C0 < C1) std::swap(C0, C1);
+			int Palette[4][4];
+			bc1_palette(C0, C1, Palette);
+			uint Indices = 0;
+			if (C0 != C1) {
+				for (int i = 0; i < 16; i++) {
+					int Best = 0, BestError = INT32_MAX;
+					for (int p = 0; p < 4; p++) {
+						int Error = 0;
+						for (int c = 0; c < 3; c++) Error += (aBlock[i][c] - Palette[p][c]) * (aBlock[i][c] - Palette[p][c]);
+						if (Error < BestError) { BestError = Error; Best = p; }
+					}
+					Indices |= (uint)Best << (2 * i);
+				}
+			}
+			std::memcpy(aOutput + 0, &C0, 2);
+			std::memcpy(aOutput + 2, &C1, 2);
+			std::memcpy(aOutput + 4, &Indices, 4);
+		}
+
+		void decode_bc1(const uchar* aInput, uchar aBlock[16][4]) {
+			ushort C0, C1;
+			uint Indices;
+			std::memcpy(&C0, aInput + 0, 2);
+			std::memcpy(&C1, aInput + 2, 2);
+			std::memcpy(&Indices, aInput + 4, 4);
+			int Palette[4][4];
+			bc1_palette(C0, C1, Palette);
+			for (int i = 0; i < 16; i++) {
+				int p = (Indices >> (2 * i)) & 3;
+				for (int c = 0; c < 4; c++) aBlock[i][c] = (uchar)Palette[p][c];
+			}
+		}
+
+		// -------------------- BC4 -------------------- //
+
+		void bc4_palette(int aE0, int aE1, int aPalette[8]) {
+			aPalette[0] = aE0;
+			aPalette[1] = aE1;
+			if (aE0 > aE1) {
+				for (int i = 1; i < 7; i++) aPalette[i + 1] = ((7 - i) * aE0 + i * aE1) / 7;
+			}
+			else {
+				for (int i = 1; i < 5; i++) aPalette[i + 1] = ((5 - i) * aE0 + i * aE1) / 5;
+				aPalette[6] = 0;
+				aPalette[7] = 255;
+			}
+		}
+
+		void encode_bc4(const uchar aBlock[16][4], int aChannel, uchar* aOutput) {
+			int Minimum = 255, Maximum = 0;
+			for (int i = 0; i < 16; i++) {
+				Minimum = std::min(Minimum, (int)aBlock[i][aChannel]);
+				Maximum = std::max(Maximum, (int)aBlock[i][aChannel]);
+			}
+			int Palette[8];
+			bc4_palette(Maximum, Minimum, Palette);
+			uint64_t Indices = 0;
+			for (int i = 0; i < 16; i++) {
+				int Best = 0, BestError = INT32_MAX;
+				for (int p = 0; p < 8; p++) {
+					int Error = std::abs(aBlock[i][aChannel] - Palette[p]);
+					if (Error < BestError) { BestError = Error; Best = p; }
+				}
+				Indices |= (uint64_t)Best << (3 * i);
+			}
+			aOutput[0] = (uchar)Maximum;
+			aOutput[1] = (uchar)Minimum;
+			for (int b = 0; b < 6; b++) aOutput[2 + b] = (uchar)(Indices >> (8 * b));
+		}
+
+		void decode_bc4(const uchar* aInput, int aChannel, uchar aBlock[16][4]) {
+			int Palette[8];
+			bc4_palette(aInput[0], aInput[1], Palette);
+			uint64_t Indices = 0;
+			for (int b = 0; b < 6; b++) Indices |= (uint64_t)aInput[2 + b] << (8 * b);
+			for (int i = 0; i < 16; i++) {
+				aBlock[i][aChannel] = (uchar)Palette[(Indices >> (3 * i)) & 7];
+			}
+		}
+
+		// -------------------- BC7 (mode 6) -------------------- //
+
+		struct bit_writer {
+			uchar* Data;
+			int Position;
+			void write(uint aValue, int aBitCount) {
+				for (int i = 0; i < aBitCount; i++, Position++) {
+					if ((aValue >> i) & 1) Data[Position >> 3] |= (uchar)(1 << (Position & 7));
+				}
+			}
+		};
+
+		struct bit_reader {
+			const uchar* Data;
+			int Position;
+			uint read(int aBitCount) {
+				uint Value = 0;
+				for (int i = 0; i < aBitCount; i++, Position++) {
+					Value |= (uint)((Data[Position >> 3] >> (Position & 7)) & 1) << i;
+				}
+				return Value;
+			}
+		};
+
+		// Quantizes an endpoint to 7 bits per channel plus a shared p-bit, picking the p-bit with the least error.
+		void quantize_endpoint(const float* aColor, uint aQuantized[4], uint& aPBit) {
+			float BestError = std::numeric_limits<float>::max();
+			for (uint p = 0; p < 2; p++) {
+				uint Q[4];
+				float Error = 0.0f;
+				for (int c = 0; c < 4; c++) {
+					Q[c] = (uint)std::clamp((int)std::lround((aColor[c] - (float)p) / 2.0f), 0, 127);
+					float Reconstructed = (float)((Q[c] << 1) | p);
+					Error += (Reconstructed - aColor[c]) * (Reconstructed - aColor[c]);
+				}
+				if (Error < BestError) {
+					BestError = Error;
+					aPBit = p;
+					std::copy(Q, Q + 4, aQuantized);
+				}
+			}
+		}
+
+		void encode_bc7(const uchar aBlock[16][4], uchar* aOutput) {
+			float Low[4], High[4];
+			fit_endpoints(aBlock, 4, Low, High);
+			uint Q0[4], Q1[4], P0 = 0, P1 = 0;
+			quantize_endpoint(Low, Q0, P0);
+			quantize_endpoint(High, Q1, P1);
+
+			int E0[4], E1[4];
+			for (int c = 0; c < 4; c++) {
+				E0[c] = (int)((Q0[c] << 1) | P0);
+				E1[c] = (int)((Q1[c] << 1) | P1);
+			}
+			uint Index[16];
+			for (int i = 0; i < 16; i++) {
+				int Best = 0, BestError = INT32_MAX;
+				for (int w = 0; w < 16; w++) {
+					int Error = 0;
+					for (int c = 0; c < 4; c++) {
+						int Value = ((64 - Weight4[w]) * E0[c] + Weight4[w] * E1[c] + 32) >> 6;
+						Error += (aBlock[i][c] - Value) * (aBlock[i][c] - Value);
+					}
+					if (Error < BestError) { BestError = Error; Best = w; }
+				}
+				Index[i] = (uint)Best;
+			}
+
+			// The anchor index has an implicit zero high bit, swap endpoints if needed.
+			if (Index[0] & 8) {
+				std::swap(Q0, Q1);
+				std::swap(P0, P1);
+				for (int i = 0; i < 16; i++) Index[i] = 15 - Index[i];
+			}
+
+			std::memset(aOutput, 0, 16);
+			bit_writer Writer = { aOutput, 0 };
+			Writer.write(1 << 6, 7);
+			for (int c = 0; c < 4; c++) {
+				Writer.write(Q0[c], 7);
+				Writer.write(Q1[c], 7);
+			}
+			Writer.write(P0, 1);
+			Writer.write(P1, 1);
+			Writer.write(Index[0], 3);
+			for (int i = 1; i < 16; i++) Writer.write(Index[i], 4);
+		}
+
+		void decode_bc7(const uchar* aInput, uchar aBlock[16][4]) {
+			bit_reader Reader = { aInput, 0 };
+			if (Reader.read(7) != (1 << 6)) {
+				// Only mode 6 is produced by the encoder.
+				std::memset(aBlock, 0, 64);
+				return;
+			}
+			uint Q0[4], Q1[4];
+			for (int c = 0; c < 4; c++) {
+				Q0[c] = Reader.read(7);
+				Q1[c] = Reader.read(7);
+			}
+			uint P0 = Reader.read(1), P1 = Reader.read(1);
+			for (int i = 0; i < 16; i++) {
+				uint w = Weight4[Reader.read(i == 0 ? 3 : 4)];
+				for (int c = 0; c < 4; c++) {
+					int E0 = (int)((Q0[c] << 1) | P0), E1 = (int)((Q1[c] << 1) | P1);
+					aBlock[i][c] = (uchar)(((64 - w) * E0 + w * E1 + 32) >> 6);
+				}
+			}
+		}
+
+		int channel_count(int aFormat) {
+			switch (aFormat) {
+			case compressed_texture::BC1: 	return 3;
+			case compressed_texture::BC4: 	return 1;
+			case compressed_texture::BC5: 	return 2;
+			default: 						return 4;
+			}
+		}
+
+	}
+
+	compressed_texture::cache::cache() {
+		this->HitCount = 0;
+		this->MissCount = 0;
+	}
+
+	std::shared_ptr<const compressed_texture> compressed_texture::cache::get(const uchar* aData, uint aWidth, uint aHeight, int aFormat, size_t aThreadCount) {
+		uint64_t Key = compressed_texture::hash(aData, aWidth, aHeight, aFormat);
+		{
+			std::lock_guard<std::mutex> Lock(this->Mutex);
+			auto It = this->Entry.find(Key);
+			if (It != this->Entry.end()) {
+				this->HitCount += 1;
+				return It->second;
+			}
+			this->MissCount += 1;
+		}
+		// Encode outside the lock, if two threads race on the same source the first result is kept.
+		std::shared_ptr<const compressed_texture> Texture = std::make_shared<compressed_texture>(aData, aWidth, aHeight, aFormat, aThreadCount);
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		return this->Entry.emplace(Key, Texture).first->second;
+	}
+
+	size_t compressed_texture::cache::size() {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		return this->Entry.size();
+	}
+
+	void compressed_texture::cache::clear() {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		this->Entry.clear();
+	}
+
+	compressed_texture::compressed_texture() {
+		this->Format 		= BC7;
+		this->Width 		= 0;
+		this->Height 		= 0;
+		this->SourceHash 	= 0;
+		this->PSNR 			= 0.0f;
+	}
+
+	compressed_texture::compressed_texture(const uchar* aData, uint aWidth, uint aHeight, int aFormat, size_t aThreadCount) : compressed_texture() {
+		this->Format 		= aFormat;
+		this->Width 		= aWidth;
+		this->Height 		= aHeight;
+		if ((aData == nullptr) || (aWidth == 0) || (aHeight == 0)) return;
+		this->SourceHash 	= hash(aData, aWidth, aHeight, aFormat);
+
+		uint BlockCountX = (aWidth + 3) / 4;
+		uint BlockCountY = (aHeight + 3) / 4;
+		size_t BlockSize = block_size(aFormat);
+		this->Data.resize((size_t)BlockCountX * BlockCountY * BlockSize);
+
+		parallel::for_range(BlockCountY, aThreadCount, BlockRowGrain, [&](size_t aBegin, size_t aEnd, size_t) {
+			uchar Block[16][4];
+			for (size_t by = aBegin; by < aEnd; by++) {
+				for (uint bx = 0; bx < BlockCountX; bx++) {
+					load_block(aData, aWidth, aHeight, bx, (uint)by, Block);
+					uchar* Output = &this->Data[(by * BlockCountX + bx) * BlockSize];
+					switch (aFormat) {
+					case BC1:
+						encode_bc1(Block, Output);
+						break;
+					case BC4:
+						encode_bc4(Block, 0, Output);
+						break;
+					case BC5:
+						encode_bc4(Block, 0, Output);
+						encode_bc4(Block, 1, Output + 8);
+						break;
+					default:
+						encode_bc7(Block, Output);
+						break;
+					}
+				}
+			}
+		});
+
+		std::vector<uchar> Decoded = this->decode();
+		this->PSNR = psnr(aData, Decoded.data(), aWidth, aHeight, aFormat);
+	}
+
+	std::vector<uchar> compressed_texture::decode() const {
+		std::vector<uchar> Pixel((size_t)this->Width * this->Height * 4);
+		uint BlockCountX = (this->Width + 3) / 4;
+		uint BlockCountY = (this->Height + 3) / 4;
+		size_t BlockSize = block_size(this->Format);
+		if (this->Data.size() < (size_t)BlockCountX * BlockCountY * BlockSize) return Pixel;
+		for (uint by = 0; by < BlockCountY; by++) {
+			for (uint bx = 0; bx < BlockCountX; bx++) {
+				uchar Block[16][4];
+				for (int i = 0; i < 16; i++) {
+					Block[i][0] = 0; Block[i][1] = 0; Block[i][2] = 0; Block[i][3] = 255;
+				}
+				const uchar* Input = &this->Data[((size_t)by * BlockCountX + bx) * BlockSize];
+				switch (this->Format) {
+				case BC1:
+					decode_bc1(Input, Block);
+					break;
+				case BC4:
+					decode_bc4(Input, 0, Block);
+					break;
+				case BC5:
+					decode_bc4(Input, 0, Block);
+					decode_bc4(Input + 8, 1, Block);
+					break;
+				default:
+					decode_bc7(Input, Block);
+					break;
+				}
+				store_block(Pixel.data(), this->Width, this->Height, bx, by, Block);
+			}
+		}
+		return Pixel;
+	}
+
+	size_t compressed_texture::block_size(int aFormat) {
+		return ((aFormat == BC1) || (aFormat == BC4)) ? 8 : 16;
+	}
+
+	int compressed_texture::from_image_format(int aImageFormat) {
+		switch (aImageFormat) {
+		case gpu::image::format::BC1_RGB_UNORM_BLOCK:
+		case gpu::image::format::BC1_RGB_SRGB_BLOCK:
+		case gpu::image::format::BC1_RGBA_UNORM_BLOCK:
+		case gpu::image::format::BC1_RGBA_SRGB_BLOCK:
+			return BC1;
+		case gpu::image::format::BC4_UNORM_BLOCK:
+			return BC4;
+		case gpu::image::format::BC5_UNORM_BLOCK:
+			return BC5;
+		case gpu::image::format::BC7_UNORM_BLOCK:
+		case gpu::image::format::BC7_SRGB_BLOCK:
+			return BC7;
+		default:
+			return -1;
+		}
+	}
+
+	int compressed_texture::image_format(int aFormat, bool aSRGB) {
+		switch (aFormat) {
+		case BC1:
+			return aSRGB ? gpu::image::format::BC1_RGB_SRGB_BLOCK : gpu::image::format::BC1_RGB_UNORM_BLOCK;
+		case BC4:
+			return gpu::image::format::BC4_UNORM_BLOCK;
+		case BC5:
+			return gpu::image::format::BC5_UNORM_BLOCK;
+		default:
+			return aSRGB ? gpu::image::format::BC7_SRGB_BLOCK : gpu::image::format::BC7_UNORM_BLOCK;
+		}
+	}
+
+	std::shared_ptr<gpu::image> compressed_texture::compress(const gpu::image& aImage, material::texture_slot aSlot, cache* aCache, size_t aThreadCount) {
+		const gpu::image::vk_ci& CreateInfo = aImage.CreateInfo;
+		if ((aImage.HostData == nullptr) || (mipmap::channel_count(CreateInfo.format) != 4)) return nullptr;
+		if ((std::max(1u, CreateInfo.extent.depth) > 1) || (std::max(1u, CreateInfo.arrayLayers) > 1)) return nullptr;
+
+		// Levels are filtered from the source, then each one is encoded on its own.
+		bool SRGB = (CreateInfo.format == gpu::image::format::R8G8B8A8_SRGB);
+		mipmap::settings Settings;
+		Settings.SRGB 			= SRGB;
+		Settings.NormalMap 		= (aSlot == material::NORMAL);
+		Settings.ThreadCount 	= aThreadCount;
+		mipmap Chain(aImage, Settings);
+		if (Chain.Level.empty()) return nullptr;
+		const mipmap::level& Base = Chain.Level[0];
+		int Format = select_format(aSlot, has_alpha(Base.Data.data(), Base.Width, Base.Height));
+
+		std::vector<uchar> Data;
+		for (const mipmap::level& Level : Chain.Level) {
+			std::shared_ptr<const compressed_texture> Encoded;
+			if (aCache != nullptr) {
+				Encoded = aCache->get(Level.Data.data(), Level.Width, Level.Height, Format, aThreadCount);
+			}
+			else {
+				Encoded = std::make_shared<const compressed_texture>(Level.Data.data(), Level.Width, Level.Height, Format, aThreadCount);
+			}
+			Data.insert(Data.end(), Encoded->Data.begin(), Encoded->Data.end());
+		}
+
+		std::shared_ptr<gpu::image> Image = geodesy::make<gpu::image>((gpu::image::format)image_format(Format, SRGB), Base.Width, Base.Height, 1, 1, Data.size(), (void*)Data.data());
+		Image->Path 					= aImage.Path;
+		Image->CreateInfo.mipLevels 	= (uint)Chain.Level.size();
+		return Image;
+	}
+
+	int compressed_texture::select_format(material::texture_slot aSlot, bool aHasAlpha) {
+		switch (aSlot) {
+		case material::NORMAL:
+			return BC5;
+		case material::OPACITY:
+		case material::HEIGHT:
+		case material::AMBIENT_OCCLUSION:
+		case material::ROUGHNESS:
+		case material::METALLIC:
+		case material::SHININESS:
+			return BC4;
+		default:
+			return aHasAlpha ? BC7 : BC1;
+		}
+	}
+
+	bool compressed_texture::has_alpha(const uchar* aData, uint aWidth, uint aHeight) {
+		size_t Count = (size_t)aWidth * aHeight;
+		for (size_t i = 0; i < Count; i++) {
+			if (aData[4 * i + 3] != 255) return true;
+		}
+		return false;
+	}
+
+	float compressed_texture::psnr(const uchar* aReference, const uchar* aTest, uint aWidth, uint aHeight, int aFormat) {
+		int ChannelCount = channel_count(aFormat);
+		size_t Count = (size_t)aWidth * aHeight;
+		double SquaredError = 0.0;
+		for (size_t i = 0; i < Count; i++) {
+			for (int c = 0; c < ChannelCount; c++) {
+				double Difference = (double)aReference[4 * i + c] - (double)aTest[4 * i + c];
+				SquaredError += Difference * Difference;
+			}
+		}
+		if ((Count == 0) || (SquaredError == 0.0)) return std::numeric_limits<float>::infinity();
+		double MSE = SquaredError / (double)(Count * ChannelCount);
+		return (float)(10.0 * std::log10((255.0 * 255.0) / MSE));
+	}
+
+	uint64_t compressed_texture::hash(const uchar* aData, uint aWidth, uint aHeight, int aFormat) {
+		// FNV-1a over the pixels, dimensions and target format.
+		uint64_t Hash = 14695981039346656037ull;
+		auto Mix = [&Hash](const uchar* aBytes, size_t aSize) {
+			for (size_t i = 0; i < aSize; i++) {
+				Hash ^= aBytes[i];
+				Hash *= 1099511628211ull;
+			}
+		};
+		Mix((const uchar*)&aWidth, sizeof(aWidth));
+		Mix((const uchar*)&aHeight, sizeof(aHeight));
+		Mix((const uchar*)&aFormat, sizeof(aFormat));
+		if (aData != nullptr) {
+			Mix(aData, (size_t)aWidth * aHeight * 4);
+		}
+		return Hash;
+	}
+
+}
@@ -0,0 +1,220 @@
+#include <geodesy/gfx/crowd.h>
+#include <geodesy/gfx/backend.h>
+#include <geodesy/gfx/trace.h>
+
+#include <algorithm>
+
+#include "parallel.h"
+
+namespace geodesy::gfx {
+
+	using namespace gpu;
+
+	// Storage buffer offsets are kept aligned so each batch can be bound on its own.
+	static const size_t BatchAlignment = 256;
+
+	// Members are only worth a thread of their own in chunks of this size.
+	static const size_t MemberGrain = 64;
+
+	crowd::member::member() {
+		this->Transform = {
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f
+		};
+		this->Animation 	= -1;
+		this->Time 			= 0.0;
+	}
+
+	crowd::batch::batch() {
+		this->Instance 		= nullptr;
+		this->MeshIndex 	= -1;
+		this->MaterialIndex = UINT32_MAX;
+		this->BoneCount 	= 0;
+		this->Offset 		= 0;
+		this->Stride 		= 0;
+	}
+
+	crowd::crowd() {
+		this->Context 		= nullptr;
+		this->Prototype 	= nullptr;
+		this->ThreadCount 	= 0;
+		this->Capacity 		= 0;
+	}
+
+	crowd::crowd(std::shared_ptr<gpu::context> aContext, std::shared_ptr<model> aPrototype, size_t aCapacity) : crowd() {
+		this->Context 		= aContext;
+		this->Prototype 	= aPrototype;
+
+		// Share compressed clips with the prototype, otherwise compress its tracks once for the whole crowd.
+		if (aPrototype->CompressedAnimation.size() > 0) {
+			this->Clip = aPrototype->CompressedAnimation;
+		}
+		else {
+			for (const phys::animation& Animation : aPrototype->Animation) {
+				this->Clip.push_back(std::make_shared<animation>(Animation));
+			}
+		}
+
+		// Flatten the prototype hierarchy, then resolve every mesh instance and bone to a node index.
+		this->flatten(aPrototype->Hierarchy.get(), -1);
+		std::vector<gfx::mesh::instance*> Instance = aPrototype->Hierarchy->gather_instances();
+		for (size_t i = 0; i < Instance.size(); i++) {
+			// Instances whose node is not part of the hierarchy have nothing to be posed by.
+			int NodeIndex = this->index_of(Instance[i]->Parent);
+			if (NodeIndex < 0) continue;
+			batch Batch;
+			Batch.Instance 					= Instance[i];
+			Batch.MeshIndex 				= Instance[i]->MeshIndex;
+			Batch.MaterialIndex 			= Instance[i]->MaterialIndex;
+			const std::vector<mesh::bone>& Bone = *Instance[i]->Bone;
+			Batch.BoneCount 				= Bone.size();
+			this->Batch.push_back(Batch);
+			this->InstanceNodeIndex.push_back(NodeIndex);
+			this->BoneNodeIndex.emplace_back(Bone.size());
+			this->BoneOffset.emplace_back(Bone.size());
+			for (size_t j = 0; j < Bone.size(); j++) {
+				this->BoneNodeIndex.back()[j] 	= this->index_of(aPrototype->Hierarchy->find(Bone[j].Name));
+				this->BoneOffset.back()[j] 		= Bone[j].Offset;
+			}
+		}
+
+		// Resolve the channel of every node once, instead of searching by name for every member.
+		this->ClipChannel.resize(this->Clip.size());
+		for (size_t c = 0; c < this->Clip.size(); c++) {
+			this->ClipChannel[c].resize(this->Node.size(), nullptr);
+			for (size_t k = 0; k < this->Node.size(); k++) {
+				auto It = this->Clip[c]->Channel.find(this->Node[k]->Identifier);
+				if (It != this->Clip[c]->Channel.end()) {
+					this->ClipChannel[c][k] = &It->second;
+				}
+			}
+		}
+
+		this->reserve(std::max(aCapacity, (size_t)1));
+	}
+
+	size_t crowd::add(math::mat<float, 4, 4> aTransform, int aAnimation, double aTime) {
+		if (this->Member.size() == this->Capacity) {
+			this->reserve(2 * this->Capacity);
+		}
+		member NewMember;
+		NewMember.Transform 	= aTransform;
+		NewMember.Animation 	= aAnimation;
+		NewMember.Time 			= aTime;
+		this->Member.push_back(NewMember);
+		return this->Member.size() - 1;
+	}
+
+	void crowd::remove(size_t aIndex) {
+		if (aIndex >= this->Member.size()) return;
+		this->Member[aIndex] = this->Member.back();
+		this->Member.pop_back();
+	}
+
+	void crowd::reserve(size_t aCapacity) {
+		if (aCapacity <= this->Capacity) return;
+		this->Capacity = aCapacity;
+		this->layout();
+
+		size_t Size = 0;
+		if (this->Batch.size() > 0) {
+			Size = this->Batch.back().Offset + this->Batch.back().Stride * this->Capacity;
+		}
+		Size = std::max(Size, BatchAlignment);
+
+		// Instance data is rewritten every update, so the old contents are not carried over.
+		backend* Backend = backend::get(this->Context);
+		if (Backend != nullptr) {
+			buffer::create_info IBCI;
+			IBCI.Memory = device::memory::HOST_VISIBLE | device::memory::HOST_COHERENT;
+			IBCI.Usage = buffer::usage::STORAGE | buffer::usage::VERTEX | buffer::usage::TRANSFER_SRC | buffer::usage::TRANSFER_DST;
+			this->InstanceBuffer = Backend->create_buffer(this->Context, IBCI, Size, nullptr, memory_ledger::CROWD_INSTANCE);
+			Backend->map(*this->InstanceBuffer, 0, Size);
+		}
+		else {
+			this->HostInstanceData.resize(Size);
+		}
+	}
+
+	size_t crowd::capacity() const {
+		return this->Capacity;
+	}
+
+	size_t crowd::size() const {
+		return this->Member.size();
+	}
+
+	void crowd::update(double aDeltaTime) {
+		GEODESY_GFX_TRACE_ZONE("crowd::update");
+		uchar* Data = (uchar*)this->data();
+		if (Data == nullptr) return;
+		this->NodeTransform.resize(parallel::thread_count(this->ThreadCount));
+		parallel::for_range(this->Member.size(), this->ThreadCount, MemberGrain, [&](size_t aBegin, size_t aEnd, size_t aThreadIndex) {
+			std::vector<math::mat<float, 4, 4>>& NodeTransform = this->NodeTransform[aThreadIndex];
+			NodeTransform.resize(this->Node.size());
+			for (size_t m = aBegin; m < aEnd; m++) {
+				member& Member = this->Member[m];
+				Member.Time += aDeltaTime;
+
+				// Pose the flattened hierarchy for this member in model space.
+				const animation* Clip = nullptr;
+				const animation::channel* const* Channel = nullptr;
+				if ((Member.Animation >= 0) && ((size_t)Member.Animation < this->Clip.size())) {
+					Clip = this->Clip[Member.Animation].get();
+					Channel = this->ClipChannel[Member.Animation].data();
+				}
+				double Tick = Clip != nullptr ? Clip->tick(Member.Time) : 0.0;
+				for (size_t k = 0; k < this->Node.size(); k++) {
+					math::mat<float, 4, 4> Local = (Channel != nullptr) && (Channel[k] != nullptr) ? (*Channel[k])[Tick] : this->Node[k]->TransformToParentDefault;
+					NodeTransform[k] = this->ParentIndex[k] < 0 ? Local : NodeTransform[this->ParentIndex[k]] * Local;
+				}
+
+				// Scatter the pose into every batch.
+				for (size_t b = 0; b < this->Batch.size(); b++) {
+					math::mat<float, 4, 4>* Element = (math::mat<float, 4, 4>*)(Data + this->Batch[b].Offset + m * this->Batch[b].Stride);
+					Element[0] = Member.Transform;
+					Element[1] = NodeTransform[this->InstanceNodeIndex[b]];
+					for (size_t j = 0; j < this->BoneNodeIndex[b].size(); j++) {
+						int BoneIndex = this->BoneNodeIndex[b][j];
+						Element[2 + j] = (BoneIndex >= 0 ? NodeTransform[BoneIndex] : Element[1]) * this->BoneOffset[b][j];
+					}
+				}
+			}
+		});
+	}
+
+	void* crowd::data() {
+		if (this->InstanceBuffer != nullptr) {
+			return this->InstanceBuffer->Ptr;
+		}
+		return this->HostInstanceData.size() > 0 ? this->HostInstanceData.data() : nullptr;
+	}
+
+	void crowd::flatten(const phys::node* aNode, int aParentIndex) {
+		if (aNode == nullptr) return;
+		int Index = (int)this->Node.size();
+		this->Node.push_back(aNode);
+		this->ParentIndex.push_back(aParentIndex);
+		for (const phys::node* Child : aNode->Child) {
+			this->flatten(Child, Index);
+		}
+	}
+
+	int crowd::index_of(const phys::node* aNode) const {
+		auto It = std::find(this->Node.begin(), this->Node.end(), aNode);
+		return It != this->Node.end() ? (int)(It - this->Node.begin()) : -1;
+	}
+
+	void crowd::layout() {
+		size_t Offset = 0;
+		for (batch& Batch : this->Batch) {
+			Batch.Stride = (2 + Batch.BoneCount) * sizeof(math::mat<float, 4, 4>);
+			Batch.Offset = Offset;
+			Offset += Batch.Stride * this->Capacity;
+			Offset = ((Offset + BatchAlignment - 1) / BatchAlignment) * BatchAlignment;
+		}
+	}
+
+}
@@ -0,0 +1,255 @@
+#include <geodesy/gfx/draw_list.h>
+#include <geodesy/gfx/trace.h>
+
+#include <chrono>
+#include <algorithm>
+
+#include <geodesy/gfx/model.h>
+
+#include "parallel.h"
+
+namespace geodesy::gfx {
+
+	// Draws are only worth a thread of their own in chunks of this size.
+	static const size_t DrawGrain = 8192;
+
+	// Largest material and mesh ids the key fields hold, larger ids saturate to these.
+	static const uint OpaqueIDLimit 		= 0xFFFF;
+	static const uint TranslucentIDLimit 	= 0x3FFF;
+
+	static double seconds_since(std::chrono::steady_clock::time_point aStart) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - aStart).count();
+	}
+
+	draw_list::statistics::statistics() {
+		this->DrawCount 		= 0;
+		this->BatchCount 		= 0;
+		this->StateChangeCount 	= 0;
+		this->SortPassCount 	= 0;
+		this->SaturatedKeyCount = 0;
+		this->KeyTime 			= 0.0;
+		this->SortTime 			= 0.0;
+		this->BatchTime 		= 0.0;
+	}
+
+	draw_list::draw_list() {
+		this->FarDistance 	= 1000.0f;
+		this->ThreadCount 	= 0;
+	}
+
+	void draw_list::clear() {
+		this->Draw.clear();
+		this->Key.clear();
+		this->Order.clear();
+		this->Batch.clear();
+	}
+
+	void draw_list::add(const mesh::instance* aInstance, const mesh* aMesh, const material* aMaterial, uint aPipeline, float aDepth) {
+		draw Draw;
+		Draw.Instance 		= aInstance;
+		Draw.Mesh 			= aMesh;
+		Draw.Material 		= aMaterial;
+		Draw.Pipeline 		= aPipeline;
+		Draw.Depth 			= aDepth;
+		Draw.MaterialKey 	= 0;
+		Draw.MeshKey 		= 0;
+		this->Draw.push_back(Draw);
+	}
+
+	void draw_list::add(model& aModel, uint aPipeline, math::vec<float, 3> aCameraPosition, math::vec<float, 3> aCameraForward) {
+		if (aModel.Hierarchy == nullptr) return;
+		std::vector<mesh::instance*> Instance = aModel.Hierarchy->gather_instances();
+		this->Draw.reserve(this->Draw.size() + Instance.size());
+		for (const mesh::instance* I : Instance) {
+			if ((I->MeshIndex < 0) || ((size_t)I->MeshIndex >= aModel.Mesh.size()) || (I->MaterialIndex >= aModel.Material.size())) continue;
+			const mesh* Mesh = aModel.Mesh[I->MeshIndex].get();
+			// Measure from the mesh's world space center of mass, not the node origin.
+			math::vec<float, 3> Center = Mesh != nullptr ? Mesh->CenterOfMass : math::vec<float, 3>(0.0f, 0.0f, 0.0f);
+			math::vec<float, 3> World = Center;
+			if (I->Parent != nullptr) {
+				const math::mat<float, 4, 4>& Transform = I->Parent->TransformToWorld;
+				for (size_t i = 0; i < 3; i++) {
+					World[i] = Transform(i, 0) * Center[0] + Transform(i, 1) * Center[1] + Transform(i, 2) * Center[2] + Transform(i, 3);
+				}
+			}
+			float Depth =
+				(World[0] - aCameraPosition[0]) * aCameraForward[0] +
+				(World[1] - aCameraPosition[1]) * aCameraForward[1] +
+				(World[2] - aCameraPosition[2]) * aCameraForward[2];
+			this->add(I, Mesh, aModel.Material[I->MaterialIndex].get(), aPipeline, Depth);
+		}
+	}
+
+	void draw_list::build() {
+		GEODESY_GFX_TRACE_ZONE("draw_list::build");
+		size_t Count = this->Draw.size();
+		this->Statistics = statistics();
+		this->Statistics.DrawCount = Count;
+
+		// Generate keys. Ids are dense over this frame's draws only, so they stay within the
+		// key fields for as long as the frame does.
+		auto Start = std::chrono::steady_clock::now();
+		this->MaterialID.clear();
+		this->MeshID.clear();
+		for (draw& Draw : this->Draw) {
+			Draw.MaterialKey 	= this->material_id(Draw.Material);
+			Draw.MeshKey 		= this->mesh_id(Draw.Mesh);
+			bool Translucent = (Draw.Material != nullptr) && (Draw.Material->UniformData.Transparency == material::transparency::TRANSLUCENT);
+			uint Limit = Translucent ? TranslucentIDLimit : OpaqueIDLimit;
+			if ((Draw.MaterialKey > Limit) || (Draw.MeshKey > Limit)) {
+				this->Statistics.SaturatedKeyCount += 1;
+			}
+		}
+		this->Key.resize(Count);
+		this->Order.resize(Count);
+		parallel::for_range(Count, this->ThreadCount, DrawGrain, [&](size_t aBegin, size_t aEnd, size_t) {
+			for (size_t i = aBegin; i < aEnd; i++) {
+				this->Key[i] = this->key(this->Draw[i]);
+				this->Order[i] = (uint)i;
+			}
+		});
+		this->Statistics.KeyTime = seconds_since(Start);
+
+		// Sort.
+		Start = std::chrono::steady_clock::now();
+		this->Statistics.SortPassCount = radix_sort(this->Key, this->Order, this->ThreadCount);
+		this->Statistics.SortTime = seconds_since(Start);
+
+		// Merge runs of identical state into batches.
+		Start = std::chrono::steady_clock::now();
+		this->Batch.clear();
+		for (size_t i = 0; i < Count; i++) {
+			const draw& Draw = this->Draw[this->Order[i]];
+			int Transparency = Draw.Material != nullptr ? Draw.Material->UniformData.Transparency : material::transparency::OPAQUE;
+			if (!this->Batch.empty()) {
+				batch& Last = this->Batch.back();
+				if ((Last.Transparency == Transparency) && (Last.Pipeline == Draw.Pipeline) && (Last.Material == Draw.Material) && (Last.Mesh == Draw.Mesh)) {
+					Last.Count += 1;
+					continue;
+				}
+				if ((Last.Pipeline != Draw.Pipeline) || (Last.Material != Draw.Material)) {
+					this->Statistics.StateChangeCount += 1;
+				}
+			}
+			batch Batch;
+			Batch.Transparency 	= Transparency;
+			Batch.Pipeline 		= Draw.Pipeline;
+			Batch.Mesh 			= Draw.Mesh;
+			Batch.Material 		= Draw.Material;
+			Batch.First 		= (uint)i;
+			Batch.Count 		= 1;
+			this->Batch.push_back(Batch);
+		}
+		this->Statistics.BatchCount = this->Batch.size();
+		this->Statistics.BatchTime = seconds_since(Start);
+	}
+
+	uint64_t draw_list::key(const draw& aDraw) const {
+		uint64_t Transparency = aDraw.Material != nullptr ? (uint64_t)std::clamp(aDraw.Material->UniformData.Transparency, 0, 3) : 0;
+		float Depth = this->FarDistance > 0.0f ? std::clamp(aDraw.Depth / this->FarDistance, 0.0f, 1.0f) : 0.0f;
+		uint64_t Pipeline = aDraw.Pipeline & 0x3FF;
+		if (Transparency == material::transparency::TRANSLUCENT) {
+			// Back to front first, state second.
+			uint64_t InverseDepth = 0xFFFFFF - (uint64_t)(Depth * (float)0xFFFFFF);
+			uint64_t Material = std::min(aDraw.MaterialKey, TranslucentIDLimit);
+			uint64_t Mesh = std::min(aDraw.MeshKey, TranslucentIDLimit);
+			return (Transparency << 62) | (InverseDepth << 38) | (Pipeline << 28) | (Material << 14) | Mesh;
+		}
+		// State first, front to back within a state for early depth rejection.
+		uint64_t FrontDepth = (uint64_t)(Depth * (float)0xFFFFF);
+		uint64_t Material = std::min(aDraw.MaterialKey, OpaqueIDLimit);
+		uint64_t Mesh = std::min(aDraw.MeshKey, OpaqueIDLimit);
+		return (Transparency << 62) | (Pipeline << 52) | (Material << 36) | (Mesh << 20) | FrontDepth;
+	}
+
+	size_t draw_list::radix_sort(std::vector<uint64_t>& aKey, std::vector<uint>& aValue, size_t aThreadCount) {
+		size_t Count = aKey.size();
+		if (Count < 2) return 0;
+
+		// Same split as parallel::for_range, so each thread's histogram matches the range it scatters.
+		size_t ThreadCount = std::min(parallel::thread_count(aThreadCount), std::max((size_t)1, Count / DrawGrain));
+
+		// Global histograms of every byte in one pass, to skip bytes all keys share.
+		std::vector<size_t> Global(8 * 256, 0);
+		{
+			std::vector<std::vector<size_t>> Local(ThreadCount, std::vector<size_t>(8 * 256, 0));
+			parallel::for_range(Count, ThreadCount, DrawGrain, [&](size_t aBegin, size_t aEnd, size_t aThread) {
+				std::vector<size_t>& Histogram = Local[aThread];
+				for (size_t i = aBegin; i < aEnd; i++) {
+					uint64_t K = aKey[i];
+					for (size_t b = 0; b < 8; b++) {
+						Histogram[256 * b + ((K >> (8 * b)) & 0xFF)] += 1;
+					}
+				}
+			});
+			for (const std::vector<size_t>& Histogram : Local) {
+				for (size_t i = 0; i < Global.size(); i++) Global[i] += Histogram[i];
+			}
+		}
+
+		std::vector<uint64_t> KeyScratch(Count);
+		std::vector<uint> ValueScratch(Count);
+		std::vector<size_t> Offset(ThreadCount * 256);
+		size_t PassCount = 0;
+		for (size_t b = 0; b < 8; b++) {
+			bool Skip = false;
+			for (size_t d = 0; d < 256; d++) {
+				if (Global[256 * b + d] == Count) {
+					Skip = true;
+					break;
+				}
+			}
+			if (Skip) continue;
+			size_t Shift = 8 * b;
+
+			// Per thread histograms of this byte.
+			std::fill(Offset.begin(), Offset.end(), 0);
+			parallel::for_range(Count, ThreadCount, DrawGrain, [&](size_t aBegin, size_t aEnd, size_t aThread) {
+				size_t* Histogram = &Offset[256 * aThread];
+				for (size_t i = aBegin; i < aEnd; i++) {
+					Histogram[(aKey[i] >> Shift) & 0xFF] += 1;
+				}
+			});
+
+			// Exclusive prefix over digits, then threads, keeps the sort stable.
+			size_t Sum = 0;
+			for (size_t d = 0; d < 256; d++) {
+				for (size_t t = 0; t < ThreadCount; t++) {
+					size_t Bucket = Offset[256 * t + d];
+					Offset[256 * t + d] = Sum;
+					Sum += Bucket;
+				}
+			}
+
+			parallel::for_range(Count, ThreadCount, DrawGrain, [&](size_t aBegin, size_t aEnd, size_t aThread) {
+				size_t* Position = &Offset[256 * aThread];
+				for (size_t i = aBegin; i < aEnd; i++) {
+					size_t Destination = Position[(aKey[i] >> Shift) & 0xFF]++;
+					KeyScratch[Destination] = aKey[i];
+					ValueScratch[Destination] = aValue[i];
+				}
+			});
+			aKey.swap(KeyScratch);
+			aValue.swap(ValueScratch);
+			PassCount += 1;
+		}
+		return PassCount;
+	}
+
+	uint draw_list::material_id(const material* aMaterial) {
+		auto It = this->MaterialID.find(aMaterial);
+		if (It != this->MaterialID.end()) return It->second;
+		uint ID = (uint)this->MaterialID.size();
+		this->MaterialID.emplace(aMaterial, ID);
+		return ID;
+	}
+
+	uint draw_list::mesh_id(const mesh* aMesh) {
+		auto It = this->MeshID.find(aMesh);
+		if (It != this->MeshID.end()) return It->second;
+		uint ID = (uint)this->MeshID.size();
+		this->MeshID.emplace(aMesh, ID);
+		return ID;
+	}
+
+}
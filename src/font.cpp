@@ -1,4 +1,5 @@
 #include <geodesy/gfx/font.h>
+#include <geodesy/gfx/trace.h>
 
 #include <stdlib.h>
 #include <string.h>
@@ -18,6 +19,7 @@ namespace geodesy::gfx {
 	font::font(std::string aFilePath) 
 	//: io::file(aFilePath) 
 	{
+		GEODESY_GFX_TRACE_ZONE("font::bake");
 
 		FT_Face Face;
 		FT_Error ErrorCodeFT;
@@ -0,0 +1,64 @@
+#pragma once
+#ifndef GEODESY_GFX_IMPORTER_POOL_H
+#define GEODESY_GFX_IMPORTER_POOL_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <assimp/Importer.hpp>
+
+// Internal pool of Assimp importers. An importer is not thread safe, but separate
+// importers are, so every import leases its own and returns it when done. Idle
+// importers are kept to avoid rebuilding the loader registry on every import.
+
+namespace geodesy::gfx::importer_pool {
+
+	struct state {
+		std::mutex 											Mutex;
+		std::vector<std::unique_ptr<Assimp::Importer>> 		Idle;
+	};
+
+	inline std::shared_ptr<state> instance() {
+		static std::shared_ptr<state> State = std::make_shared<state>();
+		return State;
+	}
+
+	// Leases an importer, it goes back to the pool with its scene freed once the last
+	// reference is dropped. The lease keeps the pool alive, so it may outlive terminate().
+	inline std::shared_ptr<Assimp::Importer> acquire() {
+		std::shared_ptr<state> State = instance();
+		Assimp::Importer* Importer = nullptr;
+		{
+			std::lock_guard<std::mutex> Lock(State->Mutex);
+			if (!State->Idle.empty()) {
+				Importer = State->Idle.back().release();
+				State->Idle.pop_back();
+			}
+		}
+		if (Importer == nullptr) {
+			Importer = new Assimp::Importer();
+		}
+		return std::shared_ptr<Assimp::Importer>(Importer, [State](Assimp::Importer* aImporter) {
+			aImporter->FreeScene();
+			std::lock_guard<std::mutex> Lock(State->Mutex);
+			State->Idle.emplace_back(aImporter);
+		});
+	}
+
+	// Destroys idle importers, leased ones are returned as usual.
+	inline void clear() {
+		std::shared_ptr<state> State = instance();
+		std::lock_guard<std::mutex> Lock(State->Mutex);
+		State->Idle.clear();
+	}
+
+	inline size_t idle_count() {
+		std::shared_ptr<state> State = instance();
+		std::lock_guard<std::mutex> Lock(State->Mutex);
+		return State->Idle.size();
+	}
+
+}
+
+#endif // !GEODESY_GFX_IMPORTER_POOL_H
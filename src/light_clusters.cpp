@@ -0,0 +1,230 @@
+#include <geodesy/gfx/light_clusters.h>
+#include <geodesy/gfx/trace.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "parallel.h"
+
+namespace geodesy::gfx {
+
+	static double seconds_since(std::chrono::steady_clock::time_point aStart) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - aStart).count();
+	}
+
+	static float dot(const math::vec<float, 3>& aA, const math::vec<float, 3>& aB) {
+		return aA[0] * aB[0] + aA[1] * aB[1] + aA[2] * aB[2];
+	}
+
+	light_clusters::camera::camera() {
+		this->Position 		= { 0.0f, 0.0f, 0.0f };
+		this->Right 		= { 1.0f, 0.0f, 0.0f };
+		this->Up 			= { 0.0f, 1.0f, 0.0f };
+		this->Forward 		= { 0.0f, 0.0f, 1.0f };
+		this->FieldOfView 	= 1.0f;
+		this->AspectRatio 	= 16.0f / 9.0f;
+		this->Near 			= 0.1f;
+		this->Far 			= 1000.0f;
+	}
+
+	light_clusters::settings::settings() {
+		this->X 			= 16;
+		this->Y 			= 9;
+		this->Z 			= 24;
+		this->Threshold 	= 0.01f;
+		this->MaxRange 		= 100.0f;
+		this->ThreadCount 	= 0;
+	}
+
+	light_clusters::statistics::statistics() {
+		this->LightCount 		= 0;
+		this->IndexCount 		= 0;
+		this->MaxClusterCount 	= 0;
+		this->BuildTime 		= 0.0;
+	}
+
+	light_clusters::light_clusters(settings aSettings) {
+		this->Settings 		= aSettings;
+		this->UniformData 	= {};
+	}
+
+	void light_clusters::build(const std::vector<model::light>& aLight, const camera& aCamera) {
+		GEODESY_GFX_TRACE_ZONE("light_clusters::build");
+		auto Start = std::chrono::steady_clock::now();
+		this->prepare(aLight, aCamera);
+		const uint X = this->Settings.X, Y = this->Settings.Y, Z = this->Settings.Z;
+		const size_t SliceSize = (size_t)X * Y;
+
+		// Each slice gathers (cluster, light) pairs from the lights whose depth range
+		// covers it, then counting sorts them by cluster. Lights are visited in order,
+		// so every cluster's list stays ascending.
+		std::vector<std::vector<uint>> SliceIndex(Z);
+		std::vector<uint> Count(SliceSize * Z, 0);
+		parallel::for_range(Z, this->Settings.ThreadCount, 1, [&](size_t aBegin, size_t aEnd, size_t) {
+			std::vector<std::pair<uint, uint>> Pair;
+			for (size_t k = aBegin; k < aEnd; k++) {
+				Pair.clear();
+				for (const view_light& Light : this->ViewLight) {
+					if ((k < Light.Begin[2]) || (k > Light.End[2])) continue;
+					for (uint j = Light.Begin[1]; j <= Light.End[1]; j++) {
+						for (uint i = Light.Begin[0]; i <= Light.End[0]; i++) {
+							if (!this->overlaps(Light, i, j, (uint)k)) continue;
+							Pair.emplace_back(i + X * j, Light.Light);
+						}
+					}
+				}
+				uint* SliceCount = &Count[k * SliceSize];
+				for (const auto& [Cluster, Light] : Pair) {
+					SliceCount[Cluster] += 1;
+				}
+				std::vector<uint> Offset(SliceSize, 0);
+				for (size_t c = 1; c < SliceSize; c++) {
+					Offset[c] = Offset[c - 1] + SliceCount[c - 1];
+				}
+				SliceIndex[k].resize(Pair.size());
+				for (const auto& [Cluster, Light] : Pair) {
+					SliceIndex[k][Offset[Cluster]++] = Light;
+				}
+			}
+		});
+
+		// Slices are contiguous in cluster order, so each one copies straight into place.
+		this->finish(Count);
+		parallel::for_range(Z, this->Settings.ThreadCount, 1, [&](size_t aBegin, size_t aEnd, size_t) {
+			for (size_t k = aBegin; k < aEnd; k++) {
+				std::copy(SliceIndex[k].begin(), SliceIndex[k].end(), this->Index.begin() + this->Cluster[k * SliceSize].Offset);
+			}
+		});
+		this->Statistics.BuildTime = seconds_since(Start);
+	}
+
+	void light_clusters::build_brute_force(const std::vector<model::light>& aLight, const camera& aCamera) {
+		auto Start = std::chrono::steady_clock::now();
+		this->prepare(aLight, aCamera);
+		const uint X = this->Settings.X, Y = this->Settings.Y, Z = this->Settings.Z;
+
+		std::vector<uint> Count((size_t)X * Y * Z, 0);
+		std::vector<uint> Index;
+		for (uint k = 0; k < Z; k++) {
+			for (uint j = 0; j < Y; j++) {
+				for (uint i = 0; i < X; i++) {
+					for (const view_light& Light : this->ViewLight) {
+						if (!this->overlaps(Light, i, j, k)) continue;
+						Index.push_back(Light.Light);
+						Count[i + X * (j + Y * k)] += 1;
+					}
+				}
+			}
+		}
+		this->finish(Count);
+		this->Index = std::move(Index);
+		this->Statistics.BuildTime = seconds_since(Start);
+	}
+
+	float light_clusters::range(const model::light& aLight) const {
+		float Peak = aLight.Intensity * std::max({ aLight.Color[0], aLight.Color[1], aLight.Color[2] });
+		if ((Peak <= 0.0f) || (this->Settings.Threshold <= 0.0f)) return Peak > 0.0f ? this->Settings.MaxRange : 0.0f;
+		return std::min(std::sqrt(Peak / this->Settings.Threshold), this->Settings.MaxRange);
+	}
+
+	void light_clusters::prepare(const std::vector<model::light>& aLight, const camera& aCamera) {
+		const uint X = this->Settings.X, Y = this->Settings.Y, Z = this->Settings.Z;
+		const float Near = aCamera.Near, Far = aCamera.Far;
+		const float TanY = std::tan(0.5f * aCamera.FieldOfView);
+		const float TanX = TanY * aCamera.AspectRatio;
+		const float LogRatio = std::log(Far / Near);
+		this->Statistics = statistics();
+
+		this->UniformData.X 		= X;
+		this->UniformData.Y 		= Y;
+		this->UniformData.Z 		= Z;
+		this->UniformData.ScaleZ 	= (float)Z / LogRatio;
+		this->UniformData.BiasZ 	= -(float)Z * std::log(Near) / LogRatio;
+		this->UniformData.Near 		= Near;
+		this->UniformData.Far 		= Far;
+
+		// Cluster bounds, the box around each frustum piece.
+		auto slice_depth = [&](uint aSlice) -> float {
+			return Near * std::pow(Far / Near, (float)aSlice / (float)Z);
+		};
+		this->Bounds.resize((size_t)X * Y * Z);
+		for (uint k = 0; k < Z; k++) {
+			float Z0 = slice_depth(k), Z1 = slice_depth(k + 1);
+			for (uint j = 0; j < Y; j++) {
+				float B0 = TanY * (2.0f * (float)j / (float)Y - 1.0f), B1 = TanY * (2.0f * (float)(j + 1) / (float)Y - 1.0f);
+				for (uint i = 0; i < X; i++) {
+					float A0 = TanX * (2.0f * (float)i / (float)X - 1.0f), A1 = TanX * (2.0f * (float)(i + 1) / (float)X - 1.0f);
+					bounds& Bounds = this->Bounds[i + X * (j + Y * k)];
+					Bounds.Min = { std::min(A0 * Z0, A0 * Z1), std::min(B0 * Z0, B0 * Z1), Z0 };
+					Bounds.Max = { std::max(A1 * Z0, A1 * Z1), std::max(B1 * Z0, B1 * Z1), Z1 };
+				}
+			}
+		}
+
+		// Lights to view space, with the range of tiles and slices their sphere can reach.
+		auto tile = [](float aSlope, float aTan, uint aCount) -> uint {
+			float T = std::floor((aSlope / aTan + 1.0f) * 0.5f * (float)aCount);
+			return (uint)std::clamp(T, 0.0f, (float)(aCount - 1));
+		};
+		auto slice = [&](float aDepth) -> uint {
+			float S = std::floor(std::log(aDepth / Near) / LogRatio * (float)Z);
+			return (uint)std::clamp(S, 0.0f, (float)(Z - 1));
+		};
+		this->Global.clear();
+		this->ViewLight.clear();
+		for (size_t l = 0; l < aLight.size(); l++) {
+			const model::light& Light = aLight[l];
+			if ((Light.Type == model::light::AMBIENT) || (Light.Type == model::light::DIRECTIONAL)) {
+				this->Global.push_back((uint)l);
+				continue;
+			}
+			if ((Light.Type != model::light::POINT) && (Light.Type != model::light::SPOT) && (Light.Type != model::light::AREA)) continue;
+			view_light View;
+			View.Light 		= (uint)l;
+			View.Radius 	= this->range(Light);
+			math::vec<float, 3> Offset = Light.Position - aCamera.Position;
+			View.Center 	= { dot(Offset, aCamera.Right), dot(Offset, aCamera.Up), dot(Offset, aCamera.Forward) };
+			if ((View.Radius <= 0.0f) || (View.Center[2] + View.Radius < Near) || (View.Center[2] - View.Radius > Far)) continue;
+			float Z0 = std::max(Near, View.Center[2] - View.Radius);
+			float Z1 = std::min(Far, View.Center[2] + View.Radius);
+			// Extreme slopes over the sphere's box, the nearest depth maximizes their magnitude.
+			float X0 = View.Center[0] - View.Radius, X1 = View.Center[0] + View.Radius;
+			float Y0 = View.Center[1] - View.Radius, Y1 = View.Center[1] + View.Radius;
+			View.Begin[0] 	= tile(X0 / (X0 < 0.0f ? Z0 : Z1), TanX, X);
+			View.End[0] 	= tile(X1 / (X1 > 0.0f ? Z0 : Z1), TanX, X);
+			View.Begin[1] 	= tile(Y0 / (Y0 < 0.0f ? Z0 : Z1), TanY, Y);
+			View.End[1] 	= tile(Y1 / (Y1 > 0.0f ? Z0 : Z1), TanY, Y);
+			View.Begin[2] 	= slice(Z0);
+			View.End[2] 	= slice(Z1);
+			this->ViewLight.push_back(View);
+		}
+		this->UniformData.GlobalCount = (uint)this->Global.size();
+		this->Statistics.LightCount = this->ViewLight.size();
+	}
+
+	bool light_clusters::overlaps(const view_light& aLight, uint aX, uint aY, uint aZ) const {
+		if ((aX < aLight.Begin[0]) || (aX > aLight.End[0]) || (aY < aLight.Begin[1]) || (aY > aLight.End[1]) || (aZ < aLight.Begin[2]) || (aZ > aLight.End[2])) return false;
+		const bounds& Bounds = this->Bounds[aX + this->Settings.X * (aY + this->Settings.Y * aZ)];
+		float Distance = 0.0f;
+		for (size_t i = 0; i < 3; i++) {
+			float D = std::max({ Bounds.Min[i] - aLight.Center[i], 0.0f, aLight.Center[i] - Bounds.Max[i] });
+			Distance += D * D;
+		}
+		return Distance <= aLight.Radius * aLight.Radius;
+	}
+
+	void light_clusters::finish(const std::vector<uint>& aCount) {
+		this->Cluster.resize(aCount.size());
+		uint Offset = 0;
+		for (size_t c = 0; c < aCount.size(); c++) {
+			this->Cluster[c].Offset 	= Offset;
+			this->Cluster[c].Count 		= aCount[c];
+			Offset += aCount[c];
+			this->Statistics.MaxClusterCount = std::max(this->Statistics.MaxClusterCount, (size_t)aCount[c]);
+		}
+		this->Index.resize(Offset);
+		this->Statistics.IndexCount = Offset;
+	}
+
+}
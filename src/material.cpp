@@ -1,6 +1,12 @@
 #include <geodesy/gfx/material.h>
+#include <geodesy/gfx/material_table.h>
+#include <geodesy/gfx/uniform_ring.h>
+#include <geodesy/gfx/backend.h>
+#include <geodesy/gfx/trace.h>
 
 #include <vector>
+#include <algorithm>
+#include <cstring>
 
 #include <geodesy/gpu/context.h>
 #include <geodesy/gpu/shader.h>
@@ -48,6 +54,7 @@ namespace geodesy::gfx {
 	static const unsigned char DefaultSheenData[4]              = {0, 128, 0, 255};     // FIX: No sheen, medium roughness
 	static const unsigned char DefaultClearCoatData[4]          = {0, 32, 0, 255};      // FIX: No clear coat, smooth surface
 
+	// In texture_slot order.
 	static std::vector<texture_type_database> TextureTypeDatabase = {
 		{ "Albedo", 				{ aiTextureType_DIFFUSE, aiTextureType_BASE_COLOR }, 			geodesy::make<gpu::image>(gpu::image::format::R8G8B8A8_UNORM, 2, 2, 1, 1, sizeof(DefaultColorData), (void*)DefaultColorData) 								},
 		{ "Opacity", 				{ aiTextureType_OPACITY, aiTextureType_TRANSMISSION }, 			geodesy::make<gpu::image>(gpu::image::format::R8G8B8A8_UNORM, 2, 2, 1, 1, sizeof(DefaultOpacityData), (void*)DefaultOpacityData) 							},
@@ -138,8 +145,42 @@ namespace geodesy::gfx {
 		this->Metallic 								= 0.0f;
 	}
 
+	std::array<uint32_t, material::uniform_data::WordCount> material::uniform_data::words() const {
+		float Value[] = {
+			this->AlbedoVertexWeight, this->AlbedoTextureWeight, this->AlbedoConstantWeight, this->Albedo[0], this->Albedo[1], this->Albedo[2],
+			this->OpacityTextureWeight, this->OpacityConstantWeight, this->Opacity,
+			this->RefractionIndexWeight, this->RefractionIndex,
+			this->NormalVertexWeight, this->NormalTextureWeight,
+			this->HeightScale,
+			this->EmissiveTextureWeight, this->EmissiveConstantWeight, this->Emissive[0], this->Emissive[1], this->Emissive[2],
+			this->AmbientOcclusionTextureWeight, this->AmbientOcclusionConstantWeight, this->AmbientOcclusion,
+			this->RoughnessTextureWeight, this->RoughnessConstantWeight, this->Roughness,
+			this->MetallicTextureWeight, this->MetallicConstantWeight, this->Metallic
+		};
+		int Flag[] = {
+			this->Transparency, this->AlbedoTextureExists, this->OpacityTextureExists, this->NormalTextureExists, this->HeightTextureExists, this->HeightStepCount,
+			this->EmissiveTextureExists, this->AmbientOcclusionTextureExists, this->RoughnessTextureExists, this->MetallicTextureExists
+		};
+		static_assert(sizeof(Value) + sizeof(Flag) == WordCount * sizeof(uint32_t), "every uniform field must be a word");
+		std::array<uint32_t, WordCount> Word;
+		std::memcpy(Word.data(), Value, sizeof(Value));
+		std::memcpy(Word.data() + sizeof(Value) / sizeof(float), Flag, sizeof(Flag));
+		return Word;
+	}
+
+	bool material::uniform_data::operator==(const uniform_data& aData) const {
+		return this->words() == aData.words();
+	}
+
+	bool material::uniform_data::operator!=(const uniform_data& aData) const {
+		return !(*this == aData);
+	}
+
 	material::material() {
 		this->Name = "";
+		this->DynamicOffset = 0;
+		this->Table = nullptr;
+		this->TableIndex = UINT32_MAX;
 	}
 
 	/*
@@ -467,7 +508,173 @@ namespace geodesy::gfx {
 	}
 	*/
 
+	std::shared_ptr<gpu::image> material::extract_channel(const std::shared_ptr<gpu::image>& aImage, int aChannel) {
+		uint Width = aImage->CreateInfo.extent.width;
+		uint Height = aImage->CreateInfo.extent.height;
+		std::shared_ptr<gpu::image> Channel = geodesy::make<gpu::image>(gpu::image::format::R8G8B8A8_UNORM, Width, Height);
+		math::vec<uchar, 4>* SourcePixelArray = (math::vec<uchar, 4>*)aImage->HostData;
+		math::vec<uchar, 4>* ChannelPixelArray = (math::vec<uchar, 4>*)Channel->HostData;
+		for (size_t i = 0; i < (size_t)Width * Height; i++) {
+			uchar Value = SourcePixelArray[i][aChannel];
+			ChannelPixelArray[i] = { Value, Value, Value, 255 };
+		}
+		Channel->Path = aImage->Path;
+		return Channel;
+	}
+
+	const char* material::texture_slot_name(texture_slot aSlot) {
+		return (aSlot >= 0) && (aSlot < TEXTURE_SLOT_COUNT) ? TextureTypeDatabase[aSlot].Name.c_str() : "";
+	}
+
+	material::texture_slot material::find_texture_slot(const std::string& aName) {
+		for (int Slot = 0; Slot < TEXTURE_SLOT_COUNT; Slot++) {
+			if (TextureTypeDatabase[Slot].Name == aName) return (texture_slot)Slot;
+		}
+		return TEXTURE_SLOT_COUNT;
+	}
+
+	material::material(const aiMaterial* aMaterial, std::string aDirectory) : material() {
+		GEODESY_GFX_TRACE_ZONE("material::convert");
+		this->Name = aMaterial->GetName().C_Str();
+
+		// Load material constants, missing keys keep the defaults.
+		{
+			aiColor3D Diffuse, Emissive;
+			float Opacity = 1.0f, RefractionIndex = 1.0f, Metallic = 0.0f, Roughness = 0.5f, BumpScaling = 1.0f;
+			if (aMaterial->Get(AI_MATKEY_COLOR_DIFFUSE, Diffuse) == AI_SUCCESS) {
+				this->UniformData.Albedo = math::vec<float, 3>(Diffuse.r, Diffuse.g, Diffuse.b);
+			}
+			if (aMaterial->Get(AI_MATKEY_COLOR_EMISSIVE, Emissive) == AI_SUCCESS) {
+				this->UniformData.Emissive = math::vec<float, 3>(Emissive.r, Emissive.g, Emissive.b);
+				this->UniformData.EmissiveConstantWeight = ((Emissive.r > 0.0f) || (Emissive.g > 0.0f) || (Emissive.b > 0.0f)) ? 1.0f : 0.0f;
+			}
+			if (aMaterial->Get(AI_MATKEY_OPACITY, Opacity) == AI_SUCCESS) {
+				this->UniformData.Opacity = Opacity;
+			}
+			if (aMaterial->Get(AI_MATKEY_REFRACTI, RefractionIndex) == AI_SUCCESS) {
+				this->UniformData.RefractionIndex = RefractionIndex;
+			}
+			if (aMaterial->Get(AI_MATKEY_METALLIC_FACTOR, Metallic) == AI_SUCCESS) {
+				this->UniformData.Metallic = Metallic;
+			}
+			if (aMaterial->Get(AI_MATKEY_ROUGHNESS_FACTOR, Roughness) == AI_SUCCESS) {
+				this->UniformData.Roughness = Roughness;
+			}
+			if (aMaterial->Get(AI_MATKEY_BUMPSCALING, BumpScaling) == AI_SUCCESS) {
+				this->UniformData.HeightScale = BumpScaling;
+			}
+		}
+
+		// Load material textures, slots sharing a file share the image.
+		std::map<std::string, std::shared_ptr<gpu::image>> Loaded;
+		for (int Slot = 0; Slot < TEXTURE_SLOT_COUNT; Slot++) {
+			const texture_type_database& TextureType = TextureTypeDatabase[Slot];
+			std::string TexturePath = absolute_texture_path(aDirectory, aMaterial, TextureType.Type);
+			if (TexturePath.length() == 0) {
+				this->Texture[Slot] = TextureType.DefaultTexture;
+				continue;
+			}
+			if (Loaded.count(TexturePath) == 0) {
+				Loaded[TexturePath] = geodesy::make<gpu::image>(TexturePath);
+			}
+			this->Texture[Slot] = Loaded[TexturePath];
+
+			// Since the texture exists, it overrides the material constant.
+			switch (Slot) {
+			case ALBEDO:
+				this->UniformData.AlbedoTextureExists = 1;
+				this->UniformData.AlbedoTextureWeight = 1.0f;
+				this->UniformData.AlbedoVertexWeight = 0.0f;
+				this->UniformData.AlbedoConstantWeight = 0.0f;
+				break;
+			case OPACITY:
+				this->UniformData.OpacityTextureExists = 1;
+				this->UniformData.OpacityTextureWeight = 1.0f;
+				this->UniformData.OpacityConstantWeight = 0.0f;
+				break;
+			case NORMAL:
+				this->UniformData.NormalTextureExists = 1;
+				this->UniformData.NormalTextureWeight = 1.0f;
+				this->UniformData.NormalVertexWeight = 0.0f;
+				break;
+			case HEIGHT:
+				this->UniformData.HeightTextureExists = 1;
+				break;
+			case EMISSIVE:
+				this->UniformData.EmissiveTextureExists = 1;
+				this->UniformData.EmissiveTextureWeight = 1.0f;
+				this->UniformData.EmissiveConstantWeight = 0.0f;
+				break;
+			case AMBIENT_OCCLUSION:
+				this->UniformData.AmbientOcclusionTextureExists = 1;
+				this->UniformData.AmbientOcclusionTextureWeight = 1.0f;
+				this->UniformData.AmbientOcclusionConstantWeight = 0.0f;
+				break;
+			case ROUGHNESS:
+				this->UniformData.RoughnessTextureExists = 1;
+				this->UniformData.RoughnessTextureWeight = 1.0f;
+				this->UniformData.RoughnessConstantWeight = 0.0f;
+				break;
+			case METALLIC:
+				this->UniformData.MetallicTextureExists = 1;
+				this->UniformData.MetallicTextureWeight = 1.0f;
+				this->UniformData.MetallicConstantWeight = 0.0f;
+				break;
+			default:
+				break;
+			}
+		}
+
+		// Unpack ambient occlusion, roughness and metallic maps packed into one file. A single
+		// file holding all three is read as R = AO, G = Roughness, B = Metallic, pairs use R and G.
+		std::shared_ptr<gpu::image> AmbientOcclusion = this->UniformData.AmbientOcclusionTextureExists ? this->Texture[AMBIENT_OCCLUSION] : nullptr;
+		std::shared_ptr<gpu::image> Roughness = this->UniformData.RoughnessTextureExists ? this->Texture[ROUGHNESS] : nullptr;
+		std::shared_ptr<gpu::image> Metallic = this->UniformData.MetallicTextureExists ? this->Texture[METALLIC] : nullptr;
+		if ((AmbientOcclusion != nullptr) && (AmbientOcclusion == Roughness) && (AmbientOcclusion == Metallic)) {
+			this->Texture[AMBIENT_OCCLUSION] = extract_channel(AmbientOcclusion, 0);
+			this->Texture[ROUGHNESS] = extract_channel(AmbientOcclusion, 1);
+			this->Texture[METALLIC] = extract_channel(AmbientOcclusion, 2);
+		}
+		else if ((AmbientOcclusion != nullptr) && (AmbientOcclusion == Metallic)) {
+			this->Texture[AMBIENT_OCCLUSION] = extract_channel(AmbientOcclusion, 0);
+			this->Texture[METALLIC] = extract_channel(AmbientOcclusion, 1);
+		}
+		else if ((AmbientOcclusion != nullptr) && (AmbientOcclusion == Roughness)) {
+			this->Texture[AMBIENT_OCCLUSION] = extract_channel(AmbientOcclusion, 0);
+			this->Texture[ROUGHNESS] = extract_channel(AmbientOcclusion, 1);
+		}
+		else if ((Metallic != nullptr) && (Metallic == Roughness)) {
+			this->Texture[METALLIC] = extract_channel(Metallic, 0);
+			this->Texture[ROUGHNESS] = extract_channel(Metallic, 1);
+		}
+
+		// Determine material transparency.
+		if ((this->UniformData.Opacity < 1.0f) || this->UniformData.OpacityTextureExists) {
+			this->UniformData.Transparency = material::transparency::TRANSLUCENT;
+		}
+		else if (this->UniformData.AlbedoTextureExists) {
+			// Classify by the alpha channel of the albedo texture.
+			std::shared_ptr<gpu::image> Albedo = this->Texture[ALBEDO];
+			if (Albedo->OpaquePercentage == 1.0f) {
+				this->UniformData.Transparency = material::transparency::OPAQUE;
+			}
+			else if (Albedo->TranslucentPercentage < 0.05f) {
+				// Mostly opaque or fully transparent texels, alpha tested.
+				this->UniformData.Transparency = material::transparency::TRANSPARENT;
+			}
+			else {
+				this->UniformData.Transparency = material::transparency::TRANSLUCENT;
+			}
+		}
+		else {
+			this->UniformData.Transparency = material::transparency::OPAQUE;
+		}
+		this->update_texture_bindings();
+	}
+
 	material::material(std::shared_ptr<gpu::context> aContext, gpu::image::create_info aCreateInfo, std::shared_ptr<material> aMaterial) : material() {
+		GEODESY_GFX_TRACE_ZONE("material::upload");
+		memory_ledger::scope Owner("material:" + aMaterial->Name);
 		this->Name              = aMaterial->Name;
 		this->UniformData       = aMaterial->UniformData;
 
@@ -476,21 +683,89 @@ namespace geodesy::gfx {
 		UBCI.Memory = device::memory::HOST_VISIBLE | device::memory::HOST_COHERENT;
 		UBCI.Usage = buffer::usage::UNIFORM | buffer::usage::TRANSFER_SRC | buffer::usage::TRANSFER_DST;
 
-		this->UniformBuffer = aContext->create<buffer>(UBCI, sizeof(uniform_data), &this->UniformData);
-		this->UniformBuffer->map_memory(0, sizeof(uniform_data));
+		backend* Backend = backend::get(aContext);
+		if (Backend == nullptr) return;
+		this->UniformBuffer = Backend->create_buffer(aContext, UBCI, sizeof(uniform_data), &this->UniformData, memory_ledger::MATERIAL_UNIFORM);
+		Backend->map(*this->UniformBuffer, 0, sizeof(uniform_data));
+
+		// Copy over and create GPU instance textures.
+		for (int Slot = 0; Slot < TEXTURE_SLOT_COUNT; Slot++) {
+			if (aMaterial->Texture[Slot] == nullptr) continue;
+			this->Texture[Slot] = Backend->create_image(aContext, aCreateInfo, aMaterial->Texture[Slot]);
+		}
+		this->update_texture_bindings();
+	}
+
+	material::material(std::shared_ptr<gpu::context> aContext, gpu::image::create_info aCreateInfo, std::shared_ptr<material> aMaterial, std::shared_ptr<material_table> aTable, uint aTableIndex) : material() {
+		GEODESY_GFX_TRACE_ZONE("material::upload");
+		memory_ledger::scope Owner("material:" + aMaterial->Name);
+		this->Name              = aMaterial->Name;
+		this->UniformData       = aMaterial->UniformData;
+		this->Table             = aTable;
+		this->TableIndex        = aTableIndex;
+
+		// Uniform data lives in the shared table, no buffer of its own.
+		this->Table->write(this->TableIndex, this->UniformData);
 
 		// Copy over and create GPU instance textures.
-		for (auto& Texture : aMaterial->Texture) {
-			this->Texture[Texture.first] = std::make_shared<gpu::image>(aContext, aCreateInfo, Texture.second);
+		backend* Backend = backend::get(aContext);
+		if (Backend == nullptr) return;
+		for (int Slot = 0; Slot < TEXTURE_SLOT_COUNT; Slot++) {
+			if (aMaterial->Texture[Slot] == nullptr) continue;
+			this->Texture[Slot] = Backend->create_image(aContext, aCreateInfo, aMaterial->Texture[Slot]);
 		}
+		this->update_texture_bindings();
 	}
 
 	material::~material() {}
 
+	void material::update_texture_bindings(uint aFirstBinding) {
+		this->TextureBinding.clear();
+		for (int Slot = 0; Slot < TEXTURE_SLOT_COUNT; Slot++) {
+			if (this->Texture[Slot] == nullptr) continue;
+			this->TextureBinding.push_back({ aFirstBinding + (uint)Slot, (texture_slot)Slot, this->Texture[Slot].get() });
+		}
+	}
+
+	uint material::features() const {
+		return features(this->UniformData);
+	}
+
+	uint material::features(const uniform_data& aUniformData) {
+		const uniform_data& U = aUniformData;
+		// A texture with no weight does not change the result, so it does not need its sampling path.
+		uint Features = 0;
+		if (U.AlbedoTextureExists && (U.AlbedoTextureWeight != 0.0f)) 						Features |= ALBEDO_TEXTURE;
+		if (U.OpacityTextureExists && (U.OpacityTextureWeight != 0.0f)) 					Features |= OPACITY_TEXTURE;
+		if (U.NormalTextureExists && (U.NormalTextureWeight != 0.0f)) 						Features |= NORMAL_TEXTURE;
+		if (U.HeightTextureExists && (U.HeightScale != 0.0f) && (U.HeightStepCount > 0)) 	Features |= HEIGHT_MAPPING;
+		if (U.EmissiveTextureExists && (U.EmissiveTextureWeight != 0.0f)) 					Features |= EMISSIVE_TEXTURE;
+		if (U.AmbientOcclusionTextureExists && (U.AmbientOcclusionTextureWeight != 0.0f)) 	Features |= AMBIENT_OCCLUSION_TEXTURE;
+		if (U.RoughnessTextureExists && (U.RoughnessTextureWeight != 0.0f)) 				Features |= ROUGHNESS_TEXTURE;
+		if (U.MetallicTextureExists && (U.MetallicTextureWeight != 0.0f)) 					Features |= METALLIC_TEXTURE;
+		if (U.AlbedoVertexWeight != 0.0f) 													Features |= VERTEX_COLOR;
+		bool EmissiveConstant = (U.EmissiveConstantWeight != 0.0f) && ((U.Emissive[0] != 0.0f) || (U.Emissive[1] != 0.0f) || (U.Emissive[2] != 0.0f));
+		if ((Features & EMISSIVE_TEXTURE) || EmissiveConstant) 							Features |= EMISSION;
+		Features |= ((uint)std::clamp(U.Transparency, (int)OPAQUE, (int)TRANSLUCENT) << TRANSPARENCY_SHIFT) & TRANSPARENCY_MASK;
+		return Features;
+	}
+
 	void material::update(double aDeltaTime) {
 		// Update Material Properties
 		// material_data MaterialData = material_data(this);
 		// memcpy(this->UniformBuffer->Ptr, &MaterialData, sizeof(material_data));
+		if (this->Table != nullptr) {
+			// Only marks the entry for upload if the data changed.
+			this->Table->write(this->TableIndex, this->UniformData);
+		}
+	}
+
+	bool material::update(double aDeltaTime, uniform_ring& aRing) {
+		this->update(aDeltaTime);
+		uniform_ring::allocation Allocation = aRing.write(&this->UniformData, sizeof(uniform_data));
+		// The previous offset may point at a recycled region, so it is not kept.
+		this->DynamicOffset = Allocation.Ptr != nullptr ? Allocation.Offset : SIZE_MAX;
+		return Allocation.Ptr != nullptr;
 	}
 
 }
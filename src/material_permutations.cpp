@@ -0,0 +1,87 @@
+#include <geodesy/gfx/material_permutations.h>
+
+#include <geodesy/gfx/model.h>
+
+namespace geodesy::gfx {
+
+	material_permutations::statistics::statistics() {
+		this->MaterialCount 	= 0;
+		this->PermutationCount 	= 0;
+		this->LookupCount 		= 0;
+		this->HitCount 			= 0;
+	}
+
+	material_permutations::material_permutations() {}
+
+	uint material_permutations::get(uint aFeatures) {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		return this->find(aFeatures);
+	}
+
+	uint material_permutations::add(const material& aMaterial) {
+		uint Features = aMaterial.features();
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		uint Index = this->find(Features);
+		this->Permutation[Index].MaterialCount += 1;
+		this->Statistics.MaterialCount += 1;
+		return Index;
+	}
+
+	std::vector<uint> material_permutations::add(const model& aModel) {
+		std::vector<uint> Result(aModel.Material.size());
+		for (size_t i = 0; i < aModel.Material.size(); i++) {
+			Result[i] = this->add(*aModel.Material[i]);
+		}
+		return Result;
+	}
+
+	material_permutations::permutation material_permutations::operator[](uint aIndex) const {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		return this->Permutation[aIndex];
+	}
+
+	size_t material_permutations::size() const {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		return this->Permutation.size();
+	}
+
+	material_permutations::statistics material_permutations::get_statistics() const {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		return this->Statistics;
+	}
+
+	void material_permutations::clear() {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		this->Index.clear();
+		this->Permutation.clear();
+		this->Statistics = statistics();
+	}
+
+	std::array<uint32_t, material_permutations::ConstantCount> material_permutations::constants(uint aFeatures) {
+		std::array<uint32_t, ConstantCount> Constant;
+		for (size_t i = 0; i < material::TRANSPARENCY_SHIFT; i++) {
+			Constant[i] = (aFeatures >> i) & 1u;
+		}
+		Constant[material::TRANSPARENCY_SHIFT] = (aFeatures & material::TRANSPARENCY_MASK) >> material::TRANSPARENCY_SHIFT;
+		return Constant;
+	}
+
+	uint material_permutations::find(uint aFeatures) {
+		this->Statistics.LookupCount += 1;
+		auto It = this->Index.find(aFeatures);
+		if (It != this->Index.end()) {
+			this->Statistics.HitCount += 1;
+			return It->second;
+		}
+		permutation Permutation;
+		Permutation.Features 		= aFeatures;
+		Permutation.Index 			= (uint)this->Permutation.size();
+		Permutation.MaterialCount 	= 0;
+		Permutation.Constant 		= constants(aFeatures);
+		this->Permutation.push_back(Permutation);
+		this->Index[aFeatures] = Permutation.Index;
+		this->Statistics.PermutationCount = this->Permutation.size();
+		return Permutation.Index;
+	}
+
+}
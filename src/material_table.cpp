@@ -0,0 +1,189 @@
+#include <geodesy/gfx/material_table.h>
+#include <geodesy/gfx/backend.h>
+#include <geodesy/gfx/trace.h>
+
+#include <cstring>
+#include <algorithm>
+
+namespace geodesy::gfx {
+
+	using namespace gpu;
+
+	// Copies start at multiples of this, the largest minStorageBufferOffsetAlignment devices report.
+	static const size_t CopyAlignment = 256;
+
+	material_table::material_table() {
+		this->Context 		= nullptr;
+		this->Buffer 		= nullptr;
+		this->FrameCount 	= 1;
+		this->Offset 		= 0;
+		this->Generation 	= 0;
+		this->DirtyIndex 	= std::vector<std::vector<uint>>(1);
+		this->Dirty 		= std::vector<std::vector<bool>>(1);
+		this->Capacity 		= 0;
+		this->CopySize 		= 0;
+		this->Serial 		= 0;
+		this->Reallocate 	= false;
+	}
+
+	material_table::material_table(std::shared_ptr<gpu::context> aContext, size_t aCapacity, size_t aFrameCount) : material_table() {
+		this->Context 		= aContext;
+		this->FrameCount 	= std::max(aFrameCount, (size_t)1);
+		this->DirtyIndex 	= std::vector<std::vector<uint>>(this->FrameCount);
+		this->Dirty 		= std::vector<std::vector<bool>>(this->FrameCount);
+		this->Capacity 		= std::max(aCapacity, (size_t)1);
+		this->Reallocate 	= true;
+	}
+
+	uint material_table::allocate(size_t aCount) {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		// First fit among released ranges.
+		for (size_t i = 0; i < this->Free.size(); i++) {
+			range& Range = this->Free[i];
+			if (Range.Count < aCount) continue;
+			uint First = Range.First;
+			Range.First += (uint)aCount;
+			Range.Count -= aCount;
+			if (Range.Count == 0) {
+				this->Free.erase(this->Free.begin() + i);
+			}
+			for (size_t j = First; j < First + aCount; j++) {
+				this->Data[j] = material::uniform_data();
+				this->mark((uint)j);
+			}
+			return First;
+		}
+
+		uint First = (uint)this->Data.size();
+		this->Data.resize(this->Data.size() + aCount);
+		for (std::vector<bool>& Dirty : this->Dirty) {
+			Dirty.resize(this->Data.size(), false);
+		}
+		for (size_t i = First; i < this->Data.size(); i++) {
+			this->mark((uint)i);
+		}
+		// Grow geometrically, the storage buffer is recreated on the next update.
+		if (this->Data.size() > this->Capacity) {
+			this->Capacity = std::max(this->Capacity, (size_t)1);
+			while (this->Capacity < this->Data.size()) {
+				this->Capacity *= 2;
+			}
+			this->Reallocate = true;
+		}
+		return First;
+	}
+
+	void material_table::release(uint aFirst, size_t aCount) {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		if ((aCount == 0) || ((size_t)aFirst + aCount > this->Data.size())) return;
+
+		// Insert in order and merge with the neighbouring ranges.
+		auto It = std::lower_bound(this->Free.begin(), this->Free.end(), aFirst, [](const range& aRange, uint aIndex) { return aRange.First < aIndex; });
+		It = this->Free.insert(It, { aFirst, aCount });
+		if ((It + 1 != this->Free.end()) && (It->First + It->Count == (It + 1)->First)) {
+			It->Count += (It + 1)->Count;
+			this->Free.erase(It + 1);
+		}
+		if ((It != this->Free.begin()) && ((It - 1)->First + (It - 1)->Count == It->First)) {
+			(It - 1)->Count += It->Count;
+			It = this->Free.erase(It) - 1;
+		}
+
+		// A range reaching the end of the table shrinks it instead.
+		if (It->First + It->Count == this->Data.size()) {
+			uint End = It->First;
+			this->Free.erase(It);
+			this->Data.resize(End);
+			for (size_t i = 0; i < this->FrameCount; i++) {
+				this->Dirty[i].resize(End);
+				std::vector<uint>& DirtyIndex = this->DirtyIndex[i];
+				DirtyIndex.erase(std::remove_if(DirtyIndex.begin(), DirtyIndex.end(), [&](uint aIndex) { return aIndex >= End; }), DirtyIndex.end());
+			}
+		}
+	}
+
+	void material_table::write(uint aIndex, const material::uniform_data& aData) {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		if (aIndex >= this->Data.size()) return;
+		// Field by field, the padding of the struct holds nothing meaningful.
+		if (this->Data[aIndex] == aData) return;
+		this->Data[aIndex] = aData;
+		this->mark(aIndex);
+	}
+
+	size_t material_table::update() {
+		GEODESY_GFX_TRACE_ZONE("material_table::update");
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		this->Serial += 1;
+		size_t Frame = this->Serial % this->FrameCount;
+		std::vector<uint>& DirtyIndex = this->DirtyIndex[Frame];
+		std::vector<bool>& Dirty = this->Dirty[Frame];
+		size_t Count = DirtyIndex.size();
+
+		// Replaced buffers are released once every frame that could read them has retired.
+		this->Retired.erase(std::remove_if(this->Retired.begin(), this->Retired.end(), [&](const retired& aRetired) {
+			return this->Serial - aRetired.Serial >= this->FrameCount;
+		}), this->Retired.end());
+
+		backend* Backend = backend::get(this->Context);
+		if (Backend == nullptr) {
+			// Host only table, the host copy is the table.
+			for (size_t i = 0; i < this->FrameCount; i++) {
+				std::fill(this->Dirty[i].begin(), this->Dirty[i].end(), false);
+				this->DirtyIndex[i].clear();
+			}
+			return Count;
+		}
+
+		if (this->Reallocate) {
+			// Frames in flight keep reading the old buffer, it is retired instead of released.
+			if (this->Buffer != nullptr) {
+				this->Retired.push_back({ this->Serial, this->Buffer });
+			}
+			this->CopySize = ((this->Capacity * sizeof(material::uniform_data) + CopyAlignment - 1) / CopyAlignment) * CopyAlignment;
+			buffer::create_info SBCI;
+			SBCI.Memory = device::memory::HOST_VISIBLE | device::memory::HOST_COHERENT;
+			SBCI.Usage = buffer::usage::STORAGE | buffer::usage::TRANSFER_SRC | buffer::usage::TRANSFER_DST;
+			this->Buffer = Backend->create_buffer(this->Context, SBCI, this->FrameCount * this->CopySize, nullptr, memory_ledger::MATERIAL_TABLE);
+			Backend->map(*this->Buffer, 0, this->FrameCount * this->CopySize);
+			this->Generation += 1;
+			this->Reallocate = false;
+			// Every copy of the new buffer starts empty, so each gets every entry.
+			for (size_t i = 0; i < this->FrameCount; i++) {
+				this->DirtyIndex[i].resize(this->Data.size());
+				for (size_t j = 0; j < this->Data.size(); j++) {
+					this->DirtyIndex[i][j] = (uint)j;
+				}
+				std::fill(this->Dirty[i].begin(), this->Dirty[i].end(), true);
+			}
+			Count = DirtyIndex.size();
+		}
+
+		this->Offset = Frame * this->CopySize;
+		material::uniform_data* Entry = (material::uniform_data*)((uchar*)this->Buffer->Ptr + this->Offset);
+		for (uint Index : DirtyIndex) {
+			std::memcpy(&Entry[Index], &this->Data[Index], sizeof(material::uniform_data));
+			Dirty[Index] = false;
+		}
+		DirtyIndex.clear();
+		return Count;
+	}
+
+	size_t material_table::size() const {
+		return this->Data.size();
+	}
+
+	size_t material_table::capacity() const {
+		return this->Capacity;
+	}
+
+	void material_table::mark(uint aIndex) {
+		for (size_t i = 0; i < this->FrameCount; i++) {
+			if (!this->Dirty[i][aIndex]) {
+				this->Dirty[i][aIndex] = true;
+				this->DirtyIndex[i].push_back(aIndex);
+			}
+		}
+	}
+
+}
@@ -0,0 +1,227 @@
+#include <geodesy/gfx/memory_ledger.h>
+
+#include <algorithm>
+#include <cstdio>
+
+namespace geodesy::gfx {
+
+	static const char* CategoryName[memory_ledger::CATEGORY_COUNT] = {
+		"vertex_buffer",
+		"index_buffer",
+		"vertex_weight",
+		"instance_uniform",
+		"material_uniform",
+		"material_table",
+		"texture",
+		"uniform_ring",
+		"crowd_instance",
+		"other"
+	};
+
+	// Owner path of the thread, each scope appends "/name" and trims it again.
+	static thread_local std::string OwnerPath;
+	static thread_local std::vector<size_t> OwnerLength;
+
+	memory_ledger::usage::usage() {
+		this->Bytes 	= 0;
+		this->Count 	= 0;
+		for (size_t& Bytes : this->Category) {
+			Bytes = 0;
+		}
+	}
+
+	memory_ledger::scope::scope(const std::string& aOwner) {
+		OwnerLength.push_back(OwnerPath.size());
+		if (!OwnerPath.empty()) OwnerPath += '/';
+		OwnerPath += aOwner.empty() ? std::string("(unnamed)") : escape(aOwner);
+	}
+
+	memory_ledger::scope::~scope() {
+		OwnerPath.resize(OwnerLength.back());
+		OwnerLength.pop_back();
+	}
+
+	memory_ledger::memory_ledger() {
+		this->TotalBudget 	= 0;
+		this->Total 		= 0;
+		this->Peak 			= 0;
+		this->Violations 	= 0;
+		for (int i = 0; i < CATEGORY_COUNT; i++) {
+			this->CategoryBudget[i] 	= 0;
+			this->Category[i] 			= 0;
+		}
+	}
+
+	std::string memory_ledger::allocate(category aCategory, size_t aBytes) {
+		std::string Path = OwnerPath;
+		std::vector<violation> Exceeded;
+		{
+			std::lock_guard<std::mutex> Lock(this->Mutex);
+			usage& Usage = this->Owner[Path];
+			Usage.Owner 				= Path;
+			Usage.Bytes 				+= aBytes;
+			Usage.Count 				+= 1;
+			Usage.Category[aCategory] 	+= aBytes;
+			this->Total 				+= aBytes;
+			this->Category[aCategory] 	+= aBytes;
+			this->Peak 					= std::max(this->Peak, this->Total);
+
+			// Only the allocation that crosses a budget reports it.
+			if ((this->TotalBudget > 0) && (this->Total > this->TotalBudget) && (this->Total - aBytes <= this->TotalBudget)) {
+				Exceeded.push_back({ Path, CATEGORY_COUNT, this->Total, this->TotalBudget });
+			}
+			size_t CategoryBudget = this->CategoryBudget[aCategory];
+			if ((CategoryBudget > 0) && (this->Category[aCategory] > CategoryBudget) && (this->Category[aCategory] - aBytes <= CategoryBudget)) {
+				Exceeded.push_back({ Path, aCategory, this->Category[aCategory], CategoryBudget });
+			}
+			std::string Top = top_owner(Path, 1);
+			auto Budget = this->OwnerBudget.find(Top);
+			if ((Budget != this->OwnerBudget.end()) && (Budget->second > 0)) {
+				size_t Bytes = this->subtree(Top).Bytes;
+				if ((Bytes > Budget->second) && (Bytes - aBytes <= Budget->second)) {
+					Exceeded.push_back({ Top, CATEGORY_COUNT, Bytes, Budget->second });
+				}
+			}
+			this->Violations += Exceeded.size();
+		}
+
+		// Outside the lock, the handler may query the ledger.
+		if (this->OnBudgetExceeded) {
+			for (const violation& Violation : Exceeded) {
+				this->OnBudgetExceeded(Violation);
+			}
+		}
+		return Path;
+	}
+
+	void memory_ledger::release(const std::string& aOwner, category aCategory, size_t aBytes) {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		auto It = this->Owner.find(aOwner);
+		if (It == this->Owner.end()) return;
+		usage& Usage = It->second;
+		Usage.Bytes 				-= aBytes;
+		Usage.Count 				-= 1;
+		Usage.Category[aCategory] 	-= aBytes;
+		this->Total 				-= aBytes;
+		this->Category[aCategory] 	-= aBytes;
+		if (Usage.Count == 0) {
+			this->Owner.erase(It);
+		}
+	}
+
+	size_t memory_ledger::total() const {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		return this->Total;
+	}
+
+	size_t memory_ledger::total(category aCategory) const {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		return this->Category[aCategory];
+	}
+
+	size_t memory_ledger::peak() const {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		return this->Peak;
+	}
+
+	size_t memory_ledger::violation_count() const {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		return this->Violations;
+	}
+
+	memory_ledger::usage memory_ledger::owner(const std::string& aOwner) const {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		return this->subtree(aOwner);
+	}
+
+	std::vector<memory_ledger::usage> memory_ledger::top(size_t aCount, size_t aDepth) const {
+		std::map<std::string, usage> Group;
+		{
+			std::lock_guard<std::mutex> Lock(this->Mutex);
+			for (const auto& Entry : this->Owner) {
+				std::string Key = aDepth > 0 ? top_owner(Entry.first, aDepth) : Entry.first;
+				usage& Usage = Group[Key];
+				Usage.Owner = Key;
+				Usage.Bytes += Entry.second.Bytes;
+				Usage.Count += Entry.second.Count;
+				for (int i = 0; i < CATEGORY_COUNT; i++) {
+					Usage.Category[i] += Entry.second.Category[i];
+				}
+			}
+		}
+		std::vector<usage> Result;
+		Result.reserve(Group.size());
+		for (auto& Entry : Group) {
+			Result.push_back(std::move(Entry.second));
+		}
+		std::sort(Result.begin(), Result.end(), [](const usage& aLeft, const usage& aRight) {
+			return aLeft.Bytes > aRight.Bytes;
+		});
+		Result.resize(std::min(aCount, Result.size()));
+		return Result;
+	}
+
+	std::string memory_ledger::report(size_t aCount, size_t aDepth) const {
+		std::string Output;
+		char Line[512];
+		std::snprintf(Line, sizeof(Line), "total %zu bytes, peak %zu bytes, %zu budget violations\n", this->total(), this->peak(), this->violation_count());
+		Output += Line;
+		for (int i = 0; i < CATEGORY_COUNT; i++) {
+			size_t Bytes = this->total((category)i);
+			if (Bytes == 0) continue;
+			std::snprintf(Line, sizeof(Line), "\t%-18s %14zu\n", CategoryName[i], Bytes);
+			Output += Line;
+		}
+		for (const usage& Usage : this->top(aCount, aDepth)) {
+			std::snprintf(Line, sizeof(Line), "\t%14zu bytes in %6zu resources  %s\n", Usage.Bytes, Usage.Count, Usage.Owner.empty() ? "(no owner)" : Usage.Owner.c_str());
+			Output += Line;
+		}
+		return Output;
+	}
+
+	const char* memory_ledger::category_name(category aCategory) {
+		return (aCategory >= 0) && (aCategory < CATEGORY_COUNT) ? CategoryName[aCategory] : "unknown";
+	}
+
+	std::string memory_ledger::current_owner() {
+		return OwnerPath;
+	}
+
+	std::string memory_ledger::escape(const std::string& aName) {
+		std::string Result;
+		Result.reserve(aName.size());
+		for (char c : aName) {
+			if (c == '%') Result += "%25";
+			else if (c == '/') Result += "%2F";
+			else Result += c;
+		}
+		return Result;
+	}
+
+	memory_ledger::usage memory_ledger::subtree(const std::string& aOwner) const {
+		usage Result;
+		Result.Owner = aOwner;
+		for (auto It = this->Owner.lower_bound(aOwner); It != this->Owner.end(); ++It) {
+			const std::string& Path = It->first;
+			if (Path.compare(0, aOwner.size(), aOwner) != 0) break;
+			if ((Path.size() > aOwner.size()) && (Path[aOwner.size()] != '/')) continue;
+			Result.Bytes += It->second.Bytes;
+			Result.Count += It->second.Count;
+			for (int i = 0; i < CATEGORY_COUNT; i++) {
+				Result.Category[i] += It->second.Category[i];
+			}
+		}
+		return Result;
+	}
+
+	std::string memory_ledger::top_owner(const std::string& aOwner, size_t aDepth) {
+		size_t End = 0;
+		for (size_t i = 0; i < aDepth; i++) {
+			End = aOwner.find('/', End);
+			if (End == std::string::npos) return aOwner;
+			if (i + 1 < aDepth) End += 1;
+		}
+		return aOwner.substr(0, End);
+	}
+
+}
@@ -1,17 +1,73 @@
 #include <geodesy/gfx/mesh.h>
+#include <geodesy/gfx/trace.h>
+
+#include <geodesy/gfx/backend.h>
 
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
 
 // Model Loading
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "parallel.h"
+
 namespace geodesy::gfx {
 
 	using namespace gpu;
 
+	namespace {
+
+		// Vertices are only split across threads in chunks of this size.
+		static const size_t VertexGrain = 1 << 16;
+
+		static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "mesh conversion expects single precision assimp vectors");
+		static_assert(sizeof(aiColor4D) == 4 * sizeof(float), "mesh conversion expects single precision assimp colors");
+
+		// Copies [aBegin, aEnd) of a packed assimp stream into one field of each vertex. The
+		// component count is a constant, so the inner loop unrolls into plain strided moves.
+		template <typename source, size_t N>
+		void copy_stream(const source* aSource, math::vec<float, N> mesh::vertex::* aField, std::vector<mesh::vertex>& aVertex, size_t aBegin, size_t aEnd) {
+			const float* Source = reinterpret_cast<const float*>(aSource) + aBegin * N;
+			mesh::vertex* Vertex = aVertex.data();
+			for (size_t i = aBegin; i < aEnd; i++, Source += N) {
+				math::vec<float, N>& Field = Vertex[i].*aField;
+				for (size_t k = 0; k < N; k++) {
+					Field[k] = Source[k];
+				}
+			}
+		}
+
+		// Writes the indices of every triangle face of aMesh to aIndex. When every face is a
+		// triangle, each face has a fixed output slot and the faces are split across threads.
+		template <typename index>
+		void copy_faces(const aiMesh* aMesh, size_t aTriangleCount, index* aIndex, size_t aThreadCount) {
+			if (aTriangleCount == aMesh->mNumFaces) {
+				parallel::for_range(aTriangleCount, aThreadCount, VertexGrain, [&](size_t aBegin, size_t aEnd, size_t) {
+					for (size_t i = aBegin; i < aEnd; i++) {
+						const unsigned int* Face = aMesh->mFaces[i].mIndices;
+						aIndex[3 * i + 0] = (index)Face[0];
+						aIndex[3 * i + 1] = (index)Face[1];
+						aIndex[3 * i + 2] = (index)Face[2];
+					}
+				});
+				return;
+			}
+			for (size_t i = 0; i < aMesh->mNumFaces; i++) {
+				if (aMesh->mFaces[i].mNumIndices != 3) continue;
+				const unsigned int* Face = aMesh->mFaces[i].mIndices;
+				*aIndex++ = (index)Face[0];
+				*aIndex++ = (index)Face[1];
+				*aIndex++ = (index)Face[2];
+			}
+		}
+
+	}
+
 	mesh::instance::uniform_data::uniform_data() {
 		Transform = {
 			1.0f, 0.0f, 0.0f, 0.0f,
@@ -36,24 +92,34 @@ namespace geodesy::gfx {
 	}
 
 	mesh::instance::uniform_data::uniform_data(const mesh::instance* aInstance) : uniform_data() {
-		for (size_t i = 0; i < aInstance->Bone.size(); i++) {
-			this->BoneOffset[i] = aInstance->Bone[i].Offset;
+		const std::vector<bone>& Bone = *aInstance->Bone;
+		for (size_t i = 0; i < Bone.size(); i++) {
+			this->BoneOffset[i] = Bone[i].Offset;
 		}
 	}
 
 	mesh::instance::instance() {
+		// Instances without bones share one empty set.
+		static const std::shared_ptr<const std::vector<vertex::weight>> NoVertex = std::make_shared<const std::vector<vertex::weight>>();
+		static const std::shared_ptr<const std::vector<bone>> NoBone = std::make_shared<const std::vector<bone>>();
+		this->Vertex 			= NoVertex;
+		this->Bone 				= NoBone;
 		this->Root 				= nullptr;
 		this->Parent 			= nullptr;
 		this->MeshIndex 		= -1;
 		this->MaterialIndex 	= UINT32_MAX; // TODO: maybe make this int later?
 		this->Context 			= nullptr;
+		this->DynamicOffset 	= 0;
+		this->DynamicSerial 	= SIZE_MAX;
+		this->Revision 			= 0;
 	}
 
-	mesh::instance::instance(uint aVertexCount, const std::vector<bone>& aBoneData, int aMeshIndex, uint aMaterialIndex, phys::node* aRoot, phys::node* aParent) : instance() {
+	mesh::instance::instance(uint aVertexCount, std::vector<bone> aBoneData, int aMeshIndex, uint aMaterialIndex, phys::node* aRoot, phys::node* aParent) : instance() {
+		GEODESY_GFX_TRACE_ZONE("mesh::instance::bone_weights");
 		this->Root 			= aRoot;
 		this->Parent 		= aParent;
-		this->Vertex 		= std::vector<vertex::weight>(aVertexCount);
-		this->Bone 			= aBoneData;
+		std::vector<vertex::weight> Vertex(aVertexCount);
+		const std::vector<bone>& Bone = aBoneData;
 		// Generate the corresponding vertex buffer which will supply the mesh
 		// instance the needed bone animation data.
 		for (size_t i = 0; i < Vertex.size(); i++) {
@@ -102,22 +168,33 @@ namespace geodesy::gfx {
 			}
 			Vertex[i].BoneWeight /= TotalVertexWeight;
 		}
+		this->Vertex 			= std::make_shared<const std::vector<vertex::weight>>(std::move(Vertex));
+		this->Bone 				= std::make_shared<const std::vector<bone>>(std::move(aBoneData));
 		this->MeshIndex 		= aMeshIndex;
 		this->MaterialIndex 	= aMaterialIndex;
 	}
 
 	mesh::instance::instance(std::shared_ptr<gpu::context> aContext, const instance& aInstance, phys::node* aRoot, phys::node* aParent) : instance() {
+		GEODESY_GFX_TRACE_ZONE("mesh::instance::upload");
+		memory_ledger::scope Owner("instance");
 		this->Root 			= aRoot;
 		this->Parent 		= aParent;
+		// Weights and bones are immutable, the device instance shares them with the host instance.
 		this->Vertex 		= aInstance.Vertex;
 		this->Bone 			= aInstance.Bone;
 		this->Context 		= aContext;
+		this->MeshIndex 	= aInstance.MeshIndex;
+		this->MaterialIndex = aInstance.MaterialIndex;
+
+		// Without a backend the instance stays host only.
+		backend* Backend 	= backend::get(aContext);
+		if (Backend == nullptr) return;
 		
 		// Create Vertex Weight Buffer
 		buffer::create_info VBCI;
 		VBCI.Memory = device::memory::DEVICE_LOCAL;
 		VBCI.Usage = buffer::usage::VERTEX | buffer::usage::TRANSFER_SRC | buffer::usage::TRANSFER_DST;
-		this->VertexWeightBuffer = Context->create<buffer>(VBCI, Vertex.size() * sizeof(vertex::weight), Vertex.data());
+		this->VertexWeightBuffer = Backend->create_buffer(aContext, VBCI, this->Vertex->size() * sizeof(vertex::weight), this->Vertex->data(), memory_ledger::VERTEX_WEIGHT);
 		
 		// Create Mesh Instance Uniform Buffer
 		buffer::create_info UBCI;
@@ -127,18 +204,29 @@ namespace geodesy::gfx {
 		// Use Host node hierarchy to generate the bone transforms. Device Hierarchy not complete yet.
 		uniform_data MeshInstanceUBOData = uniform_data(this);
 		MeshInstanceUBOData.Transform = aInstance.Parent->transform();
-		for (size_t i = 0; i < this->Bone.size(); i++) {
-			phys::node* Bone = aInstance.Root->find(this->Bone[i].Name);
+		for (size_t i = 0; i < this->Bone->size(); i++) {
+			phys::node* Bone = aInstance.Root->find((*this->Bone)[i].Name);
 			if (Bone != nullptr) {
 				MeshInstanceUBOData.BoneTransform[i] = Bone->transform();
 			}
 		}
-		this->UniformBuffer = Context->create<buffer>(UBCI, sizeof(uniform_data), &MeshInstanceUBOData);
-		this->UniformBuffer->map_memory(0, sizeof(uniform_data));
+		this->UniformBuffer = Backend->create_buffer(aContext, UBCI, sizeof(uniform_data), &MeshInstanceUBOData, memory_ledger::INSTANCE_UNIFORM);
+		Backend->map(*this->UniformBuffer, 0, sizeof(uniform_data));
+	}
 
-		// Set reference indices.
-		this->MeshIndex 	= aInstance.MeshIndex;
-		this->MaterialIndex = aInstance.MaterialIndex;
+	mesh::cleanup_settings::cleanup_settings() {
+		this->PositionTolerance 	= 1e-5f;
+		this->AttributeTolerance 	= 1e-3f;
+		this->AreaTolerance 		= 0.0f;
+	}
+
+	mesh::cleanup_statistics::cleanup_statistics() {
+		this->SourceVertexCount 	= 0;
+		this->VertexCount 			= 0;
+		this->SourceIndexCount 		= 0;
+		this->IndexCount 			= 0;
+		this->DegenerateCount 		= 0;
+		this->Narrowed 				= false;
 	}
 
 	mesh::mesh() : phys::mesh() {
@@ -148,101 +236,49 @@ namespace geodesy::gfx {
 		this->AccelerationStructure = nullptr;
 	}
 
-	mesh::mesh(const aiMesh* aMesh) {
-		// Size Vertex Buffer to hold all vertices.
+	mesh::mesh(const aiMesh* aMesh, size_t aThreadCount) {
+		GEODESY_GFX_TRACE_ZONE("mesh::convert");
+		// Size Vertex Buffer to hold all vertices, attributes the mesh lacks keep their defaults.
 		Vertex = std::vector<vertex>(aMesh->mNumVertices);
-		// Load Vertex Data
-		for (size_t i = 0; i < Vertex.size(); i++) {
-			// Check if mesh has positions.
-			if (aMesh->HasPositions()) {
-				Vertex[i].Position = {
-					aMesh->mVertices[i].x,
-					aMesh->mVertices[i].y,
-					aMesh->mVertices[i].z
-				};
-			}
-			// Check if mesh has normals.
-			if (aMesh->HasNormals()) {
-				Vertex[i].Normal = {
-					aMesh->mNormals[i].x,
-					aMesh->mNormals[i].y,
-					aMesh->mNormals[i].z
-				};
-			}
-			// Check if mesh has tangents and bitangents.
-			if (aMesh->HasTangentsAndBitangents()) {
-				Vertex[i].Tangent = {
-					aMesh->mTangents[i].x,
-					aMesh->mTangents[i].y,
-					aMesh->mTangents[i].z
-				};
-				Vertex[i].Bitangent = {
-					aMesh->mBitangents[i].x,
-					aMesh->mBitangents[i].y,
-					aMesh->mBitangents[i].z
-				};
+		// Attribute presence is fixed per mesh, so each stream is copied whole in its own pass.
+		// Only the first texture coordinate and color set are used.
+		const bool Positions 			= aMesh->HasPositions();
+		const bool Normals 				= aMesh->HasNormals();
+		const bool Tangents 			= aMesh->HasTangentsAndBitangents();
+		const bool TextureCoordinates 	= aMesh->HasTextureCoords(0);
+		const bool Colors 				= aMesh->HasVertexColors(0);
+		parallel::for_range(Vertex.size(), aThreadCount, VertexGrain, [&](size_t aBegin, size_t aEnd, size_t) {
+			if (Positions) 				copy_stream(aMesh->mVertices, &vertex::Position, Vertex, aBegin, aEnd);
+			if (Normals) 				copy_stream(aMesh->mNormals, &vertex::Normal, Vertex, aBegin, aEnd);
+			if (Tangents) {
+				copy_stream(aMesh->mTangents, &vertex::Tangent, Vertex, aBegin, aEnd);
+				copy_stream(aMesh->mBitangents, &vertex::Bitangent, Vertex, aBegin, aEnd);
 			}
+			if (TextureCoordinates) 	copy_stream(aMesh->mTextureCoords[0], &vertex::TextureCoordinate, Vertex, aBegin, aEnd);
+			if (Colors) 				copy_stream(aMesh->mColors[0], &vertex::Color, Vertex, aBegin, aEnd);
+		});
 
-			// ^Save for later, not useful now. Just commit it.
-			// // Filter normal components and insure that tangent is perpendicular to normal.
-			// Vertex[i].Tangent -= (Vertex[i].Normal * Vertex[i].Tangent) * Vertex[i].Normal;
-			// Vertex[i].Tangent = math::normalize(Vertex[i].Tangent);
-			// // Generate bitangent from tangent and normal.
-			// Vertex[i].Bitangent = Vertex[i].Normal ^ Vertex[i].Tangent;
-
-			// -------------------- Texturing & Coloring -------------------- //
-
-			// TODO: Support multiple textures
-			// Take only the first element of the Texture Coordinate Array.
-			for (int k = 0; k < 1 /* AI_MAX_NUMBER_OF_TEXTURECOORDS */; k++) {
-				if (aMesh->HasTextureCoords(k)) {
-					Vertex[i].TextureCoordinate = {
-						aMesh->mTextureCoords[k][i].x,
-						aMesh->mTextureCoords[k][i].y,
-						aMesh->mTextureCoords[k][i].z
-					};
-				}
-			}
-			// Take an average of all the Colors associated with Vertex.
-			for (int k = 0; k < 1 /*AI_MAX_NUMBER_OF_COLOR_SETS*/; k++) {
-				if (aMesh->HasVertexColors(k)) {
-					Vertex[i].Color += {
-						aMesh->mColors[k][i].r,
-						aMesh->mColors[k][i].g,
-						aMesh->mColors[k][i].b,
-						aMesh->mColors[k][i].a
-					};
-				}
-			}
-			// VertexData[j].Color /= AI_MAX_NUMBER_OF_COLOR_SETS;
-		}
+		// ^Save for later, not useful now. Just commit it.
+		// // Filter normal components and insure that tangent is perpendicular to normal.
+		// Vertex[i].Tangent -= (Vertex[i].Normal * Vertex[i].Tangent) * Vertex[i].Normal;
+		// Vertex[i].Tangent = math::normalize(Vertex[i].Tangent);
+		// // Generate bitangent from tangent and normal.
+		// Vertex[i].Bitangent = Vertex[i].Normal ^ Vertex[i].Tangent;
 
-		// Load Index Data
+		// Load Index Data, faces that are not triangles (points, lines) are left out.
+		size_t TriangleCount = 0;
+		for (size_t i = 0; i < aMesh->mNumFaces; i++) {
+			TriangleCount += aMesh->mFaces[i].mNumIndices == 3 ? 1 : 0;
+		}
 		if (aMesh->mNumVertices <= (1 << 16)) {
 			// Implies that the mesh has less than 2^16 vertices, only 16 bit indices are needed.
-			Topology.Data16 = std::vector<ushort>(aMesh->mNumFaces * 3);
-			for (size_t i = 0; i < aMesh->mNumFaces; i++) {
-				// Skip non triangle indices.
-				if (aMesh->mFaces[i].mNumIndices != 3) {
-					continue;
-				}
-				Topology.Data16[3*i + 0] = (ushort)aMesh->mFaces[i].mIndices[0];
-				Topology.Data16[3*i + 1] = (ushort)aMesh->mFaces[i].mIndices[1];
-				Topology.Data16[3*i + 2] = (ushort)aMesh->mFaces[i].mIndices[2];
-			} 
+			Topology.Data16.resize(TriangleCount * 3);
+			copy_faces(aMesh, TriangleCount, Topology.Data16.data(), aThreadCount);
 		}
 		else {
 			// Implies that the mesh has more than 2^16 vertices, 32 bit indices are needed.
-			Topology.Data32 = std::vector<uint>(aMesh->mNumFaces * 3);
-			for (size_t i = 0; i < aMesh->mNumFaces; i++) {
-				// Skip non triangle indices.
-				if (aMesh->mFaces[i].mNumIndices != 3) {
-					continue;
-				}
-				Topology.Data32[3*i + 0] = (uint)aMesh->mFaces[i].mIndices[0];
-				Topology.Data32[3*i + 1] = (uint)aMesh->mFaces[i].mIndices[1];
-				Topology.Data32[3*i + 2] = (uint)aMesh->mFaces[i].mIndices[2];
-			}
+			Topology.Data32.resize(TriangleCount * 3);
+			copy_faces(aMesh, TriangleCount, Topology.Data32.data(), aThreadCount);
 		}
 
 		// Calculate properties of the mesh.
@@ -251,13 +287,16 @@ namespace geodesy::gfx {
 	}
 	
 	mesh::mesh(std::shared_ptr<gpu::context> aContext, std::shared_ptr<mesh> aMesh) {
+		GEODESY_GFX_TRACE_ZONE("mesh::upload");
 		this->HostMesh = aMesh;
 		this->Name = aMesh->Name;
 		this->Mass = aMesh->Mass;
 		this->CenterOfMass = aMesh->CenterOfMass;
 		this->BoundingRadius = aMesh->BoundingRadius;
 		this->Context = aContext;
-		if ((aContext != nullptr) && (aMesh != nullptr)) {
+		backend* Backend = backend::get(aContext);
+		if ((Backend != nullptr) && (aMesh != nullptr)) {
+			memory_ledger::scope Owner("mesh:" + aMesh->Name);
 			// Vertex Buffer Creation Info
 			gpu::buffer::create_info VBCI;
 			VBCI.Memory = device::memory::DEVICE_LOCAL;
@@ -274,13 +313,13 @@ namespace geodesy::gfx {
 			// // }
 			IBCI.ElementCount = aMesh->Topology.Data16.size() > 0 ? aMesh->Topology.Data16.size() : aMesh->Topology.Data32.size();
 			// Create Vertex Buffer
-			this->VertexBuffer = aContext->create<buffer>(VBCI, aMesh->Vertex.size() * sizeof(vertex), aMesh->Vertex.data());
-			// Create Index Buffer
-			if (this->Vertex.size() <= (1 << 16)) {
-				this->IndexBuffer = aContext->create<buffer>(IBCI, aMesh->Topology.Data16.size() * sizeof(ushort), aMesh->Topology.Data16.data());
+			this->VertexBuffer = Backend->create_buffer(aContext, VBCI, aMesh->Vertex.size() * sizeof(vertex), aMesh->Vertex.data(), memory_ledger::VERTEX_BUFFER);
+			// Create Index Buffer, with whichever index width the host mesh was built with.
+			if (aMesh->Topology.Data32.empty()) {
+				this->IndexBuffer = Backend->create_buffer(aContext, IBCI, aMesh->Topology.Data16.size() * sizeof(ushort), aMesh->Topology.Data16.data(), memory_ledger::INDEX_BUFFER);
 			}
 			else {
-				this->IndexBuffer = aContext->create<buffer>(IBCI, aMesh->Topology.Data32.size() * sizeof(uint), aMesh->Topology.Data32.data());
+				this->IndexBuffer = Backend->create_buffer(aContext, IBCI, aMesh->Topology.Data32.size() * sizeof(uint), aMesh->Topology.Data32.data(), memory_ledger::INDEX_BUFFER);
 			}
 			// Create Acceleration Structure if context supports it.
 			// // if (aContext->extension_enabled("VK_KHR_acceleration_structure")) {
@@ -289,4 +328,147 @@ namespace geodesy::gfx {
 		}
 	}
 
+	template <size_t N>
+	static bool within(const math::vec<float, N>& aA, const math::vec<float, N>& aB, float aTolerance) {
+		for (size_t i = 0; i < N; i++) {
+			if (!(std::fabs(aA[i] - aB[i]) <= aTolerance)) return false;
+		}
+		return true;
+	}
+
+	// Grid cell of a position component, the raw bits when welding exact positions only.
+	static int64_t cell(float aValue, float aTolerance) {
+		if (aTolerance > 0.0f) return (int64_t)std::floor(aValue / aTolerance);
+		int32_t Bits;
+		std::memcpy(&Bits, &aValue, sizeof(Bits));
+		return Bits;
+	}
+
+	static uint64_t cell_key(int64_t aX, int64_t aY, int64_t aZ) {
+		uint64_t Key = 1469598103934665603ull;
+		Key = (Key ^ (uint64_t)aX) * 1099511628211ull;
+		Key = (Key ^ (uint64_t)aY) * 1099511628211ull;
+		Key = (Key ^ (uint64_t)aZ) * 1099511628211ull;
+		return Key;
+	}
+
+	mesh::cleanup_statistics mesh::cleanup(cleanup_settings aSettings, const std::vector<const std::vector<vertex::weight>*>& aWeight, std::vector<uint>* aRemap) {
+		GEODESY_GFX_TRACE_ZONE("mesh::cleanup");
+		cleanup_statistics Statistics;
+		const bool Wide = !this->Topology.Data32.empty();
+		Statistics.SourceVertexCount 	= this->Vertex.size();
+		Statistics.SourceIndexCount 	= Wide ? this->Topology.Data32.size() : this->Topology.Data16.size();
+		Statistics.VertexCount 			= Statistics.SourceVertexCount;
+		Statistics.IndexCount 			= Statistics.SourceIndexCount;
+		if (aRemap != nullptr) {
+			aRemap->resize(this->Vertex.size());
+			for (size_t i = 0; i < aRemap->size(); i++) (*aRemap)[i] = (uint)i;
+		}
+		// Meshes without indices draw every vertex, there is nothing to compact.
+		if (Statistics.SourceIndexCount == 0) return Statistics;
+
+		// Weld, every vertex maps to the first earlier vertex it matches. Candidates come from the
+		// neighbouring grid cells, so vertices within tolerance across a cell border still meet.
+		std::vector<uint> Weld(this->Vertex.size());
+		std::unordered_map<uint64_t, std::vector<uint>> Grid;
+		Grid.reserve(this->Vertex.size());
+		const int64_t Reach = aSettings.PositionTolerance > 0.0f ? 1 : 0;
+		for (size_t i = 0; i < this->Vertex.size(); i++) {
+			const vertex& V = this->Vertex[i];
+			int64_t X = cell(V.Position[0], aSettings.PositionTolerance);
+			int64_t Y = cell(V.Position[1], aSettings.PositionTolerance);
+			int64_t Z = cell(V.Position[2], aSettings.PositionTolerance);
+			Weld[i] = (uint)i;
+			for (int64_t dx = -Reach; (dx <= Reach) && (Weld[i] == i); dx++) {
+				for (int64_t dy = -Reach; (dy <= Reach) && (Weld[i] == i); dy++) {
+					for (int64_t dz = -Reach; (dz <= Reach) && (Weld[i] == i); dz++) {
+						auto It = Grid.find(cell_key(X + dx, Y + dy, Z + dz));
+						if (It == Grid.end()) continue;
+						for (uint j : It->second) {
+							const vertex& W = this->Vertex[j];
+							if (!within(V.Position, W.Position, aSettings.PositionTolerance)) continue;
+							if (!within(V.Normal, W.Normal, aSettings.AttributeTolerance)) continue;
+							if (!within(V.Tangent, W.Tangent, aSettings.AttributeTolerance)) continue;
+							if (!within(V.Bitangent, W.Bitangent, aSettings.AttributeTolerance)) continue;
+							if (!within(V.TextureCoordinate, W.TextureCoordinate, aSettings.AttributeTolerance)) continue;
+							if (!within(V.Color, W.Color, aSettings.AttributeTolerance)) continue;
+							bool SameWeight = true;
+							for (const std::vector<vertex::weight>* Weight : aWeight) {
+								if ((Weight == nullptr) || (Weight->size() != this->Vertex.size())) continue;
+								for (size_t k = 0; (k < 4) && SameWeight; k++) {
+									SameWeight = ((*Weight)[i].BoneID[k] == (*Weight)[j].BoneID[k]) && ((*Weight)[i].BoneWeight[k] == (*Weight)[j].BoneWeight[k]);
+								}
+								if (!SameWeight) break;
+							}
+							if (!SameWeight) continue;
+							Weld[i] = j;
+							break;
+						}
+					}
+				}
+			}
+			if (Weld[i] == i) {
+				Grid[cell_key(X, Y, Z)].push_back((uint)i);
+			}
+		}
+
+		// Rewrite the triangles through the weld, dropping the ones that collapsed, and number
+		// the surviving vertices in order of first use for better vertex cache locality.
+		std::vector<uint> Remap(this->Vertex.size(), UINT32_MAX);
+		std::vector<vertex> Vertex;
+		std::vector<uint> Index;
+		Index.reserve(Statistics.SourceIndexCount);
+		for (size_t i = 0; i + 2 < Statistics.SourceIndexCount; i += 3) {
+			uint Triangle[3];
+			for (size_t k = 0; k < 3; k++) {
+				uint Source = Wide ? this->Topology.Data32[i + k] : (uint)this->Topology.Data16[i + k];
+				Triangle[k] = Source < Weld.size() ? Weld[Source] : UINT32_MAX;
+			}
+			if ((Triangle[0] == UINT32_MAX) || (Triangle[1] == UINT32_MAX) || (Triangle[2] == UINT32_MAX) ||
+				(Triangle[0] == Triangle[1]) || (Triangle[1] == Triangle[2]) || (Triangle[0] == Triangle[2])) {
+				Statistics.DegenerateCount += 1;
+				continue;
+			}
+			const math::vec<float, 3>& A = this->Vertex[Triangle[0]].Position;
+			const math::vec<float, 3>& B = this->Vertex[Triangle[1]].Position;
+			const math::vec<float, 3>& C = this->Vertex[Triangle[2]].Position;
+			float E1[3] = { B[0] - A[0], B[1] - A[1], B[2] - A[2] };
+			float E2[3] = { C[0] - A[0], C[1] - A[1], C[2] - A[2] };
+			float N[3] = { E1[1] * E2[2] - E1[2] * E2[1], E1[2] * E2[0] - E1[0] * E2[2], E1[0] * E2[1] - E1[1] * E2[0] };
+			float Area = 0.5f * std::sqrt(N[0] * N[0] + N[1] * N[1] + N[2] * N[2]);
+			if (Area <= aSettings.AreaTolerance) {
+				Statistics.DegenerateCount += 1;
+				continue;
+			}
+			for (size_t k = 0; k < 3; k++) {
+				if (Remap[Triangle[k]] == UINT32_MAX) {
+					Remap[Triangle[k]] = (uint)Vertex.size();
+					Vertex.push_back(this->Vertex[Triangle[k]]);
+				}
+				Index.push_back(Remap[Triangle[k]]);
+			}
+		}
+		if (aRemap != nullptr) {
+			for (size_t i = 0; i < Weld.size(); i++) {
+				(*aRemap)[i] = Remap[Weld[i]];
+			}
+		}
+
+		this->Vertex = std::move(Vertex);
+		this->Topology.Data16.clear();
+		this->Topology.Data32.clear();
+		if (this->Vertex.size() <= (1 << 16)) {
+			this->Topology.Data16 = std::vector<ushort>(Index.begin(), Index.end());
+			Statistics.Narrowed = Wide;
+		}
+		else {
+			this->Topology.Data32 = std::move(Index);
+		}
+		Statistics.VertexCount 	= this->Vertex.size();
+		Statistics.IndexCount 	= this->Topology.Data16.size() + this->Topology.Data32.size();
+		this->CenterOfMass 		= this->calculate_center_of_mass();
+		this->BoundingRadius 	= this->calculate_bounding_radius();
+		return Statistics;
+	}
+
 }
@@ -0,0 +1,339 @@
+#include <geodesy/gfx/mipmap.h>
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define GEODESY_GFX_MIPMAP_SSE
+#endif
+
+#include "parallel.h"
+
+namespace geodesy::gfx {
+
+	namespace {
+
+		// Rows are only split across threads in chunks of this size.
+		static const size_t RowGrain = 16;
+		static const size_t EncodeTableSize = 16384;
+
+		// Level being filtered, in linear space.
+		struct float_image {
+			uint Width;
+			uint Height;
+			std::vector<float> Data;
+		};
+
+		struct srgb_table {
+			float Decode[256];
+			uchar Encode[EncodeTableSize];
+			srgb_table() {
+				for (int i = 0; i < 256; i++) {
+					float c = (float)i / 255.0f;
+					Decode[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+				}
+				for (size_t i = 0; i < EncodeTableSize; i++) {
+					float l = (float)i / (float)(EncodeTableSize - 1);
+					float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+					Encode[i] = (uchar)std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f);
+				}
+			}
+		};
+
+		const srgb_table& srgb() {
+			static const srgb_table Table;
+			return Table;
+		}
+
+		uchar to_unorm(float aValue) {
+			return (uchar)std::lround(std::clamp(aValue, 0.0f, 1.0f) * 255.0f);
+		}
+
+		float bessel_i0(float aX) {
+			// Power series of the modified Bessel function of the first kind, order zero.
+			float Sum = 1.0f, Term = 1.0f, HalfX = 0.5f * aX;
+			for (int k = 1; k < 32; k++) {
+				Term *= (HalfX / (float)k) * (HalfX / (float)k);
+				Sum += Term;
+				if (Term < 1.0e-7f * Sum) break;
+			}
+			return Sum;
+		}
+
+		float kaiser(float aT, float aRadius, float aAlpha) {
+			float x = aT / aRadius;
+			if (std::fabs(x) >= 1.0f) return 0.0f;
+			float Sinc = aT == 0.0f ? 1.0f : std::sin(3.14159265f * aT) / (3.14159265f * aT);
+			return Sinc * bessel_i0(aAlpha * std::sqrt(1.0f - x * x)) / bessel_i0(aAlpha);
+		}
+
+		// Source texels and weights contributing to one destination texel along one axis.
+		struct tap_set {
+			std::vector<int> Index;
+			std::vector<float> Weight;
+		};
+
+		std::vector<tap_set> kaiser_taps(uint aSourceSize, uint aDestinationSize, float aRadius, float aAlpha) {
+			std::vector<tap_set> Taps(aDestinationSize);
+			float Scale = (float)aSourceSize / (float)aDestinationSize;
+			for (uint i = 0; i < aDestinationSize; i++) {
+				float Center = ((float)i + 0.5f) * Scale;
+				int First = (int)std::floor(Center - aRadius * Scale);
+				int Last = (int)std::ceil(Center + aRadius * Scale);
+				float Total = 0.0f;
+				for (int s = First; s <= Last; s++) {
+					// Distance in destination texels.
+					float Weight = kaiser((((float)s + 0.5f) - Center) / Scale, aRadius, aAlpha);
+					if (Weight == 0.0f) continue;
+					Taps[i].Index.push_back(std::clamp(s, 0, (int)aSourceSize - 1));
+					Taps[i].Weight.push_back(Weight);
+					Total += Weight;
+				}
+				for (float& W : Taps[i].Weight) W /= Total;
+			}
+			return Taps;
+		}
+
+		float_image box_downsample(const float_image& aSource, uint aChannelCount, size_t aThreadCount) {
+			float_image Result;
+			Result.Width = std::max(1u, aSource.Width / 2);
+			Result.Height = std::max(1u, aSource.Height / 2);
+			Result.Data.resize((size_t)Result.Width * Result.Height * aChannelCount);
+			const size_t C = aChannelCount;
+			parallel::for_range(Result.Height, aThreadCount, RowGrain, [&](size_t aBegin, size_t aEnd, size_t) {
+				for (size_t y = aBegin; y < aEnd; y++) {
+					const float* Row0 = &aSource.Data[std::min(2 * y, (size_t)aSource.Height - 1) * aSource.Width * C];
+					const float* Row1 = &aSource.Data[std::min(2 * y + 1, (size_t)aSource.Height - 1) * aSource.Width * C];
+					float* Out = &Result.Data[y * Result.Width * C];
+					for (size_t x = 0; x < Result.Width; x++) {
+						size_t x0 = std::min(2 * x, (size_t)aSource.Width - 1) * C;
+						size_t x1 = std::min(2 * x + 1, (size_t)aSource.Width - 1) * C;
+#ifdef GEODESY_GFX_MIPMAP_SSE
+						if (C == 4) {
+							// One RGBA texel per register.
+							__m128 Sum = _mm_add_ps(
+								_mm_add_ps(_mm_loadu_ps(Row0 + x0), _mm_loadu_ps(Row0 + x1)),
+								_mm_add_ps(_mm_loadu_ps(Row1 + x0), _mm_loadu_ps(Row1 + x1))
+							);
+							_mm_storeu_ps(Out + 4 * x, _mm_mul_ps(Sum, _mm_set1_ps(0.25f)));
+							continue;
+						}
+#endif
+						for (size_t c = 0; c < C; c++) {
+							Out[x * C + c] = 0.25f * (Row0[x0 + c] + Row0[x1 + c] + Row1[x0 + c] + Row1[x1 + c]);
+						}
+					}
+				}
+			});
+			return Result;
+		}
+
+		float_image kaiser_downsample(const float_image& aSource, uint aChannelCount, float aRadius, float aAlpha, size_t aThreadCount) {
+			const size_t C = aChannelCount;
+			uint Width = std::max(1u, aSource.Width / 2);
+			uint Height = std::max(1u, aSource.Height / 2);
+
+			// Horizontal pass.
+			float_image Horizontal;
+			Horizontal.Width = Width;
+			Horizontal.Height = aSource.Height;
+			Horizontal.Data.resize((size_t)Width * aSource.Height * C);
+			std::vector<tap_set> TapX = kaiser_taps(aSource.Width, Width, aRadius, aAlpha);
+			parallel::for_range(aSource.Height, aThreadCount, RowGrain, [&](size_t aBegin, size_t aEnd, size_t) {
+				for (size_t y = aBegin; y < aEnd; y++) {
+					const float* In = &aSource.Data[y * aSource.Width * C];
+					float* Out = &Horizontal.Data[y * Width * C];
+					for (size_t x = 0; x < Width; x++) {
+						for (size_t c = 0; c < C; c++) Out[x * C + c] = 0.0f;
+						for (size_t t = 0; t < TapX[x].Index.size(); t++) {
+							const float* Texel = In + TapX[x].Index[t] * C;
+							float W = TapX[x].Weight[t];
+							for (size_t c = 0; c < C; c++) Out[x * C + c] += W * Texel[c];
+						}
+					}
+				}
+			});
+
+			// Vertical pass, rows are accumulated whole so the inner loop vectorizes.
+			float_image Result;
+			Result.Width = Width;
+			Result.Height = Height;
+			Result.Data.resize((size_t)Width * Height * C);
+			std::vector<tap_set> TapY = kaiser_taps(aSource.Height, Height, aRadius, aAlpha);
+			parallel::for_range(Height, aThreadCount, RowGrain, [&](size_t aBegin, size_t aEnd, size_t) {
+				const size_t RowLength = Width * C;
+				for (size_t y = aBegin; y < aEnd; y++) {
+					float* Out = &Result.Data[y * RowLength];
+					std::fill(Out, Out + RowLength, 0.0f);
+					for (size_t t = 0; t < TapY[y].Index.size(); t++) {
+						const float* In = &Horizontal.Data[TapY[y].Index[t] * RowLength];
+						float W = TapY[y].Weight[t];
+						for (size_t i = 0; i < RowLength; i++) Out[i] += W * In[i];
+					}
+				}
+			});
+			return Result;
+		}
+
+		float coverage(const float_image& aImage, float aScale, float aCutoff) {
+			size_t Count = 0, Total = (size_t)aImage.Width * aImage.Height;
+			for (size_t i = 0; i < Total; i++) {
+				if (aImage.Data[4 * i + 3] * aScale > aCutoff) Count++;
+			}
+			return Total > 0 ? (float)Count / (float)Total : 0.0f;
+		}
+
+		// Finds the alpha scale which brings the alpha test coverage of a level back to aTarget.
+		float coverage_scale(const float_image& aImage, float aTarget, float aCutoff) {
+			float Low = 0.0f, High = 4.0f, Scale = 1.0f;
+			for (int i = 0; i < 16; i++) {
+				Scale = 0.5f * (Low + High);
+				float Coverage = coverage(aImage, Scale, aCutoff);
+				if (Coverage < aTarget) Low = Scale; else High = Scale;
+			}
+			return Scale;
+		}
+
+	}
+
+	mipmap::settings::settings() {
+		this->Filter 		= mipmap::filter::BOX;
+		this->SRGB 			= true;
+		this->NormalMap 	= false;
+		this->AlphaCutoff 	= 0.0f;
+		this->KaiserAlpha 	= 4.0f;
+		this->KaiserWidth 	= 3.0f;
+		this->ThreadCount 	= 0;
+	}
+
+	mipmap::mipmap() {
+		this->ChannelCount = 0;
+	}
+
+	mipmap::mipmap(const uchar* aData, uint aWidth, uint aHeight, uint aChannelCount, settings aSettings) : mipmap() {
+		if ((aData == nullptr) || (aWidth == 0) || (aHeight == 0) || (aChannelCount == 0)) return;
+		const size_t C = aChannelCount;
+		const srgb_table& SRGB = srgb();
+		bool HasAlpha = (C == 4);
+		bool ColorIsSRGB = aSettings.SRGB && !aSettings.NormalMap;
+		size_t ColorChannelCount = HasAlpha ? 3 : C;
+
+		this->ChannelCount = aChannelCount;
+		this->Level.resize(level_count(aWidth, aHeight));
+		this->Level[0].Width = aWidth;
+		this->Level[0].Height = aHeight;
+		this->Level[0].Data.assign(aData, aData + (size_t)aWidth * aHeight * C);
+
+		// Decode the base level to linear space.
+		float_image Current;
+		Current.Width = aWidth;
+		Current.Height = aHeight;
+		Current.Data.resize((size_t)aWidth * aHeight * C);
+		parallel::for_range(aHeight, aSettings.ThreadCount, RowGrain, [&](size_t aBegin, size_t aEnd, size_t) {
+			for (size_t i = aBegin * aWidth * C; i < aEnd * aWidth * C; i++) {
+				bool Color = (i % C) < ColorChannelCount;
+				if (Color && aSettings.NormalMap) {
+					Current.Data[i] = (float)aData[i] / 127.5f - 1.0f;
+				}
+				else if (Color && ColorIsSRGB) {
+					Current.Data[i] = SRGB.Decode[aData[i]];
+				}
+				else {
+					Current.Data[i] = (float)aData[i] / 255.0f;
+				}
+			}
+		});
+
+		bool PreserveCoverage = HasAlpha && (aSettings.AlphaCutoff > 0.0f);
+		float TargetCoverage = PreserveCoverage ? coverage(Current, 1.0f, aSettings.AlphaCutoff) : 0.0f;
+
+		for (size_t l = 1; l < this->Level.size(); l++) {
+			if (aSettings.Filter == filter::KAISER) {
+				Current = kaiser_downsample(Current, aChannelCount, aSettings.KaiserWidth, aSettings.KaiserAlpha, aSettings.ThreadCount);
+			}
+			else {
+				Current = box_downsample(Current, aChannelCount, aSettings.ThreadCount);
+			}
+
+			float AlphaScale = PreserveCoverage ? coverage_scale(Current, TargetCoverage, aSettings.AlphaCutoff) : 1.0f;
+
+			// Encode the level, Current stays in linear space for the next level.
+			level& Level = this->Level[l];
+			Level.Width = Current.Width;
+			Level.Height = Current.Height;
+			Level.Data.resize((size_t)Current.Width * Current.Height * C);
+			parallel::for_range(Current.Height, aSettings.ThreadCount, RowGrain, [&](size_t aBegin, size_t aEnd, size_t) {
+				for (size_t p = aBegin * Current.Width; p < aEnd * Current.Width; p++) {
+					const float* In = &Current.Data[p * C];
+					uchar* Out = &Level.Data[p * C];
+					if (aSettings.NormalMap && (ColorChannelCount >= 3)) {
+						float Length = std::sqrt(In[0]*In[0] + In[1]*In[1] + In[2]*In[2]);
+						float Inverse = Length > 0.0f ? 1.0f / Length : 0.0f;
+						for (size_t c = 0; c < 3; c++) {
+							Out[c] = to_unorm(0.5f * (In[c] * Inverse) + 0.5f);
+						}
+					}
+					else {
+						for (size_t c = 0; c < ColorChannelCount; c++) {
+							if (ColorIsSRGB) {
+								float Linear = std::clamp(In[c], 0.0f, 1.0f);
+								Out[c] = SRGB.Encode[(size_t)(Linear * (float)(EncodeTableSize - 1) + 0.5f)];
+							}
+							else {
+								Out[c] = to_unorm(In[c]);
+							}
+						}
+					}
+					if (HasAlpha) {
+						Out[3] = to_unorm(In[3] * AlphaScale);
+					}
+				}
+			});
+		}
+	}
+
+	mipmap::mipmap(const gpu::image& aImage, settings aSettings) : mipmap((const uchar*)aImage.HostData, aImage.CreateInfo.extent.width, aImage.CreateInfo.extent.height, channel_count(aImage.CreateInfo.format), aSettings) {}
+
+	size_t mipmap::size() const {
+		size_t Size = 0;
+		for (const level& L : this->Level) {
+			Size += L.Data.size();
+		}
+		return Size;
+	}
+
+	std::vector<uchar> mipmap::pack() const {
+		std::vector<uchar> Packed;
+		Packed.reserve(this->size());
+		for (const level& L : this->Level) {
+			Packed.insert(Packed.end(), L.Data.begin(), L.Data.end());
+		}
+		return Packed;
+	}
+
+	uint mipmap::level_count(uint aWidth, uint aHeight) {
+		uint Count = 1;
+		while ((aWidth > 1) || (aHeight > 1)) {
+			aWidth = std::max(1u, aWidth / 2);
+			aHeight = std::max(1u, aHeight / 2);
+			Count++;
+		}
+		return Count;
+	}
+
+	uint mipmap::channel_count(int aImageFormat) {
+		switch (aImageFormat) {
+		case gpu::image::format::R8_UNORM:
+			return 1;
+		case gpu::image::format::R8G8_UNORM:
+			return 2;
+		case gpu::image::format::R8G8B8A8_UNORM:
+		case gpu::image::format::R8G8B8A8_SRGB:
+			return 4;
+		default:
+			return 0;
+		}
+	}
+
+}
@@ -1,7 +1,17 @@
 #include <geodesy/gfx/model.h>
+#include <geodesy/gfx/backend.h>
+#include <geodesy/gfx/trace.h>
 
 #include <assert.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <set>
+#include <unordered_map>
+
 #include <iostream>
 
 // Model Loading
@@ -9,7 +19,7 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
-static Assimp::Importer* ModelImporter = nullptr;
+#include "importer_pool.h"
 
 /*
 				  N[0]
@@ -69,18 +79,182 @@ namespace geodesy::gfx {
 		this->SpotAngle = 45.0f; // Default spot angle in degrees.
 	}
 
+	// Bytes of node arena needed for a hierarchy, one block for the whole tree.
+	static size_t arena_size(size_t aNodeCount, size_t aInstanceCount) {
+		return aNodeCount * (sizeof(gfx::node) + 2 * alignof(std::max_align_t)) + aInstanceCount * sizeof(mesh::instance) + 4096;
+	}
+
+	static void count_nodes(const aiNode* aNode, size_t& aNodeCount, size_t& aInstanceCount) {
+		aNodeCount += 1;
+		aInstanceCount += aNode->mNumMeshes;
+		for (unsigned int i = 0; i < aNode->mNumChildren; i++) {
+			count_nodes(aNode->mChildren[i], aNodeCount, aInstanceCount);
+		}
+	}
+
+	// Bytes of host data of the top level, for whatever format the image holds.
+	static size_t image_size(const gpu::image& aImage) {
+		const gpu::image::extent3d& Extent = aImage.CreateInfo.extent;
+		return (size_t)Extent.width * Extent.height * std::max(1u, Extent.depth) * std::max(1u, aImage.CreateInfo.arrayLayers) * gpu::image::bytes_per_pixel(aImage.CreateInfo.format);
+	}
+
+	static uint64_t fnv1a(uint64_t aHash, const void* aData, size_t aSize) {
+		const uchar* Byte = (const uchar*)aData;
+		for (size_t i = 0; i < aSize; i++) {
+			aHash = (aHash ^ Byte[i]) * 1099511628211ull;
+		}
+		return aHash;
+	}
+
+	// Separately loaded copies of one file are equal, images without host data only equal themselves.
+	static bool same_image(const std::shared_ptr<gpu::image>& aA, const std::shared_ptr<gpu::image>& aB) {
+		if (aA == aB) return true;
+		if ((aA == nullptr) || (aB == nullptr) || (aA->HostData == nullptr) || (aB->HostData == nullptr)) return false;
+		if (aA->CreateInfo.format != aB->CreateInfo.format) return false;
+		if (aA->CreateInfo.arrayLayers != aB->CreateInfo.arrayLayers) return false;
+		const gpu::image::extent3d& A = aA->CreateInfo.extent;
+		const gpu::image::extent3d& B = aB->CreateInfo.extent;
+		if ((A.width != B.width) || (A.height != B.height) || (A.depth != B.depth)) return false;
+		return std::memcmp(aA->HostData, aB->HostData, image_size(*aA)) == 0;
+	}
+
+	// Transform of aNode relative to aRoot, from the current local transforms.
+	static math::mat<float, 4, 4> transform_to_root(const phys::node* aNode, const phys::node* aRoot) {
+		math::mat<float, 4, 4> Transform = {
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f
+		};
+		for (const phys::node* Node = aNode; (Node != nullptr) && (Node != aRoot); Node = Node->Parent) {
+			Transform = Node->TransformToParentCurrent * Transform;
+		}
+		return Transform;
+	}
+
+	static math::vec<float, 3> transform_direction(const math::mat<float, 4, 4>& aTransform, const math::vec<float, 3>& aDirection) {
+		math::vec<float, 3> Result;
+		for (size_t i = 0; i < 3; i++) {
+			Result[i] = aTransform(i, 0) * aDirection[0] + aTransform(i, 1) * aDirection[1] + aTransform(i, 2) * aDirection[2];
+		}
+		float Length = std::sqrt(Result[0] * Result[0] + Result[1] * Result[1] + Result[2] * Result[2]);
+		return Length > 0.0f ? Result * (1.0f / Length) : Result;
+	}
+
+	// Builds the root with aArena current, the hierarchy keeps the arena alive until it is deleted.
+	template <typename... args>
+	static std::shared_ptr<gfx::node> make_hierarchy(std::shared_ptr<arena> aArena, args&&... aArgs) {
+		gfx::node* Root = nullptr;
+		{
+			arena::scope Scope(aArena.get());
+			Root = new gfx::node(std::forward<args>(aArgs)...);
+		}
+		return std::shared_ptr<gfx::node>(Root, [aArena](gfx::node* aNode) { delete aNode; });
+	}
+
+	const uint model::DefaultPostProcess = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices | aiProcess_CalcTangentSpace;
+
 	bool model::initialize() {
-		ModelImporter = new Assimp::Importer();
-		return (ModelImporter != nullptr);
+		// Importers are leased per import from a pool, warm it with one.
+		importer_pool::acquire();
+		return true;
 	}
 
 	void model::terminate() {
-		delete ModelImporter;
-		ModelImporter = nullptr;
+		importer_pool::clear();
 	}
 
 	model::model() {
 		this->Time = 0.0;
+		this->MaterialTable = nullptr;
+		this->MaterialTableOffset = 0;
+		this->MaterialTableCount = 0;
+	}
+
+	model::model(std::string aFilePath, uint aPostProcess, size_t aThreadCount) : model() {
+		GEODESY_GFX_TRACE_ZONE("model::import");
+		if (aFilePath.length() == 0) return;
+		// Each import leases its own importer, so models can be imported from several threads.
+		std::shared_ptr<Assimp::Importer> Importer = importer_pool::acquire();
+		const aiScene* Scene = Importer->ReadFile(aFilePath, aPostProcess);
+		if (Scene == nullptr) return;
+		this->Path = aFilePath;
+		size_t Separator = aFilePath.find_last_of("/\\");
+		this->convert(Scene, Separator == std::string::npos ? std::string(".") : aFilePath.substr(0, Separator), nullptr, aThreadCount);
+	}
+
+	model::model(const aiScene* aScene, std::string aDirectory, std::function<bool(float)> aProgress, size_t aThreadCount) : model() {
+		this->convert(aScene, aDirectory, aProgress, aThreadCount);
+	}
+
+	bool model::convert(const aiScene* aScene, std::string aDirectory, std::function<bool(float)> aProgress, size_t aThreadCount) {
+		GEODESY_GFX_TRACE_ZONE("model::convert");
+		// Meshes and materials dominate conversion time, so progress counts those.
+		size_t Total = aScene->mNumMeshes + aScene->mNumMaterials;
+		size_t Done = 0;
+		auto Step = [&]() -> bool {
+			Done += 1;
+			return (aProgress == nullptr) || aProgress(Total > 0 ? (float)Done / (float)Total : 1.0f);
+		};
+
+		this->Name = aScene->mName.C_Str();
+
+		// Create node hierarchy from the scene.
+		size_t NodeCount = 0, InstanceCount = 0;
+		count_nodes(aScene->mRootNode, NodeCount, InstanceCount);
+		this->NodeArena = std::make_shared<arena>(arena_size(NodeCount, InstanceCount));
+		this->Hierarchy = make_hierarchy(this->NodeArena, aScene, aScene->mRootNode);
+
+		// Load animation tracks.
+		this->Animation = std::vector<phys::animation>(aScene->mNumAnimations);
+		for (size_t i = 0; i < this->Animation.size(); i++) {
+			this->Animation[i] = phys::animation(aScene->mAnimations[i]);
+		}
+
+		// Load meshes.
+		this->Mesh = std::vector<std::shared_ptr<mesh>>(aScene->mNumMeshes);
+		for (size_t i = 0; i < this->Mesh.size(); i++) {
+			this->Mesh[i] = std::shared_ptr<mesh>(new mesh(aScene->mMeshes[i], aThreadCount));
+			if (!Step()) return false;
+		}
+
+		// Load materials and their textures.
+		this->Material = std::vector<std::shared_ptr<material>>(aScene->mNumMaterials);
+		for (size_t i = 0; i < this->Material.size(); i++) {
+			this->Material[i] = std::shared_ptr<material>(new material(aScene->mMaterials[i], aDirectory));
+			if (!Step()) return false;
+		}
+
+		// Load lights.
+		this->Light = std::vector<light>(aScene->mNumLights);
+		for (size_t i = 0; i < this->Light.size(); i++) {
+			const aiLight* Light = aScene->mLights[i];
+			switch (Light->mType) {
+			case aiLightSource_AMBIENT:
+				this->Light[i].Type = light::AMBIENT;
+				break;
+			case aiLightSource_DIRECTIONAL:
+				this->Light[i].Type = light::DIRECTIONAL;
+				break;
+			case aiLightSource_POINT:
+				this->Light[i].Type = light::POINT;
+				break;
+			case aiLightSource_SPOT:
+				this->Light[i].Type = light::SPOT;
+				break;
+			case aiLightSource_AREA:
+				this->Light[i].Type = light::AREA;
+				break;
+			default:
+				this->Light[i].Type = light::UNDEFINED;
+				break;
+			}
+			this->Light[i].Color = math::vec<float, 3>(Light->mColorDiffuse.r, Light->mColorDiffuse.g, Light->mColorDiffuse.b);
+			this->Light[i].Position = math::vec<float, 3>(Light->mPosition.x, Light->mPosition.y, Light->mPosition.z);
+			this->Light[i].Direction = math::vec<float, 3>(Light->mDirection.x, Light->mDirection.y, Light->mDirection.z);
+			this->Light[i].SpotAngle = Light->mAngleInnerCone;
+		}
+		return true;
 	}
 
 	// model::model(std::string aFilePath, file::manager* aFileManager) : file(aFilePath) {
@@ -195,38 +369,432 @@ namespace geodesy::gfx {
 	// 	ModelImporter->FreeScene();
 	// }
 
-	model::model(std::shared_ptr<gpu::context> aContext, std::shared_ptr<model> aModel, gpu::image::create_info aCreateInfo) : model() {
-		this->Name = aModel->Name;
+	model::model(std::shared_ptr<gpu::context> aContext, std::shared_ptr<model> aModel, gpu::image::create_info aCreateInfo, std::shared_ptr<material_table> aMaterialTable) : model() {
+		this->create(aContext, *aModel, aCreateInfo, aMaterialTable, false);
+	}
+
+	model::model(std::shared_ptr<gpu::context> aContext, model&& aModel, gpu::image::create_info aCreateInfo, std::shared_ptr<material_table> aMaterialTable) : model() {
+		this->create(aContext, aModel, aCreateInfo, aMaterialTable, true);
+	}
+
+	model::~model() {
+		// Return the table entries, materials that outlive the model stop writing to them.
+		if (this->MaterialTable != nullptr) {
+			for (const std::shared_ptr<material>& Material : this->Material) {
+				if ((Material != nullptr) && (Material->Table == this->MaterialTable)) {
+					Material->Table 		= nullptr;
+					Material->TableIndex 	= UINT32_MAX;
+				}
+			}
+			this->MaterialTable->release(this->MaterialTableOffset, this->MaterialTableCount);
+		}
+	}
+
+	void model::create(std::shared_ptr<gpu::context> aContext, model& aModel, gpu::image::create_info aCreateInfo, std::shared_ptr<material_table> aMaterialTable, bool aMove) {
+		GEODESY_GFX_TRACE_ZONE("model::create");
+		this->Name = aMove ? std::move(aModel.Name) : aModel.Name;
+		this->Path = aModel.Path;
+		// Device resources created below are attributed to this model, by source path since scene
+		// names are mostly empty or shared. Models without a path get an id of their own.
+		static std::atomic<size_t> ModelCount(0);
+		std::string Key = this->Path.empty() ? "model#" + std::to_string(ModelCount.fetch_add(1)) : this->Path;
+		this->LedgerOwner = memory_ledger::escape(Key);
+		memory_ledger::scope Owner(Key);
 		this->Context = aContext;
 
 		// Create Node Hierarchy for GPU.
-		this->Hierarchy = std::shared_ptr<gfx::node>(new gfx::node(aContext, aModel->Hierarchy.get()));
+		this->NodeArena = std::make_shared<arena>(arena_size(aModel.Hierarchy->linearize().size(), aModel.Hierarchy->instance_count()));
+		this->Hierarchy = make_hierarchy(this->NodeArena, aContext, (const gfx::node*)aModel.Hierarchy.get());
 
-		// Load node animations.
-		this->Animation = aModel->Animation;
+		// Load node animations. Compressed clips are immutable and shared with the host model. The
+		// uncompressed tracks are kept as well, callers may still play them through host_update, and
+		// they are already empty if compress_animation released them.
+		this->CompressedAnimation = aModel.CompressedAnimation;
+		this->Animation = aMove ? std::move(aModel.Animation) : aModel.Animation;
 
 		// Load meshes into GPU memory.
-		this->Mesh = std::vector<std::shared_ptr<gfx::mesh>>(aModel->Mesh.size());
-		for (std::size_t i = 0; i < aModel->Mesh.size(); i++) {
-			this->Mesh[i] = std::shared_ptr<mesh>(new mesh(aContext, aModel->Mesh[i]));
+		this->Mesh = std::vector<std::shared_ptr<gfx::mesh>>(aModel.Mesh.size());
+		for (std::size_t i = 0; i < aModel.Mesh.size(); i++) {
+			this->Mesh[i] = std::shared_ptr<mesh>(new mesh(aContext, aModel.Mesh[i]));
 		}
 
-		// Load materials into GPU memory.
-		this->Material = std::vector<std::shared_ptr<gfx::material>>(aModel->Material.size());
-		for (std::size_t i = 0; i < aModel->Material.size(); i++) {
-			this->Material[i] = std::shared_ptr<material>(new material(aContext, aCreateInfo, aModel->Material[i]));
+		// Load materials into GPU memory. With a material table, the model takes a contiguous
+		// range of entries so MaterialIndex stays a valid offset into it.
+		this->Material = std::vector<std::shared_ptr<gfx::material>>(aModel.Material.size());
+		if (aMaterialTable != nullptr) {
+			this->MaterialTable = aMaterialTable;
+			this->MaterialTableOffset = aMaterialTable->allocate(aModel.Material.size());
+			this->MaterialTableCount = aModel.Material.size();
+			for (std::size_t i = 0; i < aModel.Material.size(); i++) {
+				this->Material[i] = std::shared_ptr<material>(new material(aContext, aCreateInfo, aModel.Material[i], aMaterialTable, this->MaterialTableOffset + (uint)i));
+			}
+		}
+		else {
+			for (std::size_t i = 0; i < aModel.Material.size(); i++) {
+				this->Material[i] = std::shared_ptr<material>(new material(aContext, aCreateInfo, aModel.Material[i]));
+			}
 		}
 
 		// Load textures into GPU memory.
-		this->Texture = std::vector<std::shared_ptr<gpu::image>>(aModel->Texture.size());
-		for (std::size_t i = 0; i < aModel->Texture.size(); i++) {
-			this->Texture[i] = std::shared_ptr<gpu::image>(new gpu::image(aContext, aCreateInfo, aModel->Texture[i]));
+		this->Texture = std::vector<std::shared_ptr<gpu::image>>(aModel.Texture.size());
+		backend* Backend = backend::get(aContext);
+		for (std::size_t i = 0; i < aModel.Texture.size(); i++) {
+			this->Texture[i] = Backend != nullptr ? Backend->create_image(aContext, aCreateInfo, aModel.Texture[i]) : aModel.Texture[i];
 		}
 
+		if (aMove) {
+			// Everything left in the host model now lives on the device, or is shared with it.
+			this->Light = std::move(aModel.Light);
+			aModel.Hierarchy = nullptr;
+			aModel.NodeArena = nullptr;
+			aModel.Animation.clear();
+			aModel.CompressedAnimation.clear();
+			aModel.Mesh.clear();
+			aModel.Material.clear();
+			aModel.Texture.clear();
+		}
 	}
 
-	model::~model() {
+	size_t model::deduplicate_materials() {
+		GEODESY_GFX_TRACE_ZONE("model::deduplicate_materials");
+		// Images are identified by source path, format and size, images without a path by address.
+		// Texels are never hashed, they are only compared for candidates whose identities collide.
+		std::unordered_map<const gpu::image*, uint64_t> ImageHash;
+		auto image_hash = [&](const std::shared_ptr<gpu::image>& aImage) -> uint64_t {
+			if (aImage == nullptr) return 0;
+			auto It = ImageHash.find(aImage.get());
+			if (It != ImageHash.end()) return It->second;
+			uint64_t Hash = 14695981039346656037ull;
+			if ((aImage->HostData != nullptr) && !aImage->Path.empty()) {
+				int Format = (int)aImage->CreateInfo.format;
+				uint Layers = aImage->CreateInfo.arrayLayers;
+				Hash = fnv1a(Hash, aImage->Path.data(), aImage->Path.size());
+				Hash = fnv1a(Hash, &Format, sizeof(Format));
+				Hash = fnv1a(Hash, &Layers, sizeof(Layers));
+				Hash = fnv1a(Hash, &aImage->CreateInfo.extent, sizeof(aImage->CreateInfo.extent));
+			}
+			else {
+				const gpu::image* Pointer = aImage.get();
+				Hash = fnv1a(Hash, &Pointer, sizeof(Pointer));
+			}
+			ImageHash[aImage.get()] = Hash;
+			return Hash;
+		};
+
+		std::vector<std::array<uint32_t, material::uniform_data::WordCount>> Word(this->Material.size());
+		std::unordered_map<uint64_t, std::vector<uint>> Bucket;
+		std::vector<std::shared_ptr<material>> Unique;
+		std::vector<uint> Remap(this->Material.size());
+		for (size_t i = 0; i < this->Material.size(); i++) {
+			const material& Material = *this->Material[i];
+			Word[i] = Material.UniformData.words();
+			uint64_t Hash = fnv1a(14695981039346656037ull, Word[i].data(), Word[i].size() * sizeof(uint32_t));
+			for (const std::shared_ptr<gpu::image>& Image : Material.Texture) {
+				uint64_t TextureHash = image_hash(Image);
+				Hash = fnv1a(Hash, &TextureHash, sizeof(TextureHash));
+			}
+
+			// Hashes only pick the candidates, duplicates are confirmed field by field and texel by texel.
+			std::vector<uint>& Candidate = Bucket[Hash];
+			Remap[i] = (uint)Unique.size();
+			for (uint j : Candidate) {
+				const material& Other = *this->Material[j];
+				bool Same = (Word[i] == Word[j]);
+				for (int Slot = 0; Same && (Slot < material::TEXTURE_SLOT_COUNT); Slot++) {
+					Same = same_image(Material.Texture[Slot], Other.Texture[Slot]);
+				}
+				if (Same) {
+					Remap[i] = Remap[j];
+					break;
+				}
+			}
+			if (Remap[i] == Unique.size()) {
+				Candidate.push_back((uint)i);
+				Unique.push_back(this->Material[i]);
+			}
+		}
 
+		size_t Merged = this->Material.size() - Unique.size();
+		if (Merged == 0) return 0;
+		// Dropping the merged materials releases their texture copies.
+		this->Material = std::move(Unique);
+		if (this->Hierarchy != nullptr) {
+			for (phys::node* Node : this->Hierarchy->linearize()) {
+				gfx::node* GNode = dynamic_cast<gfx::node*>(Node);
+				if (GNode == nullptr) continue;
+				for (mesh::instance& Instance : GNode->GraphicalMeshInstances) {
+					if (Instance.MaterialIndex < Remap.size()) {
+						Instance.MaterialIndex = Remap[Instance.MaterialIndex];
+					}
+				}
+			}
+		}
+		return Merged;
+	}
+
+	model::merge_statistics::merge_statistics() {
+		this->InstanceCount 	= 0;
+		this->BatchCount 		= 0;
+		this->VertexCount 		= 0;
+	}
+
+	model::merge_statistics model::merge_static_geometry() {
+		GEODESY_GFX_TRACE_ZONE("model::merge_static_geometry");
+		merge_statistics Statistics;
+		if (this->Hierarchy == nullptr) return Statistics;
+		phys::node* Root = this->Hierarchy.get();
+
+		// Nodes moved by a clip, and everything below them, must keep their own instances.
+		std::set<std::string> Animated;
+		for (const phys::animation& Animation : this->Animation) {
+			for (const auto& Channel : Animation.NodeAnimMap) {
+				Animated.insert(Channel.first);
+			}
+		}
+		for (const std::shared_ptr<const animation>& Animation : this->CompressedAnimation) {
+			for (const auto& Channel : Animation->Channel) {
+				Animated.insert(Channel.first);
+			}
+		}
+		auto is_static = [&](const phys::node* aNode) -> bool {
+			for (const phys::node* Node = aNode; Node != nullptr; Node = Node->Parent) {
+				if (Animated.count(Node->Identifier) > 0) return false;
+			}
+			return true;
+		};
+
+		// Opaque unskinned instances on static nodes, grouped by material in hierarchy order.
+		struct source {
+			const mesh* 				Mesh;
+			math::mat<float, 4, 4> 		Transform;
+		};
+		std::map<uint, std::vector<source>> Group;
+		for (phys::node* Node : Root->linearize()) {
+			gfx::node* GNode = dynamic_cast<gfx::node*>(Node);
+			if ((GNode == nullptr) || !is_static(GNode)) continue;
+			math::mat<float, 4, 4> Transform = transform_to_root(GNode, Root);
+			auto End = std::remove_if(GNode->GraphicalMeshInstances.begin(), GNode->GraphicalMeshInstances.end(), [&](const mesh::instance& aInstance) -> bool {
+				if ((aInstance.Bone != nullptr) && (aInstance.Bone->size() > 0)) return false;
+				if ((aInstance.MeshIndex < 0) || ((size_t)aInstance.MeshIndex >= this->Mesh.size()) || (aInstance.MaterialIndex >= this->Material.size())) return false;
+				// Blended and alpha tested instances stay separate, they are sorted per instance.
+				const material* Material = this->Material[aInstance.MaterialIndex].get();
+				if ((Material == nullptr) || (Material->UniformData.Transparency != material::transparency::OPAQUE)) return false;
+				const mesh* Mesh = this->Mesh[aInstance.MeshIndex].get();
+				if ((Mesh == nullptr) || (Mesh->Vertex.size() == 0)) return false;
+				Group[aInstance.MaterialIndex].push_back({ Mesh, Transform });
+				return true;
+			});
+			Statistics.InstanceCount += GNode->GraphicalMeshInstances.end() - End;
+			GNode->GraphicalMeshInstances.erase(End, GNode->GraphicalMeshInstances.end());
+		}
+		if (Statistics.InstanceCount == 0) return Statistics;
+
+		// Drop the meshes no instance uses any more and compact the mesh indices.
+		std::vector<gfx::mesh::instance*> Remaining = this->Hierarchy->gather_instances();
+		std::vector<int> MeshRemap(this->Mesh.size(), -1);
+		for (const gfx::mesh::instance* Instance : Remaining) {
+			if ((Instance->MeshIndex >= 0) && ((size_t)Instance->MeshIndex < MeshRemap.size())) {
+				MeshRemap[Instance->MeshIndex] = 0;
+			}
+		}
+		std::vector<std::shared_ptr<mesh>> Kept;
+		for (size_t i = 0; i < this->Mesh.size(); i++) {
+			if (MeshRemap[i] < 0) continue;
+			MeshRemap[i] = (int)Kept.size();
+			Kept.push_back(this->Mesh[i]);
+		}
+		for (gfx::mesh::instance* Instance : Remaining) {
+			if ((Instance->MeshIndex >= 0) && ((size_t)Instance->MeshIndex < MeshRemap.size())) {
+				Instance->MeshIndex = MeshRemap[Instance->MeshIndex];
+			}
+		}
+
+		// Pre-transform every group into root space. A batch holds at most 2^16 vertices so
+		// it keeps 16 bit indices, only a single mesh larger than that gets a batch with 32 bit indices.
+		std::vector<std::shared_ptr<mesh>> Batch;
+		std::vector<uint> BatchMaterial;
+		for (const auto& [MaterialIndex, Source] : Group) {
+			std::shared_ptr<mesh> Current;
+			std::vector<uint> Index;
+			auto flush = [&]() {
+				if (Current == nullptr) return;
+				if (Current->Vertex.size() <= (1 << 16)) {
+					Current->Topology.Data16 = std::vector<ushort>(Index.begin(), Index.end());
+				}
+				else {
+					Current->Topology.Data32 = std::move(Index);
+				}
+				Current->CenterOfMass = Current->calculate_center_of_mass();
+				Current->BoundingRadius = Current->calculate_bounding_radius();
+				Statistics.VertexCount += Current->Vertex.size();
+				Batch.push_back(Current);
+				BatchMaterial.push_back(MaterialIndex);
+				Current = nullptr;
+				Index.clear();
+			};
+			for (const source& Item : Source) {
+				if ((Current != nullptr) && (Current->Vertex.size() + Item.Mesh->Vertex.size() > (1 << 16))) {
+					flush();
+				}
+				if (Current == nullptr) {
+					Current = std::make_shared<mesh>();
+					Current->Name = "static:" + this->Material[MaterialIndex]->Name + ":" + std::to_string(Batch.size());
+				}
+				const math::mat<float, 4, 4>& T = Item.Transform;
+				// Normals use the cofactor matrix, which handles non uniform scale, and mirroring
+				// transforms flip the winding so front faces stay front faces.
+				float Determinant =
+					T(0, 0) * (T(1, 1) * T(2, 2) - T(1, 2) * T(2, 1)) -
+					T(0, 1) * (T(1, 0) * T(2, 2) - T(1, 2) * T(2, 0)) +
+					T(0, 2) * (T(1, 0) * T(2, 1) - T(1, 1) * T(2, 0));
+				float Sign = Determinant < 0.0f ? -1.0f : 1.0f;
+				math::mat<float, 4, 4> Cofactor = T * 0.0f;
+				for (size_t i = 0; i < 3; i++) {
+					for (size_t j = 0; j < 3; j++) {
+						size_t i1 = (i + 1) % 3, i2 = (i + 2) % 3, j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+						Cofactor(i, j) = Sign * (T(i1, j1) * T(i2, j2) - T(i1, j2) * T(i2, j1));
+					}
+				}
+
+				uint Base = (uint)Current->Vertex.size();
+				for (const mesh::vertex& Input : Item.Mesh->Vertex) {
+					mesh::vertex Vertex = Input;
+					for (size_t i = 0; i < 3; i++) {
+						Vertex.Position[i] = T(i, 0) * Input.Position[0] + T(i, 1) * Input.Position[1] + T(i, 2) * Input.Position[2] + T(i, 3);
+					}
+					Vertex.Normal 		= transform_direction(Cofactor, Input.Normal);
+					Vertex.Tangent 		= transform_direction(T, Input.Tangent);
+					Vertex.Bitangent 	= transform_direction(T, Input.Bitangent);
+					Current->Vertex.push_back(Vertex);
+				}
+				const bool Wide = Item.Mesh->Topology.Data16.empty();
+				size_t IndexCount = Wide ? Item.Mesh->Topology.Data32.size() : Item.Mesh->Topology.Data16.size();
+				for (size_t i = 0; i + 2 < IndexCount; i += 3) {
+					uint Triangle[3];
+					for (size_t k = 0; k < 3; k++) {
+						Triangle[k] = Base + (Wide ? Item.Mesh->Topology.Data32[i + k] : (uint)Item.Mesh->Topology.Data16[i + k]);
+					}
+					if (Determinant < 0.0f) std::swap(Triangle[1], Triangle[2]);
+					Index.insert(Index.end(), Triangle, Triangle + 3);
+				}
+			}
+			flush();
+		}
+
+		// One instance per batch on the root, which supplies the transform of the whole batch.
+		gfx::node* RootNode = this->Hierarchy.get();
+		RootNode->GraphicalMeshInstances.reserve(RootNode->GraphicalMeshInstances.size() + Batch.size());
+		for (size_t i = 0; i < Batch.size(); i++) {
+			RootNode->GraphicalMeshInstances.push_back(mesh::instance((uint)Batch[i]->Vertex.size(), {}, (int)Kept.size(), BatchMaterial[i], Root, Root));
+			Kept.push_back(Batch[i]);
+		}
+		this->Mesh = std::move(Kept);
+		Statistics.BatchCount = Batch.size();
+		return Statistics;
+	}
+
+	std::vector<mesh::cleanup_statistics> model::cleanup_meshes(mesh::cleanup_settings aSettings) {
+		GEODESY_GFX_TRACE_ZONE("model::cleanup_meshes");
+		std::vector<mesh::cleanup_statistics> Statistics(this->Mesh.size());
+		std::vector<std::vector<mesh::instance*>> User(this->Mesh.size());
+		if (this->Hierarchy != nullptr) {
+			for (mesh::instance* Instance : this->Hierarchy->gather_instances()) {
+				if ((Instance->MeshIndex >= 0) && ((size_t)Instance->MeshIndex < User.size())) {
+					User[Instance->MeshIndex].push_back(Instance);
+				}
+			}
+		}
+		for (size_t i = 0; i < this->Mesh.size(); i++) {
+			if (this->Mesh[i] == nullptr) continue;
+			std::vector<const std::vector<mesh::vertex::weight>*> Weight;
+			for (const mesh::instance* Instance : User[i]) {
+				Weight.push_back(Instance->Vertex.get());
+			}
+			std::vector<uint> Remap;
+			Statistics[i] = this->Mesh[i]->cleanup(aSettings, Weight, &Remap);
+
+			// Instances share their weights and bones with copies, remap each set once.
+			std::map<const void*, std::shared_ptr<const std::vector<mesh::vertex::weight>>> NewVertex;
+			std::map<const void*, std::shared_ptr<const std::vector<phys::mesh::bone>>> NewBone;
+			for (mesh::instance* Instance : User[i]) {
+				if ((Instance->Vertex != nullptr) && (Instance->Vertex->size() == Remap.size())) {
+					auto& Vertex = NewVertex[Instance->Vertex.get()];
+					if (Vertex == nullptr) {
+						std::vector<mesh::vertex::weight> Data(this->Mesh[i]->Vertex.size());
+						for (size_t j = 0; j < Remap.size(); j++) {
+							if (Remap[j] != UINT32_MAX) Data[Remap[j]] = (*Instance->Vertex)[j];
+						}
+						Vertex = std::make_shared<const std::vector<mesh::vertex::weight>>(std::move(Data));
+					}
+					Instance->Vertex = Vertex;
+				}
+				if ((Instance->Bone != nullptr) && (Instance->Bone->size() > 0)) {
+					auto& Bone = NewBone[Instance->Bone.get()];
+					if (Bone == nullptr) {
+						std::vector<phys::mesh::bone> Data = *Instance->Bone;
+						for (phys::mesh::bone& B : Data) {
+							// Welded vertices carried the same weight, keep one entry each.
+							std::set<uint> Seen;
+							std::vector<phys::mesh::bone::weight> Kept;
+							for (const phys::mesh::bone::weight& W : B.Vertex) {
+								if ((W.ID >= Remap.size()) || (Remap[W.ID] == UINT32_MAX)) continue;
+								if (!Seen.insert(Remap[W.ID]).second) continue;
+								Kept.push_back({ Remap[W.ID], W.Weight });
+							}
+							B.Vertex = std::move(Kept);
+						}
+						Bone = std::make_shared<const std::vector<phys::mesh::bone>>(std::move(Data));
+					}
+					Instance->Bone = Bone;
+				}
+			}
+		}
+		return Statistics;
+	}
+
+	size_t model::compress_textures(compressed_texture::cache* aCache, size_t aThreadCount) {
+		GEODESY_GFX_TRACE_ZONE("model::compress_textures");
+		// The slot of the first material using an image picks its format. Sources are held until
+		// the end, so their addresses stay unique while they key Compressed.
+		std::unordered_map<const gpu::image*, std::shared_ptr<gpu::image>> Compressed;
+		std::vector<std::shared_ptr<gpu::image>> Source;
+		size_t Count = 0;
+		for (const std::shared_ptr<material>& Material : this->Material) {
+			if (Material == nullptr) continue;
+			bool Replaced = false;
+			for (int Slot = 0; Slot < material::TEXTURE_SLOT_COUNT; Slot++) {
+				std::shared_ptr<gpu::image>& Image = Material->Texture[Slot];
+				if (Image == nullptr) continue;
+				auto It = Compressed.find(Image.get());
+				if (It == Compressed.end()) {
+					It = Compressed.emplace(Image.get(), compressed_texture::compress(*Image, (material::texture_slot)Slot, aCache, aThreadCount)).first;
+					Count += It->second != nullptr ? 1 : 0;
+				}
+				if (It->second == nullptr) continue;
+				Source.push_back(Image);
+				Image = It->second;
+				Replaced = true;
+			}
+			if (Replaced) {
+				Material->update_texture_bindings();
+			}
+		}
+		return Count;
+	}
+
+	std::vector<animation::statistics> model::compress_animation(animation::settings aSettings, bool aReleaseSource) {
+		std::vector<animation::statistics> Statistics(this->Animation.size());
+		this->CompressedAnimation = std::vector<std::shared_ptr<const animation>>(this->Animation.size());
+		for (size_t i = 0; i < this->Animation.size(); i++) {
+			std::shared_ptr<animation> Clip = std::make_shared<animation>(this->Animation[i], aSettings);
+			Statistics[i] = animation::compare(this->Animation[i], *Clip);
+			this->CompressedAnimation[i] = Clip;
+		}
+		if (aReleaseSource) {
+			this->Animation.clear();
+			this->Animation.shrink_to_fit();
+		}
+		return Statistics;
 	}
 
 }
@@ -0,0 +1,250 @@
+#include <geodesy/gfx/model_loader.h>
+#include <geodesy/gfx/trace.h>
+
+#include <chrono>
+#include <algorithm>
+
+// Model Loading
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "importer_pool.h"
+
+namespace geodesy::gfx {
+
+	// Share of the total progress given to each stage.
+	static const float ParseProgress 	= 0.2f;
+	static const float ConvertProgress 	= 0.6f;
+
+	static double seconds_since(std::chrono::steady_clock::time_point aStart) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - aStart).count();
+	}
+
+	static std::string directory_of(const std::string& aPath) {
+		size_t Separator = aPath.find_last_of("/\\");
+		return Separator == std::string::npos ? std::string(".") : aPath.substr(0, Separator);
+	}
+
+	model_loader::settings::settings() {
+		this->ThreadCount 			= 0;
+		this->ConvertThreadCount 	= 0;
+		this->PostProcess 			= model::DefaultPostProcess;
+		this->CompressAnimation 	= false;
+		this->DeduplicateMaterials 	= false;
+		this->CleanupMeshes 		= false;
+		this->MergeStaticGeometry 	= false;
+		this->CompressTextures 		= false;
+		this->MaterialTable 		= nullptr;
+	}
+
+	model_loader::request::request(std::string aPath) {
+		this->Path 			= aPath;
+		this->Stage 		= QUEUED;
+		this->Progress 		= 0.0f;
+		this->StageTime[0] 	= 0.0;
+		this->StageTime[1] 	= 0.0;
+		this->StageTime[2] 	= 0.0;
+		this->Cancel 		= false;
+		this->Future 		= this->Promise.get_future().share();
+	}
+
+	void model_loader::request::cancel() {
+		this->Cancel = true;
+	}
+
+	bool model_loader::request::cancelled() const {
+		return this->Cancel;
+	}
+
+	bool model_loader::request::done() const {
+		int Stage = this->Stage;
+		return (Stage == COMPLETE) || (Stage == CANCELLED) || (Stage == FAILED);
+	}
+
+	model_loader::model_loader() {
+		this->Context 	= nullptr;
+		this->Stop 		= false;
+	}
+
+	model_loader::model_loader(std::shared_ptr<gpu::context> aContext, settings aSettings) : model_loader() {
+		this->Context 	= aContext;
+		this->Settings 	= aSettings;
+		// Leave a hardware thread for the render thread by default.
+		size_t ThreadCount = aSettings.ThreadCount;
+		if (ThreadCount == 0) {
+			size_t Hardware = std::thread::hardware_concurrency();
+			ThreadCount = Hardware > 1 ? Hardware - 1 : 1;
+		}
+		// Workers already convert models side by side, by default each converts its meshes alone.
+		if (this->Settings.ConvertThreadCount == 0) {
+			this->Settings.ConvertThreadCount = ThreadCount > 1 ? 1 : 0;
+		}
+		for (size_t i = 0; i < ThreadCount; i++) {
+			this->Worker.emplace_back(&model_loader::work, this);
+		}
+	}
+
+	model_loader::~model_loader() {
+		this->cancel();
+		{
+			std::lock_guard<std::mutex> Lock(this->Mutex);
+			this->Stop = true;
+		}
+		this->Condition.notify_all();
+		for (std::thread& Worker : this->Worker) {
+			Worker.join();
+		}
+		// Jobs never picked up still owe their requests a result.
+		for (std::shared_ptr<request>& Request : this->Active) {
+			Request->Stage = CANCELLED;
+			Request->Promise.set_value(nullptr);
+		}
+	}
+
+	std::shared_ptr<model_loader::request> model_loader::load(std::string aPath) {
+		std::shared_ptr<request> Request = std::make_shared<request>(aPath);
+		{
+			std::lock_guard<std::mutex> Lock(this->Mutex);
+			this->Active.push_back(Request);
+		}
+		this->submit([this, Request]() { this->parse(Request); });
+		return Request;
+	}
+
+	std::vector<std::shared_ptr<model_loader::request>> model_loader::poll() {
+		std::vector<std::shared_ptr<request>> Result;
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		Result.swap(this->Finished);
+		return Result;
+	}
+
+	size_t model_loader::pending() const {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		return this->Active.size();
+	}
+
+	void model_loader::cancel() {
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		for (std::shared_ptr<request>& Request : this->Active) {
+			Request->cancel();
+		}
+	}
+
+	void model_loader::work() {
+		while (true) {
+			std::function<void()> Job;
+			{
+				std::unique_lock<std::mutex> Lock(this->Mutex);
+				this->Condition.wait(Lock, [this]() { return this->Stop || !this->Job.empty(); });
+				if (this->Job.empty()) return;
+				Job = std::move(this->Job.front());
+				this->Job.pop_front();
+			}
+			Job();
+		}
+	}
+
+	void model_loader::submit(std::function<void()> aJob) {
+		{
+			std::lock_guard<std::mutex> Lock(this->Mutex);
+			this->Job.push_back(std::move(aJob));
+		}
+		this->Condition.notify_one();
+	}
+
+	void model_loader::parse(std::shared_ptr<request> aRequest) {
+		GEODESY_GFX_TRACE_ZONE("model_loader::parse");
+		if (aRequest->cancelled()) return this->finish(aRequest, CANCELLED, nullptr);
+		aRequest->Stage = PARSE;
+		auto Start = std::chrono::steady_clock::now();
+
+		// Importers are not thread safe, each load leases its own and keeps it until the
+		// scene has been converted.
+		aRequest->Importer = importer_pool::acquire();
+		const aiScene* Scene = aRequest->Importer->ReadFile(aRequest->Path, this->Settings.PostProcess);
+		aRequest->StageTime[0] = seconds_since(Start);
+		if (Scene == nullptr) {
+			aRequest->Error = aRequest->Importer->GetErrorString();
+			aRequest->Importer = nullptr;
+			return this->finish(aRequest, FAILED, nullptr);
+		}
+		aRequest->Progress = ParseProgress;
+		this->submit([this, aRequest]() { this->convert(aRequest); });
+	}
+
+	void model_loader::convert(std::shared_ptr<request> aRequest) {
+		GEODESY_GFX_TRACE_ZONE("model_loader::convert");
+		if (aRequest->cancelled()) return this->finish(aRequest, CANCELLED, nullptr);
+		aRequest->Stage = CONVERT;
+		auto Start = std::chrono::steady_clock::now();
+
+		const aiScene* Scene = aRequest->Importer->GetScene();
+		request* Request = aRequest.get();
+		aRequest->HostModel = std::make_shared<model>(Scene, directory_of(aRequest->Path), [Request](float aProgress) -> bool {
+			Request->Progress = ParseProgress + ConvertProgress * aProgress;
+			return !Request->cancelled();
+		}, this->Settings.ConvertThreadCount);
+		aRequest->HostModel->Path = aRequest->Path;
+		if ((this->Settings.CompressAnimation) && !aRequest->cancelled()) {
+			aRequest->HostModel->compress_animation();
+		}
+		if ((this->Settings.DeduplicateMaterials) && !aRequest->cancelled()) {
+			aRequest->HostModel->deduplicate_materials();
+		}
+		if ((this->Settings.CleanupMeshes) && !aRequest->cancelled()) {
+			aRequest->HostModel->cleanup_meshes();
+		}
+		if ((this->Settings.MergeStaticGeometry) && !aRequest->cancelled()) {
+			aRequest->HostModel->merge_static_geometry();
+		}
+		// After deduplication, so merged materials do not encode their textures twice.
+		if ((this->Settings.CompressTextures) && !aRequest->cancelled()) {
+			aRequest->HostModel->compress_textures(&this->TextureCache, this->Settings.ConvertThreadCount);
+		}
+		// The scene is no longer needed.
+		aRequest->Importer = nullptr;
+		aRequest->StageTime[1] = seconds_since(Start);
+		if (aRequest->cancelled()) return this->finish(aRequest, CANCELLED, nullptr);
+
+		aRequest->Progress = ParseProgress + ConvertProgress;
+		if (this->Context == nullptr) {
+			// Host only loader, the host model is the result.
+			std::shared_ptr<model> HostModel = aRequest->HostModel;
+			aRequest->HostModel = nullptr;
+			return this->finish(aRequest, COMPLETE, HostModel);
+		}
+		this->submit([this, aRequest]() { this->upload(aRequest); });
+	}
+
+	void model_loader::upload(std::shared_ptr<request> aRequest) {
+		GEODESY_GFX_TRACE_ZONE("model_loader::upload");
+		if (aRequest->cancelled()) return this->finish(aRequest, CANCELLED, nullptr);
+		std::shared_ptr<model> DeviceModel;
+		{
+			std::lock_guard<std::mutex> Lock(this->UploadMutex);
+			aRequest->Stage = UPLOAD;
+			auto Start = std::chrono::steady_clock::now();
+			// The host model is private to the load, so its data is handed over instead of copied.
+			DeviceModel = std::make_shared<model>(this->Context, std::move(*aRequest->HostModel), this->Settings.ImageCreateInfo, this->Settings.MaterialTable);
+			aRequest->StageTime[2] = seconds_since(Start);
+		}
+		aRequest->HostModel = nullptr;
+		if (aRequest->cancelled()) return this->finish(aRequest, CANCELLED, nullptr);
+		this->finish(aRequest, COMPLETE, DeviceModel);
+	}
+
+	void model_loader::finish(std::shared_ptr<request> aRequest, int aStage, std::shared_ptr<model> aModel) {
+		aRequest->Importer = nullptr;
+		aRequest->HostModel = nullptr;
+		if (aStage == COMPLETE) {
+			aRequest->Progress = 1.0f;
+		}
+		aRequest->Stage = aStage;
+		aRequest->Promise.set_value(aModel);
+		std::lock_guard<std::mutex> Lock(this->Mutex);
+		this->Active.erase(std::remove(this->Active.begin(), this->Active.end(), aRequest), this->Active.end());
+		this->Finished.push_back(aRequest);
+	}
+
+}
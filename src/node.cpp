@@ -1,4 +1,11 @@
 #include <geodesy/gfx/node.h>
+#include <geodesy/gfx/trace.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "parallel.h"
 
 // Model Loading
 #include <assimp/Importer.hpp>
@@ -27,8 +34,127 @@ namespace geodesy::gfx {
 	// also copies over the vertex weight data which informs how to deform
 	// the mesh instance. Used for animations.
 
+	// Mesh instances are only worth a thread of their own in batches of this size.
+	static const size_t InstanceGrain = 64;
+
+	// Latest node revision, shared by every hierarchy so revisions only ever increase.
+	static std::atomic<uint64_t> LatestRevision(1);
+
+	// Every node carries a header naming the arena it came from, null for the heap.
+	static const size_t NodeHeaderSize = alignof(std::max_align_t);
+
+	void* node::operator new(std::size_t aSize) {
+		arena* Arena = arena::current();
+		void* Block = Arena != nullptr ? Arena->allocate(aSize + NodeHeaderSize) : ::operator new(aSize + NodeHeaderSize);
+		*(arena**)Block = Arena;
+		return (uchar*)Block + NodeHeaderSize;
+	}
+
+	void node::operator delete(void* aPointer) {
+		if (aPointer == nullptr) return;
+		void* Block = (uchar*)aPointer - NodeHeaderSize;
+		arena* Arena = *(arena**)Block;
+		if (Arena != nullptr) {
+			Arena->release();
+		}
+		else {
+			::operator delete(Block);
+		}
+	}
+
+	node::update_statistics::update_statistics() {
+		this->InstanceCount 	= 0;
+		this->InstanceUpdated 	= 0;
+		this->ByteCount 		= 0;
+		this->InstanceDropped 	= 0;
+	}
+
+	// Writes the transform and bone matrices of a mesh instance. In place uniform buffers are only
+	// written if its node or any of its bones moved. Ring data is only valid for the frame it was
+	// written in, so with a ring every instance is written once per frame. If the ring is full,
+	// the instance is left without an allocation and aDropped is set. Returns the amount of bytes written.
+	static size_t update_instance(mesh::instance& aInstance, uniform_ring* aRing, bool& aDropped) {
+		aDropped = false;
+		// Resolve bone nodes once instead of searching the hierarchy by name every frame.
+		const std::vector<mesh::bone>& Bone = *aInstance.Bone;
+		if (aInstance.BoneNode.size() != Bone.size()) {
+			aInstance.BoneNode.resize(Bone.size());
+			for (size_t i = 0; i < Bone.size(); i++) {
+				aInstance.BoneNode[i] = aInstance.Root->find(Bone[i].Name);
+			}
+		}
+
+		gfx::node* Parent = static_cast<gfx::node*>(aInstance.Parent);
+		if (aRing != nullptr) {
+			// Already written this frame, by another device update of the same hierarchy.
+			if (aInstance.DynamicSerial == aRing->serial()) return 0;
+		}
+		else {
+			// Revisions instead of the Dirty flags, so a bone node whose own device update already
+			// ran still counts as moved for every instance it drives.
+			bool Dirty = Parent->Revision > aInstance.Revision;
+			for (size_t i = 0; (i < aInstance.BoneNode.size()) && !Dirty; i++) {
+				gfx::node* BoneNode = dynamic_cast<gfx::node*>(aInstance.BoneNode[i]);
+				Dirty = (BoneNode == nullptr) || (BoneNode->Revision > aInstance.Revision);
+			}
+			if (!Dirty) return 0;
+		}
+		uint64_t Revision = LatestRevision.load();
+
+		// Only the bones in use are written. The offsets never change after creation, but
+		// a fresh ring allocation needs them too.
+		mesh::instance::uniform_data* UniformData = nullptr;
+		if (aRing != nullptr) {
+			uniform_ring::allocation Allocation = aRing->allocate(sizeof(mesh::instance::uniform_data));
+			if (Allocation.Ptr == nullptr) {
+				// The previous allocation belongs to an earlier frame, it must not be drawn from.
+				aInstance.DynamicSerial = SIZE_MAX;
+				aDropped = true;
+				return 0;
+			}
+			aInstance.DynamicOffset = Allocation.Offset;
+			aInstance.DynamicSerial = aRing->serial();
+			UniformData = (mesh::instance::uniform_data*)Allocation.Ptr;
+			for (size_t i = 0; i < Bone.size(); i++) {
+				UniformData->BoneOffset[i] = Bone[i].Offset;
+			}
+		}
+		else {
+			if (aInstance.UniformBuffer == nullptr) return 0;
+			UniformData = (mesh::instance::uniform_data*)aInstance.UniformBuffer->Ptr;
+		}
+		UniformData->Transform = Parent->TransformToWorld;
+		for (size_t i = 0; i < aInstance.BoneNode.size(); i++) {
+			if (aInstance.BoneNode[i] != nullptr) {
+				UniformData->BoneTransform[i] = aInstance.BoneNode[i]->TransformToWorld;
+			}
+		}
+		aInstance.Revision = Revision;
+		return (1 + (aRing != nullptr ? 2 : 1) * aInstance.BoneNode.size()) * sizeof(math::mat<float, 4, 4>);
+	}
+
+	// Flags every node of the tree whose world transform changed since the previous call. Flags
+	// accumulate until a device update clears them, so no move is lost between device updates.
+	static void refresh_dirty(phys::node* aRoot) {
+		uint64_t Revision = LatestRevision.fetch_add(1) + 1;
+		std::vector<phys::node*> Nodes = aRoot->linearize();
+		for (phys::node* N : Nodes) {
+			gfx::node* GNode = dynamic_cast<gfx::node*>(N);
+			if (GNode) {
+				if (std::memcmp(&GNode->TransformToWorld, &GNode->PreviousTransformToWorld, sizeof(GNode->TransformToWorld)) != 0) {
+					GNode->Dirty 		= true;
+					GNode->Revision 	= Revision;
+				}
+				GNode->PreviousTransformToWorld = GNode->TransformToWorld;
+			}
+		}
+	}
+
 	node::node() {
 		// Default constructor for graphics node
+		this->Dirty = true;
+		this->Revision = LatestRevision.fetch_add(1) + 1;
+		this->PreviousTransformToWorld = this->TransformToWorld;
 	}
 
 	node::node(const aiScene* aScene, const aiNode* aNode, phys::node* aRoot, phys::node* aParent) : gfx::node() {
@@ -83,11 +209,11 @@ namespace geodesy::gfx {
 				);
 			}
 			// Load Mesh Instance Data
-			this->GraphicalMeshInstances[i] = mesh::instance(Mesh->mNumVertices, BoneData, MeshIndex, Mesh->mMaterialIndex, this->Root, this);
+			this->GraphicalMeshInstances[i] = mesh::instance(Mesh->mNumVertices, std::move(BoneData), MeshIndex, Mesh->mMaterialIndex, this->Root, this);
 		}
 	}
 
-	node::node(std::shared_ptr<gpu::context> aContext, const node* aNode, phys::node* aRoot, phys::node* aParent) {		
+	node::node(std::shared_ptr<gpu::context> aContext, const node* aNode, phys::node* aRoot, phys::node* aParent) : gfx::node() {		
 		// Check if root node.
 		if (aNode->Parent != nullptr) {
 			this->Root = aRoot;
@@ -127,28 +253,137 @@ namespace geodesy::gfx {
 		const std::vector<phys::animation>& 		aPlaybackAnimation,
 		const std::vector<float>& 					aAnimationWeight
 	) {
+		GEODESY_GFX_TRACE_ZONE("node::host_update");
 
 		// Call the base class update function to update the node data.
 		phys::node::host_update(aDeltaTime, aTime, aPlaybackAnimation, aAnimationWeight);
 
+		// Once the whole tree is updated, flag every node whose world transform moved so the
+		// device update can skip mesh instances which did not.
+		if (this->Parent == nullptr) {
+			refresh_dirty(this);
+		}
+
 	}
 
 	void node::device_update(
 		double 									aDeltaTime, 
 		double 									aTime
 	) {
+		GEODESY_GFX_TRACE_ZONE("node::device_update");
 		// For each mesh instance, and for each bone, update the 
 		// bone transformations according to their respective
 		// animation object.
+		update_statistics Statistics;
 		for (mesh::instance& MI : GraphicalMeshInstances) {
-			// This is only used to tranform mesh instance vertices without bone animation.
-			// Update Bone Buffer Date GPU side.
-			mesh::instance::uniform_data* UniformData = (mesh::instance::uniform_data*)MI.UniformBuffer->Ptr;
-			UniformData->Transform = this->TransformToWorld;
-			for (size_t i = 0; i < MI.Bone.size(); i++) {
-				UniformData->BoneTransform[i] = this->Root->find(MI.Bone[i].Name)->TransformToWorld;
+			bool Dropped;
+			size_t ByteCount = update_instance(MI, nullptr, Dropped);
+			Statistics.InstanceCount 	+= 1;
+			Statistics.InstanceUpdated 	+= ByteCount > 0 ? 1 : 0;
+			Statistics.ByteCount 		+= ByteCount;
+		}
+		GEODESY_GFX_TRACE_ADD(BYTES_UPLOADED, (int64_t)Statistics.ByteCount);
+		this->LastUpdate = Statistics;
+		this->Dirty = false;
+	}
+
+	void node::device_update(
+		uniform_ring& 							aRing,
+		double 									aDeltaTime,
+		double 									aTime
+	) {
+		GEODESY_GFX_TRACE_ZONE("node::device_update");
+		update_statistics Statistics;
+		for (mesh::instance& MI : GraphicalMeshInstances) {
+			bool Dropped;
+			size_t ByteCount = update_instance(MI, &aRing, Dropped);
+			Statistics.InstanceCount 	+= 1;
+			Statistics.InstanceUpdated 	+= ByteCount > 0 ? 1 : 0;
+			Statistics.ByteCount 		+= ByteCount;
+			Statistics.InstanceDropped 	+= Dropped ? 1 : 0;
+		}
+		GEODESY_GFX_TRACE_ADD(BYTES_UPLOADED, (int64_t)Statistics.ByteCount);
+		this->LastUpdate = Statistics;
+		this->Dirty = false;
+	}
+
+	node::update_statistics node::parallel_device_update(
+		double 									aDeltaTime,
+		double 									aTime,
+		size_t 									aThreadCount,
+		uniform_ring* 							aRing
+	) {
+		GEODESY_GFX_TRACE_ZONE("node::parallel_device_update");
+		std::vector<gfx::mesh::instance*> Instances = this->gather_instances();
+		std::vector<update_statistics> ThreadStatistics(parallel::thread_count(aThreadCount));
+
+		// Each thread owns a contiguous slice of the instance list, and every instance maps to its
+		// own region of device memory (ring allocations are atomic), so no locking is needed while writing.
+		parallel::for_range(Instances.size(), aThreadCount, InstanceGrain, [&](size_t aBegin, size_t aEnd, size_t aThread) {
+			update_statistics& Statistics = ThreadStatistics[aThread];
+			for (size_t i = aBegin; i < aEnd; i++) {
+				bool Dropped;
+				size_t ByteCount = update_instance(*Instances[i], aRing, Dropped);
+				Statistics.InstanceCount 	+= 1;
+				Statistics.InstanceUpdated 	+= ByteCount > 0 ? 1 : 0;
+				Statistics.ByteCount 		+= ByteCount;
+				Statistics.InstanceDropped 	+= Dropped ? 1 : 0;
+			}
+		});
+
+		update_statistics Total;
+		for (const update_statistics& Statistics : ThreadStatistics) {
+			Total.InstanceCount 	+= Statistics.InstanceCount;
+			Total.InstanceUpdated 	+= Statistics.InstanceUpdated;
+			Total.ByteCount 		+= Statistics.ByteCount;
+			Total.InstanceDropped 	+= Statistics.InstanceDropped;
+		}
+		for (phys::node* N : this->linearize()) {
+			gfx::node* GNode = dynamic_cast<gfx::node*>(N);
+			if (GNode) {
+				GNode->Dirty = false;
 			}
 		}
+		GEODESY_GFX_TRACE_ADD(BYTES_UPLOADED, (int64_t)Total.ByteCount);
+		this->LastUpdate = Total;
+		return Total;
+	}
+
+	void node::playback(
+		double 												aTime,
+		const std::vector<std::shared_ptr<const animation>>& 	aPlaybackAnimation,
+		const std::vector<float>& 							aAnimationWeight
+	) {
+		// Blend the local transform, nodes not animated by a clip use the bind pose for its share.
+		float BindPoseWeight = 1.0f;
+		math::mat<float, 4, 4> Blend = this->TransformToParentDefault * 0.0f;
+		for (size_t i = 0; i < std::min(aPlaybackAnimation.size(), aAnimationWeight.size()); i++) {
+			math::mat<float, 4, 4> Pose;
+			if ((aPlaybackAnimation[i] != nullptr) && aPlaybackAnimation[i]->pose(this->Identifier, aTime, Pose)) {
+				Blend += Pose * aAnimationWeight[i];
+				BindPoseWeight -= aAnimationWeight[i];
+			}
+		}
+		this->TransformToParentCurrent = Blend + this->TransformToParentDefault * BindPoseWeight;
+
+		// Parents are posed before their children, so the parent world transform is current.
+		if (this->Parent != nullptr) {
+			this->TransformToWorld = this->Parent->TransformToWorld * this->TransformToParentCurrent;
+		}
+		else {
+			this->TransformToWorld = this->TransformToParentCurrent;
+		}
+
+		for (phys::node* Child : this->Child) {
+			gfx::node* GNode = dynamic_cast<gfx::node*>(Child);
+			if (GNode) {
+				GNode->playback(aTime, aPlaybackAnimation, aAnimationWeight);
+			}
+		}
+
+		if (this->Parent == nullptr) {
+			refresh_dirty(this);
+		}
 	}
 
 	// Counts the total number of mesh references in the tree.
@@ -0,0 +1,80 @@
+#include "parallel.h"
+
+namespace geodesy::gfx::parallel {
+
+	pool& pool::get() {
+		static pool Pool(thread_count() - 1);
+		return Pool;
+	}
+
+	pool::pool(size_t aWorkerCount) {
+		this->Stop = false;
+		for (size_t i = 0; i < aWorkerCount; i++) {
+			this->Worker.emplace_back(&pool::work, this);
+		}
+	}
+
+	pool::~pool() {
+		{
+			std::lock_guard<std::mutex> Lock(this->Mutex);
+			this->Stop = true;
+		}
+		this->Work.notify_all();
+		for (std::thread& W : this->Worker) {
+			W.join();
+		}
+	}
+
+	void pool::run(size_t aTaskCount, const std::function<void(size_t)>& aTask) {
+		if (aTaskCount == 0) return;
+		job Job;
+		Job.Task 		= &aTask;
+		Job.Count 		= aTaskCount;
+		Job.Next 		= 0;
+		Job.Remaining 	= aTaskCount;
+		std::unique_lock<std::mutex> Lock(this->Mutex);
+		if (aTaskCount > 1) {
+			this->Queue.push_back(&Job);
+			this->Work.notify_all();
+		}
+		// The job lives on this stack, workers only touch it under the lock and while it has
+		// tasks left, so it stays valid until Remaining reaches zero.
+		while (Job.Next < Job.Count) {
+			size_t Index = this->claim(&Job);
+			Lock.unlock();
+			aTask(Index);
+			Lock.lock();
+			Job.Remaining -= 1;
+		}
+		this->Done.wait(Lock, [&]() { return Job.Remaining == 0; });
+	}
+
+	size_t pool::worker_count() const {
+		return this->Worker.size();
+	}
+
+	size_t pool::claim(job* aJob) {
+		size_t Index = aJob->Next++;
+		if (aJob->Next == aJob->Count) {
+			auto It = std::find(this->Queue.begin(), this->Queue.end(), aJob);
+			if (It != this->Queue.end()) this->Queue.erase(It);
+		}
+		return Index;
+	}
+
+	void pool::work() {
+		std::unique_lock<std::mutex> Lock(this->Mutex);
+		while (true) {
+			this->Work.wait(Lock, [&]() { return this->Stop || !this->Queue.empty(); });
+			if (this->Stop) return;
+			job* Job = this->Queue.front();
+			size_t Index = this->claim(Job);
+			Lock.unlock();
+			(*Job->Task)(Index);
+			Lock.lock();
+			Job->Remaining -= 1;
+			if (Job->Remaining == 0) this->Done.notify_all();
+		}
+	}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+#ifndef GEODESY_GFX_PARALLEL_H
+#define GEODESY_GFX_PARALLEL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Internal helpers for splitting host side work across threads.
+
+namespace geodesy::gfx::parallel {
+
+	// Resolves a requested thread count, zero means one per hardware thread.
+	inline size_t thread_count(size_t aRequested = 0) {
+		if (aRequested > 0) return aRequested;
+		size_t Count = std::thread::hardware_concurrency();
+		return Count > 0 ? Count : 1;
+	}
+
+	// Worker threads shared by every parallel loop of the library, started on first use and
+	// kept until exit, so per frame loops do not create threads. Any thread may submit work,
+	// including a worker running a task of another loop.
+	class pool {
+	public:
+
+		// The pool of the library, one worker per hardware thread minus the calling thread.
+		static pool& get();
+
+		pool(size_t aWorkerCount);
+		~pool();
+
+		// Calls aTask(i) for every i in [0, aTaskCount) and returns once all are done. The calling
+		// thread runs tasks as well, so the loop finishes even if every worker is busy.
+		void run(size_t aTaskCount, const std::function<void(size_t)>& aTask);
+
+		size_t worker_count() const;
+
+	private:
+
+		struct job {
+			const std::function<void(size_t)>* 	Task;
+			size_t 								Count;
+			size_t 								Next; 			// Next task index to hand out.
+			size_t 								Remaining; 		// Tasks not finished yet.
+		};
+
+		std::mutex 								Mutex;
+		std::condition_variable 				Work;
+		std::condition_variable 				Done;
+		std::deque<job*> 						Queue; 			// Jobs with tasks left to hand out.
+		std::vector<std::thread> 				Worker;
+		bool 									Stop;
+
+		// Hands out the next task index of aJob, dropping it from the queue once all are handed out.
+		size_t claim(job* aJob);
+		void work();
+
+	};
+
+	// Splits [0, aCount) into contiguous ranges and calls aFunction(aBegin, aEnd, aThreadIndex)
+	// for each on the pool. Ranges are never smaller than aGrain, so small workloads stay on the
+	// calling thread, and there are at most aThreadCount of them. aThreadIndex numbers the ranges,
+	// so it can index per thread scratch data. Returns once every range is done.
+	template <typename function>
+	void for_range(size_t aCount, size_t aThreadCount, size_t aGrain, function aFunction) {
+		if (aCount == 0) return;
+		size_t ThreadCount = std::min(thread_count(aThreadCount), std::max((size_t)1, aCount / std::max((size_t)1, aGrain)));
+		if (ThreadCount <= 1) {
+			aFunction((size_t)0, aCount, (size_t)0);
+			return;
+		}
+		size_t Chunk = (aCount + ThreadCount - 1) / ThreadCount;
+		size_t RangeCount = (aCount + Chunk - 1) / Chunk;
+		pool::get().run(RangeCount, [&](size_t aRange) {
+			size_t Begin = aRange * Chunk;
+			aFunction(Begin, std::min(aCount, Begin + Chunk), aRange);
+		});
+	}
+
+}
+
+#endif // !GEODESY_GFX_PARALLEL_H
@@ -0,0 +1,269 @@
+#include <geodesy/gfx/texture_streamer.h>
+#include <geodesy/gfx/trace.h>
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <geodesy/gfx/model.h>
+
+namespace geodesy::gfx {
+
+	static const uint NoLevel = UINT32_MAX;
+
+	texture_streamer::settings::settings() {
+		this->Budget 		= 256ull << 20;
+		this->TailSize 		= 64;
+		this->Latency 		= 0.05;
+		this->MaxInFlight 	= 16;
+		this->Bias 			= 0.0f;
+	}
+
+	size_t texture_streamer::texture::resident_size() const {
+		size_t Size = 0;
+		for (size_t i = this->ResidentLevel; i < this->Chain->Level.size(); i++) {
+			Size += this->Chain->Level[i].Data.size();
+		}
+		return Size;
+	}
+
+	texture_streamer::statistics::statistics() {
+		this->ResidentBytes 		= 0;
+		this->PeakResidentBytes 	= 0;
+		this->RequestCount 			= 0;
+		this->UploadCount 			= 0;
+		this->UploadBytes 			= 0;
+		this->EvictionCount 		= 0;
+		this->EvictionBytes 		= 0;
+		this->InFlight 				= 0;
+	}
+
+	texture_streamer::texture_streamer() {
+		this->Time 			= 0.0;
+		this->PendingBytes 	= 0;
+	}
+
+	texture_streamer::texture_streamer(settings aSettings) : texture_streamer() {
+		this->Settings = aSettings;
+	}
+
+	uint texture_streamer::add(std::shared_ptr<const mipmap> aChain) {
+		texture Entry;
+		Entry.Chain 		= aChain;
+		Entry.TailLevel 	= 0;
+		Entry.LastNeeded 	= this->Time;
+		Entry.PendingLevel 	= NoLevel;
+		uint LevelCount = (uint)aChain->Level.size();
+		if (LevelCount > 0) {
+			// The tail starts at the first level that fits in TailSize, or the last level.
+			Entry.TailLevel = LevelCount - 1;
+			for (uint i = 0; i < LevelCount; i++) {
+				if (std::max(aChain->Level[i].Width, aChain->Level[i].Height) <= this->Settings.TailSize) {
+					Entry.TailLevel = i;
+					break;
+				}
+			}
+		}
+		Entry.ResidentLevel = LevelCount > 0 ? Entry.TailLevel : 0;
+		Entry.DesiredLevel 	= Entry.TailLevel;
+
+		uint Index = (uint)this->Texture.size();
+		this->Texture.push_back(Entry);
+		for (uint i = Entry.ResidentLevel; i < LevelCount; i++) {
+			if (this->Upload) this->Upload(Index, i, aChain->Level[i]);
+			this->Statistics.UploadCount += 1;
+			this->Statistics.UploadBytes += aChain->Level[i].Data.size();
+		}
+		this->Statistics.ResidentBytes += Entry.resident_size();
+		this->Statistics.PeakResidentBytes = std::max(this->Statistics.PeakResidentBytes, this->Statistics.ResidentBytes);
+		return Index;
+	}
+
+	void texture_streamer::add(const material* aMaterial, mipmap::settings aSettings) {
+		if (aMaterial == nullptr) return;
+		std::vector<uint>& Index = this->MaterialTexture[aMaterial];
+		for (int Slot = 0; Slot < material::TEXTURE_SLOT_COUNT; Slot++) {
+			const std::shared_ptr<gpu::image>& Image = aMaterial->Texture[Slot];
+			// Only 8 bit images can be filtered into a chain.
+			if ((Image == nullptr) || (Image->HostData == nullptr) || (mipmap::channel_count(Image->CreateInfo.format) == 0)) continue;
+			// Images shared between materials are streamed once.
+			auto It = this->ImageTexture.find(Image.get());
+			if (It != this->ImageTexture.end()) {
+				Index.push_back(It->second);
+				continue;
+			}
+			mipmap::settings Settings = aSettings;
+			Settings.NormalMap = (Slot == material::NORMAL);
+			uint TextureIndex = this->add(std::make_shared<const mipmap>(*Image, Settings));
+			this->ImageTexture[Image.get()] = TextureIndex;
+			Index.push_back(TextureIndex);
+		}
+	}
+
+	void texture_streamer::add(const model& aModel, mipmap::settings aSettings) {
+		for (const std::shared_ptr<material>& Material : aModel.Material) {
+			this->add(Material.get(), aSettings);
+		}
+	}
+
+	void texture_streamer::request(uint aTexture, float aScreenSize) {
+		if (aTexture >= this->Texture.size()) return;
+		texture& Entry = this->Texture[aTexture];
+		if (Entry.Chain->Level.empty()) return;
+		const mipmap::level& Base = Entry.Chain->Level[0];
+		float Size = (float)std::max(Base.Width, Base.Height);
+		float Level = std::log2(Size / std::max(aScreenSize, 1.0f)) + this->Settings.Bias;
+		uint Desired = (uint)std::clamp((int)std::floor(Level), 0, (int)Entry.TailLevel);
+		Entry.DesiredLevel = std::min(Entry.DesiredLevel, Desired);
+		Entry.LastNeeded = this->Time;
+	}
+
+	void texture_streamer::request(const material* aMaterial, float aScreenSize) {
+		for (uint Index : this->textures(aMaterial)) {
+			this->request(Index, aScreenSize);
+		}
+	}
+
+	void texture_streamer::request(const model& aModel, math::vec<float, 3> aCameraPosition, float aFieldOfView, float aViewportHeight) {
+		if (aModel.Hierarchy == nullptr) return;
+		std::vector<phys::node*> Nodes = aModel.Hierarchy->linearize();
+		for (phys::node* N : Nodes) {
+			gfx::node* GNode = dynamic_cast<gfx::node*>(N);
+			if (GNode == nullptr) continue;
+			const math::mat<float, 4, 4>& World = GNode->TransformToWorld;
+			// Largest axis scale of the world transform, to scale the bounding radius.
+			float Scale = 0.0f;
+			for (int j = 0; j < 3; j++) {
+				float Length = std::sqrt(World(0, j) * World(0, j) + World(1, j) * World(1, j) + World(2, j) * World(2, j));
+				Scale = std::max(Scale, Length);
+			}
+			for (const mesh::instance& Instance : GNode->GraphicalMeshInstances) {
+				if ((Instance.MeshIndex < 0) || ((size_t)Instance.MeshIndex >= aModel.Mesh.size()) || (Instance.MaterialIndex >= aModel.Material.size())) continue;
+				const std::shared_ptr<mesh>& Mesh = aModel.Mesh[Instance.MeshIndex];
+				math::vec<float, 4> Center = World * math::vec<float, 4>(Mesh->CenterOfMass[0], Mesh->CenterOfMass[1], Mesh->CenterOfMass[2], 1.0f);
+				float Distance = std::sqrt(
+					(Center[0] - aCameraPosition[0]) * (Center[0] - aCameraPosition[0]) +
+					(Center[1] - aCameraPosition[1]) * (Center[1] - aCameraPosition[1]) +
+					(Center[2] - aCameraPosition[2]) * (Center[2] - aCameraPosition[2])
+				);
+				float ScreenSize = projected_size(Mesh->BoundingRadius * Scale, Distance, aFieldOfView, aViewportHeight);
+				this->request(aModel.Material[Instance.MaterialIndex].get(), ScreenSize);
+			}
+		}
+	}
+
+	size_t texture_streamer::update(double aDeltaTime) {
+		GEODESY_GFX_TRACE_ZONE("texture_streamer::update");
+		double FrameTime = this->Time;
+		this->Time += aDeltaTime;
+
+		// Complete requests whose latency has passed. Loads for levels that are no longer
+		// next in line, because the texture was evicted meanwhile, are dropped.
+		size_t UploadCount = 0;
+		while (!this->Pending.empty() && (this->Pending.front().CompletionTime <= this->Time)) {
+			load Load = this->Pending.front();
+			this->Pending.pop_front();
+			texture& Entry = this->Texture[Load.Texture];
+			const mipmap::level& Level = Entry.Chain->Level[Load.Level];
+			this->PendingBytes -= Level.Data.size();
+			Entry.PendingLevel = NoLevel;
+			if (Load.Level + 1 != Entry.ResidentLevel) continue;
+			if (this->Upload) this->Upload(Load.Texture, Load.Level, Level);
+			Entry.ResidentLevel = Load.Level;
+			this->Statistics.ResidentBytes += Level.Data.size();
+			this->Statistics.UploadCount += 1;
+			this->Statistics.UploadBytes += Level.Data.size();
+			UploadCount += 1;
+		}
+		this->Statistics.PeakResidentBytes = std::max(this->Statistics.PeakResidentBytes, this->Statistics.ResidentBytes);
+
+		// Issue requests, textures furthest from their desired level first.
+		std::vector<uint> Candidate;
+		for (uint i = 0; i < this->Texture.size(); i++) {
+			const texture& Entry = this->Texture[i];
+			if ((Entry.PendingLevel == NoLevel) && (Entry.DesiredLevel < Entry.ResidentLevel)) {
+				Candidate.push_back(i);
+			}
+		}
+		std::sort(Candidate.begin(), Candidate.end(), [&](uint aA, uint aB) {
+			const texture& A = this->Texture[aA];
+			const texture& B = this->Texture[aB];
+			uint DeficitA = A.ResidentLevel - A.DesiredLevel;
+			uint DeficitB = B.ResidentLevel - B.DesiredLevel;
+			if (DeficitA != DeficitB) return DeficitA > DeficitB;
+			return aA < aB;
+		});
+		for (uint Index : Candidate) {
+			if (this->Pending.size() >= this->Settings.MaxInFlight) break;
+			texture& Entry = this->Texture[Index];
+			uint Level = Entry.ResidentLevel - 1;
+			size_t Size = Entry.Chain->Level[Level].Data.size();
+			// Make room first, without touching what this frame still needs.
+			if (this->Statistics.ResidentBytes + this->PendingBytes + Size > this->Settings.Budget) {
+				this->evict(this->Settings.Budget > Size ? this->Settings.Budget - Size : 0, FrameTime);
+				if (this->Statistics.ResidentBytes + this->PendingBytes + Size > this->Settings.Budget) continue;
+			}
+			load Load;
+			Load.Texture 		= Index;
+			Load.Level 			= Level;
+			Load.CompletionTime = this->Time + this->Settings.Latency;
+			this->Pending.push_back(Load);
+			this->PendingBytes += Size;
+			Entry.PendingLevel = Level;
+			this->Statistics.RequestCount += 1;
+		}
+
+		// The budget may have been lowered, or requests for the next frame start from scratch.
+		this->evict(this->Settings.Budget, FrameTime);
+		for (texture& Entry : this->Texture) {
+			Entry.DesiredLevel = Entry.TailLevel;
+		}
+		this->Statistics.InFlight = this->Pending.size();
+		return UploadCount;
+	}
+
+	const std::vector<uint>& texture_streamer::textures(const material* aMaterial) const {
+		static const std::vector<uint> Empty;
+		auto It = this->MaterialTexture.find(aMaterial);
+		return It != this->MaterialTexture.end() ? It->second : Empty;
+	}
+
+	float texture_streamer::projected_size(float aRadius, float aDistance, float aFieldOfView, float aViewportHeight) {
+		// Inside the bounding sphere the object covers the whole view.
+		float Distance = std::max(aDistance, aRadius);
+		if (Distance <= 0.0f) return aViewportHeight;
+		return aViewportHeight * aRadius / (Distance * std::tan(0.5f * aFieldOfView));
+	}
+
+	void texture_streamer::evict(size_t aBudget, double aNeededAfter) {
+		if (this->Statistics.ResidentBytes + this->PendingBytes <= aBudget) return;
+
+		// Least recently needed textures first. Textures needed this frame only give up
+		// levels finer than the one they asked for.
+		std::vector<uint> Order;
+		for (uint i = 0; i < this->Texture.size(); i++) {
+			if (this->Texture[i].ResidentLevel < this->Texture[i].TailLevel) {
+				Order.push_back(i);
+			}
+		}
+		std::sort(Order.begin(), Order.end(), [&](uint aA, uint aB) {
+			if (this->Texture[aA].LastNeeded != this->Texture[aB].LastNeeded) return this->Texture[aA].LastNeeded < this->Texture[aB].LastNeeded;
+			return this->Texture[aA].resident_size() > this->Texture[aB].resident_size();
+		});
+
+		for (uint Index : Order) {
+			texture& Entry = this->Texture[Index];
+			uint Floor = Entry.LastNeeded >= aNeededAfter ? Entry.DesiredLevel : Entry.TailLevel;
+			while ((Entry.ResidentLevel < Floor) && (this->Statistics.ResidentBytes + this->PendingBytes > aBudget)) {
+				size_t Size = Entry.Chain->Level[Entry.ResidentLevel].Data.size();
+				if (this->Evict) this->Evict(Index, Entry.ResidentLevel);
+				Entry.ResidentLevel += 1;
+				this->Statistics.ResidentBytes -= Size;
+				this->Statistics.EvictionCount += 1;
+				this->Statistics.EvictionBytes += Size;
+			}
+			if (this->Statistics.ResidentBytes + this->PendingBytes <= aBudget) break;
+		}
+	}
+
+}
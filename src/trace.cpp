@@ -0,0 +1,161 @@
+#include <geodesy/gfx/trace.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace geodesy::gfx::trace {
+
+	enum type : uint8_t {
+		ZONE,
+		COUNTER,
+		FRAME
+	};
+
+	struct event {
+		const char* 	Name;
+		uint64_t 		Begin; 		// Nanoseconds.
+		uint64_t 		Duration;
+		int64_t 		Value;
+		uint8_t 		Type;
+	};
+
+	// Written only by its thread, Head is published so an exporter sees complete events.
+	struct ring {
+		std::vector<event> 		Event;
+		std::atomic<uint64_t> 	Head;
+		uint32_t 				Thread;
+	};
+
+	static const char* CounterName[COUNTER_COUNT] = {
+		"BuffersCreated",
+		"ImagesCreated",
+		"BytesUploaded"
+	};
+
+	static const std::chrono::steady_clock::time_point Epoch = std::chrono::steady_clock::now();
+	static std::atomic<size_t> Capacity(1 << 16);
+	static std::atomic<int64_t> FrameCounter[COUNTER_COUNT];
+	static std::atomic<uint64_t> FrameNumber(0);
+
+	// Rings outlive their threads so events of finished workers can still be exported.
+	static std::mutex RegistryMutex;
+	static std::vector<std::shared_ptr<ring>> Registry;
+
+	// The only lock is taken once per thread, on its first event.
+	static ring& local_ring() {
+		thread_local std::shared_ptr<ring> Local;
+		if (Local == nullptr) {
+			Local = std::make_shared<ring>();
+			Local->Event.resize(std::max((size_t)1, Capacity.load()));
+			Local->Head = 0;
+			std::lock_guard<std::mutex> Lock(RegistryMutex);
+			Local->Thread = (uint32_t)Registry.size();
+			Registry.push_back(Local);
+		}
+		return *Local;
+	}
+
+	static void record(uint8_t aType, const char* aName, uint64_t aBegin, uint64_t aDuration, int64_t aValue) {
+		ring& Ring = local_ring();
+		uint64_t Head = Ring.Head.load(std::memory_order_relaxed);
+		event& Event = Ring.Event[Head % Ring.Event.size()];
+		Event.Name 		= aName;
+		Event.Begin 	= aBegin;
+		Event.Duration 	= aDuration;
+		Event.Value 	= aValue;
+		Event.Type 		= aType;
+		Ring.Head.store(Head + 1, std::memory_order_release);
+	}
+
+	zone::zone(const char* aName) {
+		this->Name 	= aName;
+		this->Begin = now();
+	}
+
+	zone::~zone() {
+		record(ZONE, this->Name, this->Begin, now() - this->Begin, 0);
+	}
+
+	uint64_t now() {
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Epoch).count();
+	}
+
+	void counter(const char* aName, int64_t aValue) {
+		record(COUNTER, aName, now(), 0, aValue);
+	}
+
+	void add(frame_counter aCounter, int64_t aValue) {
+		FrameCounter[aCounter].fetch_add(aValue, std::memory_order_relaxed);
+	}
+
+	void frame() {
+		uint64_t Time = now();
+		for (int i = 0; i < COUNTER_COUNT; i++) {
+			record(COUNTER, CounterName[i], Time, 0, FrameCounter[i].exchange(0, std::memory_order_relaxed));
+		}
+		record(FRAME, "Frame", Time, 0, (int64_t)FrameNumber.fetch_add(1));
+	}
+
+	void set_capacity(size_t aEventCount) {
+		Capacity = aEventCount;
+	}
+
+	void clear() {
+		std::lock_guard<std::mutex> Lock(RegistryMutex);
+		for (const std::shared_ptr<ring>& Ring : Registry) {
+			Ring->Head = 0;
+		}
+		for (std::atomic<int64_t>& Counter : FrameCounter) {
+			Counter = 0;
+		}
+	}
+
+	std::string chrome_json() {
+		std::string Output = "{\"traceEvents\":[\n";
+		bool First = true;
+		char Line[512];
+		std::lock_guard<std::mutex> Lock(RegistryMutex);
+		for (const std::shared_ptr<ring>& Ring : Registry) {
+			uint64_t Head = Ring->Head.load(std::memory_order_acquire);
+			uint64_t Size = Ring->Event.size();
+			for (uint64_t i = Head > Size ? Head - Size : 0; i < Head; i++) {
+				const event& Event = Ring->Event[i % Size];
+				double Time = (double)Event.Begin / 1000.0;
+				switch (Event.Type) {
+				case ZONE:
+					std::snprintf(Line, sizeof(Line), "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+						Event.Name, Time, (double)Event.Duration / 1000.0, Ring->Thread);
+					break;
+				case COUNTER:
+					std::snprintf(Line, sizeof(Line), "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"value\":%lld}}",
+						Event.Name, Time, Ring->Thread, (long long)Event.Value);
+					break;
+				default:
+					std::snprintf(Line, sizeof(Line), "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"frame\":%lld}}",
+						Event.Name, Time, Ring->Thread, (long long)Event.Value);
+					break;
+				}
+				if (!First) Output += ",\n";
+				Output += Line;
+				First = false;
+			}
+		}
+		Output += "\n]}\n";
+		return Output;
+	}
+
+	bool write_chrome_json(const std::string& aPath) {
+		std::string Json = chrome_json();
+		FILE* File = std::fopen(aPath.c_str(), "wb");
+		if (File == nullptr) return false;
+		bool Written = std::fwrite(Json.data(), 1, Json.size(), File) == Json.size();
+		std::fclose(File);
+		return Written;
+	}
+
+}
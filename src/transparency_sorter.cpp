@@ -0,0 +1,257 @@
+#include <geodesy/gfx/transparency_sorter.h>
+#include <geodesy/gfx/trace.h>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+#include <geodesy/gfx/model.h>
+
+#include "parallel.h"
+
+namespace geodesy::gfx {
+
+	static double seconds_since(std::chrono::steady_clock::time_point aStart) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - aStart).count();
+	}
+
+	// Insertion sort budgets before falling back to a full sort.
+	static const size_t MaxShiftsPerEntry = 8;
+	static const size_t MaxShiftsPerTriangle = 8;
+
+	static bool back_to_front(const transparency_sorter::entry& aA, const transparency_sorter::entry& aB) {
+		return aA.Depth > aB.Depth;
+	}
+
+	// Mesh holding the host geometry, device meshes are looked up through their host mesh.
+	static const mesh* host_mesh(const mesh* aMesh, std::shared_ptr<mesh>& aHold) {
+		if (aMesh == nullptr) return nullptr;
+		if (!aMesh->Vertex.empty()) return aMesh;
+		aHold = aMesh->HostMesh.lock();
+		return aHold != nullptr && !aHold->Vertex.empty() ? aHold.get() : nullptr;
+	}
+
+	static size_t triangle_count(const mesh* aMesh) {
+		return (aMesh->Topology.Data16.size() > 0 ? aMesh->Topology.Data16.size() : aMesh->Topology.Data32.size()) / 3;
+	}
+
+	transparency_sorter::statistics::statistics() {
+		this->EntryCount 			= 0;
+		this->CoherentCount 		= 0;
+		this->ShiftCount 			= 0;
+		this->TriangleMeshCount 	= 0;
+		this->TriangleCount 		= 0;
+		this->TriangleShiftCount 	= 0;
+		this->SortTime 				= 0.0;
+		this->TriangleTime 			= 0.0;
+	}
+
+	transparency_sorter::transparency_sorter() {
+		this->TriangleThreshold 	= 0;
+		this->ThreadCount 			= 0;
+		this->CameraPosition 		= { 0.0f, 0.0f, 0.0f };
+		this->CameraForward 		= { 0.0f, 0.0f, 1.0f };
+	}
+
+	void transparency_sorter::begin(math::vec<float, 3> aCameraPosition, math::vec<float, 3> aCameraForward) {
+		this->CameraPosition 	= aCameraPosition;
+		this->CameraForward 	= aCameraForward;
+		this->Entry.clear();
+	}
+
+	void transparency_sorter::add(const mesh::instance* aInstance, const mesh* aMesh, const material* aMaterial) {
+		entry Entry;
+		Entry.Instance 		= aInstance;
+		Entry.Mesh 			= aMesh;
+		Entry.Material 		= aMaterial;
+		Entry.Depth 		= this->depth(aInstance, aMesh);
+		Entry.Index 		= nullptr;
+		this->Entry.push_back(Entry);
+	}
+
+	void transparency_sorter::add(model& aModel) {
+		if (aModel.Hierarchy == nullptr) return;
+		std::vector<mesh::instance*> Instance = aModel.Hierarchy->gather_instances();
+		for (const mesh::instance* I : Instance) {
+			if ((I->MeshIndex < 0) || ((size_t)I->MeshIndex >= aModel.Mesh.size()) || (I->MaterialIndex >= aModel.Material.size())) continue;
+			const material* Material = aModel.Material[I->MaterialIndex].get();
+			if ((Material == nullptr) || (Material->UniformData.Transparency != material::transparency::TRANSLUCENT)) continue;
+			this->add(I, aModel.Mesh[I->MeshIndex].get(), Material);
+		}
+	}
+
+	void transparency_sorter::sort() {
+		GEODESY_GFX_TRACE_ZONE("transparency_sorter::sort");
+		auto Start = std::chrono::steady_clock::now();
+		this->Statistics = statistics();
+		this->Statistics.EntryCount = this->Entry.size();
+
+		// Start from last frame's order, entries new this frame go to the back.
+		std::unordered_map<const mesh::instance*, size_t> Current;
+		Current.reserve(this->Entry.size());
+		for (size_t i = 0; i < this->Entry.size(); i++) {
+			Current.emplace(this->Entry[i].Instance, i);
+		}
+		std::vector<entry> Ordered;
+		Ordered.reserve(this->Entry.size());
+		std::vector<bool> Placed(this->Entry.size(), false);
+		for (const mesh::instance* Instance : this->Previous) {
+			auto It = Current.find(Instance);
+			if ((It == Current.end()) || Placed[It->second]) continue;
+			Ordered.push_back(this->Entry[It->second]);
+			Placed[It->second] = true;
+		}
+		size_t CoherentCount = Ordered.size();
+
+		// Nearly sorted already, so an insertion sort only moves the few that swapped.
+		for (size_t i = 1; i < CoherentCount; i++) {
+			entry Entry = Ordered[i];
+			size_t j = i;
+			while ((j > 0) && back_to_front(Entry, Ordered[j - 1])) {
+				Ordered[j] = Ordered[j - 1];
+				j -= 1;
+			}
+			Ordered[j] = Entry;
+			this->Statistics.ShiftCount += i - j;
+			// A fast camera turn can reverse the order, stop paying quadratic cost.
+			if (this->Statistics.ShiftCount > MaxShiftsPerEntry * CoherentCount) {
+				std::stable_sort(Ordered.begin(), Ordered.begin() + CoherentCount, back_to_front);
+				break;
+			}
+		}
+
+		// New entries have no prior order, sort them on their own and merge them in.
+		for (size_t i = 0; i < this->Entry.size(); i++) {
+			if (!Placed[i]) Ordered.push_back(this->Entry[i]);
+		}
+		std::stable_sort(Ordered.begin() + CoherentCount, Ordered.end(), back_to_front);
+		std::inplace_merge(Ordered.begin(), Ordered.begin() + CoherentCount, Ordered.end(), back_to_front);
+
+		this->Entry.swap(Ordered);
+		this->Previous.resize(this->Entry.size());
+		for (size_t i = 0; i < this->Entry.size(); i++) {
+			this->Previous[i] = this->Entry[i].Instance;
+		}
+		this->Statistics.CoherentCount = CoherentCount;
+		this->Statistics.SortTime = seconds_since(Start);
+
+		if (this->TriangleThreshold == 0) {
+			this->Triangle.clear();
+			return;
+		}
+
+		// Per triangle sorting of large meshes, orders are kept per instance for reuse next frame.
+		Start = std::chrono::steady_clock::now();
+		for (auto& [Instance, Order] : this->Triangle) {
+			Order.Seen = false;
+		}
+		std::vector<std::pair<entry*, triangle_order*>> Work;
+		for (entry& Entry : this->Entry) {
+			std::shared_ptr<mesh> Hold;
+			const mesh* Host = host_mesh(Entry.Mesh, Hold);
+			if ((Host == nullptr) || (triangle_count(Host) < this->TriangleThreshold)) continue;
+			triangle_order& Order = this->Triangle[Entry.Instance];
+			Order.Seen = true;
+			Work.emplace_back(&Entry, &Order);
+		}
+		for (auto It = this->Triangle.begin(); It != this->Triangle.end();) {
+			It = It->second.Seen ? std::next(It) : this->Triangle.erase(It);
+		}
+
+		std::vector<size_t> ShiftCount(Work.size(), 0);
+		parallel::for_range(Work.size(), this->ThreadCount, 1, [&](size_t aBegin, size_t aEnd, size_t) {
+			for (size_t i = aBegin; i < aEnd; i++) {
+				ShiftCount[i] = this->sort_triangles(*Work[i].first, *Work[i].second);
+			}
+		});
+		for (size_t i = 0; i < Work.size(); i++) {
+			Work[i].first->Index = &Work[i].second->Index;
+			this->Statistics.TriangleMeshCount 	+= 1;
+			this->Statistics.TriangleCount 		+= Work[i].second->Triangle.size();
+			this->Statistics.TriangleShiftCount += ShiftCount[i];
+		}
+		this->Statistics.TriangleTime = seconds_since(Start);
+	}
+
+	void transparency_sorter::reset() {
+		this->Previous.clear();
+		this->Triangle.clear();
+	}
+
+	float transparency_sorter::depth(const mesh::instance* aInstance, const mesh* aMesh) const {
+		math::vec<float, 3> Center = aMesh != nullptr ? aMesh->CenterOfMass : math::vec<float, 3>(0.0f, 0.0f, 0.0f);
+		math::vec<float, 3> World = Center;
+		if ((aInstance != nullptr) && (aInstance->Parent != nullptr)) {
+			const math::mat<float, 4, 4>& Transform = aInstance->Parent->TransformToWorld;
+			for (size_t i = 0; i < 3; i++) {
+				World[i] = Transform(i, 0) * Center[0] + Transform(i, 1) * Center[1] + Transform(i, 2) * Center[2] + Transform(i, 3);
+			}
+		}
+		return
+			(World[0] - this->CameraPosition[0]) * this->CameraForward[0] +
+			(World[1] - this->CameraPosition[1]) * this->CameraForward[1] +
+			(World[2] - this->CameraPosition[2]) * this->CameraForward[2];
+	}
+
+	size_t transparency_sorter::sort_triangles(const entry& aEntry, triangle_order& aOrder) const {
+		std::shared_ptr<mesh> Hold;
+		const mesh* Mesh = host_mesh(aEntry.Mesh, Hold);
+		size_t TriangleCount = triangle_count(Mesh);
+		const bool Wide = Mesh->Topology.Data16.empty();
+		auto index = [&](size_t aIndex) -> uint {
+			return Wide ? Mesh->Topology.Data32[aIndex] : (uint)Mesh->Topology.Data16[aIndex];
+		};
+
+		// Depth is linear in the local position, so fold the world transform into the
+		// view direction once. The constant offset does not change the order.
+		math::vec<float, 3> Direction = this->CameraForward;
+		if ((aEntry.Instance != nullptr) && (aEntry.Instance->Parent != nullptr)) {
+			const math::mat<float, 4, 4>& Transform = aEntry.Instance->Parent->TransformToWorld;
+			for (size_t j = 0; j < 3; j++) {
+				Direction[j] = this->CameraForward[0] * Transform(0, j) + this->CameraForward[1] * Transform(1, j) + this->CameraForward[2] * Transform(2, j);
+			}
+		}
+
+		if (aOrder.Triangle.size() != TriangleCount) {
+			aOrder.Triangle.resize(TriangleCount);
+			std::iota(aOrder.Triangle.begin(), aOrder.Triangle.end(), 0u);
+		}
+		aOrder.Depth.resize(TriangleCount);
+		for (size_t t = 0; t < TriangleCount; t++) {
+			float Depth = 0.0f;
+			for (size_t k = 0; k < 3; k++) {
+				const math::vec<float, 3>& Position = Mesh->Vertex[index(3 * t + k)].Position;
+				Depth += Position[0] * Direction[0] + Position[1] * Direction[1] + Position[2] * Direction[2];
+			}
+			aOrder.Depth[t] = Depth;
+		}
+
+		size_t ShiftCount = 0;
+		std::vector<uint>& Triangle = aOrder.Triangle;
+		for (size_t i = 1; i < TriangleCount; i++) {
+			uint T = Triangle[i];
+			float Depth = aOrder.Depth[T];
+			size_t j = i;
+			while ((j > 0) && (aOrder.Depth[Triangle[j - 1]] < Depth)) {
+				Triangle[j] = Triangle[j - 1];
+				j -= 1;
+			}
+			Triangle[j] = T;
+			ShiftCount += i - j;
+			// Fresh orders and sudden camera turns are far from sorted, stop paying quadratic cost.
+			if (ShiftCount > MaxShiftsPerTriangle * TriangleCount) {
+				std::stable_sort(Triangle.begin(), Triangle.end(), [&](uint aA, uint aB) { return aOrder.Depth[aA] > aOrder.Depth[aB]; });
+				break;
+			}
+		}
+
+		aOrder.Index.resize(3 * TriangleCount);
+		for (size_t i = 0; i < TriangleCount; i++) {
+			for (size_t k = 0; k < 3; k++) {
+				aOrder.Index[3 * i + k] = index(3 * Triangle[i] + k);
+			}
+		}
+		return ShiftCount;
+	}
+
+}
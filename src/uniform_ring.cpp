@@ -0,0 +1,96 @@
+#include <geodesy/gfx/uniform_ring.h>
+#include <geodesy/gfx/backend.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace geodesy::gfx {
+
+	using namespace gpu;
+
+	uniform_ring::allocation::allocation() {
+		this->Offset 	= 0;
+		this->Ptr 		= nullptr;
+		this->Size 		= 0;
+	}
+
+	uniform_ring::uniform_ring() {
+		this->Context 		= nullptr;
+		this->Buffer 		= nullptr;
+		this->FrameCount 	= 0;
+		this->FrameSize 	= 0;
+		this->Alignment 	= 256;
+		this->Head 			= 0;
+		this->Overflow 		= 0;
+		this->Serial 		= 0;
+		this->Base 			= nullptr;
+	}
+
+	uniform_ring::uniform_ring(std::shared_ptr<gpu::context> aContext, size_t aFrameCount, size_t aFrameSize, size_t aAlignment) : uniform_ring() {
+		this->Context 		= aContext;
+		this->FrameCount 	= aFrameCount > 0 ? aFrameCount : 1;
+		this->Alignment 	= aAlignment > 0 ? aAlignment : 1;
+		// Keep every frame region aligned so frame relative offsets stay valid dynamic offsets.
+		this->FrameSize 	= ((aFrameSize + this->Alignment - 1) / this->Alignment) * this->Alignment;
+
+		size_t Size = this->FrameCount * this->FrameSize;
+		backend* Backend = backend::get(aContext);
+		if (Backend != nullptr) {
+			buffer::create_info UBCI;
+			UBCI.Memory = device::memory::HOST_VISIBLE | device::memory::HOST_COHERENT;
+			UBCI.Usage = buffer::usage::UNIFORM | buffer::usage::TRANSFER_SRC | buffer::usage::TRANSFER_DST;
+			this->Buffer = Backend->create_buffer(aContext, UBCI, Size, nullptr, memory_ledger::UNIFORM_RING);
+			this->Base = (uchar*)Backend->map(*this->Buffer, 0, Size);
+		}
+		else {
+			this->HostData.resize(Size);
+			this->Base = this->HostData.data();
+		}
+
+		// Frame zero is open for allocations straight away.
+		this->Head = 0;
+	}
+
+	size_t uniform_ring::begin_frame() {
+		this->Serial += 1;
+		this->Head = 0;
+		this->Overflow = 0;
+		return this->Serial;
+	}
+
+	uniform_ring::allocation uniform_ring::allocate(size_t aSize) {
+		allocation Allocation;
+		if ((this->Base == nullptr) || (aSize == 0)) return Allocation;
+		size_t AlignedSize = ((aSize + this->Alignment - 1) / this->Alignment) * this->Alignment;
+		size_t Offset = this->Head.fetch_add(AlignedSize);
+		if (Offset + aSize > this->FrameSize) {
+			this->Overflow += 1;
+			return Allocation;
+		}
+		Allocation.Offset 	= (this->Serial % this->FrameCount) * this->FrameSize + Offset;
+		Allocation.Ptr 		= this->Base + Allocation.Offset;
+		Allocation.Size 	= aSize;
+		return Allocation;
+	}
+
+	uniform_ring::allocation uniform_ring::write(const void* aData, size_t aSize) {
+		allocation Allocation = this->allocate(aSize);
+		if (Allocation.Ptr != nullptr) {
+			std::memcpy(Allocation.Ptr, aData, aSize);
+		}
+		return Allocation;
+	}
+
+	size_t uniform_ring::serial() const {
+		return this->Serial;
+	}
+
+	size_t uniform_ring::used() const {
+		return std::min(this->Head.load(), this->FrameSize);
+	}
+
+	size_t uniform_ring::overflow_count() const {
+		return this->Overflow.load();
+	}
+
+}
@@ -0,0 +1,212 @@
+// Imports every model file under a directory on all cores and reports throughput.
+// With --upload, every model is also created on the device through the null backend,
+// so the upload path is timed without a GPU. With --merge-static, static unskinned
+// instances are merged into batches before the upload. With --cleanup, vertices are
+// welded and index buffers compacted, and the reductions are reported. With
+// --compress-animation, clips are compressed and the size reduction and the largest
+// per track error against the source tracks are reported. With --compress-textures, material
+// textures are block compressed with their mip chains before the upload.
+//
+// 	geodesy-model-import [--upload] [--cleanup] [--merge-static] [--compress-animation] [--compress-textures] <directory> [thread count] [extension list, e.g. .fbx,.gltf,.obj]
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <geodesy/gfx.h>
+
+using namespace geodesy;
+
+static std::vector<std::string> split(const std::string& aString, char aSeparator) {
+	std::vector<std::string> Result;
+	size_t Begin = 0;
+	while (Begin <= aString.size()) {
+		size_t End = aString.find(aSeparator, Begin);
+		if (End == std::string::npos) End = aString.size();
+		if (End > Begin) Result.push_back(aString.substr(Begin, End - Begin));
+		Begin = End + 1;
+	}
+	return Result;
+}
+
+static std::string lower(std::string aString) {
+	for (char& c : aString) c = (char)std::tolower((unsigned char)c);
+	return aString;
+}
+
+int main(int aArgCount, char* aArgs[]) {
+	bool Upload = false, Cleanup = false, MergeStatic = false, CompressAnimation = false, CompressTextures = false;
+	std::vector<std::string> Arg;
+	for (int i = 1; i < aArgCount; i++) {
+		if (std::string(aArgs[i]) == "--upload") Upload = true;
+		else if (std::string(aArgs[i]) == "--cleanup") Cleanup = true;
+		else if (std::string(aArgs[i]) == "--merge-static") MergeStatic = true;
+		else if (std::string(aArgs[i]) == "--compress-animation") CompressAnimation = true;
+		else if (std::string(aArgs[i]) == "--compress-textures") CompressTextures = true;
+		else Arg.push_back(aArgs[i]);
+	}
+	if (Arg.empty()) {
+		std::fprintf(stderr, "usage: %s [--upload] [--cleanup] [--merge-static] [--compress-animation] [--compress-textures] <directory> [thread count] [extensions]\n", aArgs[0]);
+		return 1;
+	}
+	std::string Directory = Arg[0];
+	size_t ThreadCount = Arg.size() > 1 ? (size_t)std::strtoul(Arg[1].c_str(), nullptr, 10) : 0;
+	if (ThreadCount == 0) ThreadCount = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::string> Extension = split(Arg.size() > 2 ? Arg[2] : ".fbx,.gltf,.glb,.obj,.dae,.3ds,.blend,.ply,.stl", ',');
+
+	// Gather files, largest first so the long imports do not end up last.
+	std::vector<std::pair<std::uintmax_t, std::string>> File;
+	for (const auto& Entry : std::filesystem::recursive_directory_iterator(Directory)) {
+		if (!Entry.is_regular_file()) continue;
+		std::string Ext = lower(Entry.path().extension().string());
+		for (const std::string& E : Extension) {
+			if (Ext == lower(E)) {
+				File.emplace_back(Entry.file_size(), Entry.path().string());
+				break;
+			}
+		}
+	}
+	std::sort(File.begin(), File.end(), [](const auto& aA, const auto& aB) { return aA.first > aB.first; });
+	if (File.empty()) {
+		std::fprintf(stderr, "no model files found in %s\n", Directory.c_str());
+		return 1;
+	}
+
+	gfx::model::initialize();
+	std::shared_ptr<gfx::backend> Backend;
+	if (Upload) {
+		Backend = std::make_shared<gfx::null_backend>();
+		Backend->Ledger = std::make_shared<gfx::memory_ledger>();
+		gfx::backend::install(Backend);
+	}
+
+	std::atomic<size_t> Next(0), Imported(0), Failed(0), MeshCount(0), VertexCount(0), MaterialCount(0), MergedCount(0), StaticCount(0), BatchCount(0), ByteCount(0);
+	std::atomic<size_t> CompressedTextureCount(0);
+	gfx::compressed_texture::cache TextureCache;
+	std::atomic<size_t> CleanVertexCount(0), SourceIndexCount(0), CleanIndexCount(0), DegenerateCount(0), NarrowedCount(0);
+	// Totals over every clip, the error fields hold the largest error of any clip.
+	gfx::animation::statistics Animation;
+	size_t ClipCount = 0;
+	std::mutex OutputMutex;
+	gfx::material_permutations Permutations;
+	auto Start = std::chrono::steady_clock::now();
+
+	// Each worker pulls the next file, every import leases its own importer.
+	std::vector<std::thread> Worker;
+	for (size_t t = 0; t < ThreadCount; t++) {
+		Worker.emplace_back([&]() {
+			while (true) {
+				size_t i = Next.fetch_add(1);
+				if (i >= File.size()) return;
+				// Files are already imported side by side, meshes are converted on the importing thread.
+				gfx::model Model(File[i].second, gfx::model::DefaultPostProcess, ThreadCount > 1 ? 1 : 0);
+				if (Model.Hierarchy == nullptr) {
+					Failed += 1;
+					std::lock_guard<std::mutex> Lock(OutputMutex);
+					std::fprintf(stderr, "failed: %s\n", File[i].second.c_str());
+					continue;
+				}
+				size_t Vertices = 0;
+				for (const auto& Mesh : Model.Mesh) {
+					Vertices += Mesh->Vertex.size();
+				}
+				Imported += 1;
+				MeshCount += Model.Mesh.size();
+				MaterialCount += Model.Material.size();
+				MergedCount += Model.deduplicate_materials();
+				Permutations.add(Model);
+				if (Cleanup) {
+					for (const gfx::mesh::cleanup_statistics& Mesh : Model.cleanup_meshes()) {
+						CleanVertexCount += Mesh.VertexCount;
+						SourceIndexCount += Mesh.SourceIndexCount;
+						CleanIndexCount += Mesh.IndexCount;
+						DegenerateCount += Mesh.DegenerateCount;
+						NarrowedCount += Mesh.Narrowed ? 1 : 0;
+					}
+				}
+				if (CompressAnimation) {
+					std::vector<gfx::animation::statistics> Clip = Model.compress_animation();
+					std::lock_guard<std::mutex> Lock(OutputMutex);
+					for (const gfx::animation::statistics& Statistics : Clip) {
+						ClipCount += 1;
+						Animation.SourceKeyCount 	+= Statistics.SourceKeyCount;
+						Animation.KeyCount 			+= Statistics.KeyCount;
+						Animation.SourceSize 		+= Statistics.SourceSize;
+						Animation.CompressedSize 	+= Statistics.CompressedSize;
+						Animation.MaxPositionError 	= std::max(Animation.MaxPositionError, Statistics.MaxPositionError);
+						Animation.MaxRotationError 	= std::max(Animation.MaxRotationError, Statistics.MaxRotationError);
+						Animation.MaxScaleError 	= std::max(Animation.MaxScaleError, Statistics.MaxScaleError);
+					}
+				}
+				if (CompressTextures) {
+					CompressedTextureCount += Model.compress_textures(&TextureCache, ThreadCount > 1 ? 1 : 0);
+				}
+				if (MergeStatic) {
+					gfx::model::merge_statistics Merge = Model.merge_static_geometry();
+					StaticCount += Merge.InstanceCount;
+					BatchCount += Merge.BatchCount;
+				}
+				VertexCount += Vertices;
+				ByteCount += (size_t)File[i].first;
+				if (Upload) {
+					gfx::model DeviceModel(nullptr, std::move(Model));
+				}
+			}
+		});
+	}
+	for (std::thread& W : Worker) {
+		W.join();
+	}
+
+	double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	gfx::model::terminate();
+	gfx::backend::install(nullptr);
+
+	std::printf("threads:     %zu\n", ThreadCount);
+	std::printf("files:       %zu imported, %zu failed\n", (size_t)Imported, (size_t)Failed);
+	std::printf("meshes:      %zu\n", (size_t)MeshCount);
+	std::printf("materials:   %zu, %zu duplicates merged, %zu shading permutations\n", (size_t)MaterialCount, (size_t)MergedCount, Permutations.size());
+	std::printf("vertices:    %zu\n", (size_t)VertexCount);
+	if (Cleanup) {
+		std::printf("cleanup:     %zu -> %zu vertices, %zu -> %zu indices, %zu degenerate triangles, %zu meshes narrowed to 16 bit\n",
+			(size_t)VertexCount, (size_t)CleanVertexCount, (size_t)SourceIndexCount, (size_t)CleanIndexCount, (size_t)DegenerateCount, (size_t)NarrowedCount);
+	}
+	if (CompressAnimation) {
+		std::printf("animation:   %zu clips, %zu -> %zu keys, %zu -> %zu bytes (%.2fx)\n",
+			ClipCount, Animation.SourceKeyCount, Animation.KeyCount, Animation.SourceSize, Animation.CompressedSize, Animation.compression_ratio());
+		std::printf("track error: %g position, %g rad rotation, %g scale (max, local)\n",
+			Animation.MaxPositionError, Animation.MaxRotationError, Animation.MaxScaleError);
+	}
+	if (CompressTextures) {
+		std::printf("textures:    %zu compressed, %zu cached levels (%zu hits)\n", (size_t)CompressedTextureCount, TextureCache.size(), TextureCache.HitCount);
+	}
+	if (MergeStatic) {
+		std::printf("static:      %zu instances merged into %zu batches\n", (size_t)StaticCount, (size_t)BatchCount);
+	}
+	std::printf("time:        %.3f s\n", Seconds);
+	std::printf("throughput:  %.2f files/s, %.2f MB/s, %.0f vertices/s\n",
+		(double)Imported / Seconds,
+		(double)ByteCount / (1024.0 * 1024.0) / Seconds,
+		(double)VertexCount / Seconds
+	);
+	if (Backend != nullptr) {
+		std::printf("uploaded:    %zu buffers (%.2f MB), %zu images (%.2f MB), %zu maps\n",
+			(size_t)Backend->Statistics.BufferCount,
+			(double)Backend->Statistics.BufferBytes / (1024.0 * 1024.0),
+			(size_t)Backend->Statistics.ImageCount,
+			(double)Backend->Statistics.ImageBytes / (1024.0 * 1024.0),
+			(size_t)Backend->Statistics.MapCount
+		);
+		// Device models are dropped after upload, so only the peak of the ledger is left.
+		std::printf("peak memory: %.2f MB\n", (double)Backend->Ledger->peak() / (1024.0 * 1024.0));
+	}
+	return Failed > 0 ? 2 : 0;
+}